@@ -0,0 +1,603 @@
+// Bidirectional path tracing (Veach 1997): a camera subpath and a light subpath are traced for every sample, and
+// every pair of their prefixes is connected into a full path, each weighted against the other strategies that
+// could have produced it with the power heuristic. The light subpath vertices connected to the camera are
+// splatted to the pixels they project to. Needs scene.glsl, raycast.glsl, bsdf.glsl, environment.glsl and
+// lights.glsl.
+//
+// Caustics through the dielectric spheres need the light subpaths: a camera subpath only finds the light behind
+// a specular chain if one of its diffuse bounces happens to hit an emitter.
+//
+// Light subpaths start on the emissive spheres of the light hierarchy, with a cosine distributed direction. The
+// environment map and the emissive surfaces are only lit by the camera subpaths, the environment through both
+// the BSDF and light samples like the path integrator does. Densities are per unit area, the ones of vertices
+// sampled through a delta lobe are 0 and left out of the weights like the delta lobes cancel out of the ratios.
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer BdptSplatArray
+{
+    uint values[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer BdptLightArray
+{
+    vec3 values[];
+};
+
+const uint bdpt_camera_vertex = 0u;
+const uint bdpt_light_vertex = 1u;
+const uint bdpt_surface_vertex = 2u;
+
+struct bdpt_vertex
+{
+    vec3 position;
+    // Facing the side the subpath arrived from, outward on the emitters
+    vec3 normal;
+    // Of the ray that arrived at the vertex
+    vec3 direction;
+    // Path throughput up to the vertex: importance or emitted radiance over the densities of the subpath
+    vec3 throughput;
+    uint type;
+    uint material_idx;
+    // Sphere of the vertex, no_hit_sphere on surfaces and procedural spheres
+    uint sphere;
+    // Densities of the vertex being sampled by its subpath, and by the other subpath coming the other way
+    float pdf_fwd;
+    float pdf_rev;
+    bool is_delta;
+    bool front_face;
+};
+
+// Pinhole camera of the trace, the viewport is where the camera rays of the pixels go through
+struct bdpt_camera
+{
+    vec3 position;
+    vec3 forward;
+    vec3 viewport_upper_left;
+    vec3 pixel_delta_u;
+    vec3 pixel_delta_v;
+    float focus_dist;
+    // Of the viewport moved at distance 1
+    float viewport_area;
+    ivec2 dim;
+};
+
+bdpt_vertex bdpt_camera_vertices[bdpt_max_vertices];
+bdpt_vertex bdpt_light_vertices[bdpt_max_vertices];
+// Emitter point of the light sample of the strategies with a single light vertex
+bdpt_vertex bdpt_sampled_light;
+
+// Solid angle density of the camera rays, uniform over the viewport: 1 / (A cos^3)
+float bdpt_camera_pdf(bdpt_camera camera, vec3 direction)
+{
+    float cos_theta = dot(direction, camera.forward);
+    return cos_theta > 0.0 ? 1.0 / (camera.viewport_area * cos_theta * cos_theta * cos_theta) : 0.0;
+}
+
+// Pixel whose camera rays go through p, false if p is behind the camera or outside the image
+bool bdpt_camera_project(bdpt_camera camera, vec3 p, out ivec2 pixel)
+{
+    vec3 d = p - camera.position;
+    float depth = dot(d, camera.forward);
+    if (depth <= 0.0)
+    {
+        return false;
+    }
+
+    vec3 q = camera.position + d * (camera.focus_dist / depth) - camera.viewport_upper_left;
+    vec2 f = vec2(dot(q, camera.pixel_delta_u) / dot(camera.pixel_delta_u, camera.pixel_delta_u),
+        dot(q, camera.pixel_delta_v) / dot(camera.pixel_delta_v, camera.pixel_delta_v));
+    pixel = ivec2(floor(f));
+    return all(greaterThanEqual(f, vec2(0.0))) && all(lessThan(pixel, camera.dim));
+}
+
+// Mirrors and dielectrics only have delta lobes, the other materials none
+bool bdpt_is_delta(material m)
+{
+    return material_roughness(m) == 0.0 && (m.type_parameter >> material_type_shift) != emissive_material_type;
+}
+
+// Converts a solid angle density at v to an area density at next
+float bdpt_area_density(float pdf, bdpt_vertex v, bdpt_vertex next)
+{
+    vec3 d = next.position - v.position;
+    float distance2 = dot(d, d);
+    if (next.type == bdpt_camera_vertex)
+    {
+        return pdf / distance2;
+    }
+
+    return pdf * abs(dot(next.normal, d)) * inversesqrt(distance2) / distance2;
+}
+
+// Area density of the cosine distributed emission of a light vertex reaching next
+float bdpt_emission_pdf(bdpt_vertex v, bdpt_vertex next)
+{
+    vec3 direction = normalize(next.position - v.position);
+    return bdpt_area_density(max(dot(v.normal, direction), 0.0) / pi, v, next);
+}
+
+// Area density of v sampling next, the ray having arrived at v from prev. 0 through delta lobes.
+float bdpt_pdf(scene_info scene, bdpt_camera camera, bdpt_vertex prev, bdpt_vertex v, bdpt_vertex next)
+{
+    vec3 direction = normalize(next.position - v.position);
+    if (v.type == bdpt_camera_vertex)
+    {
+        return bdpt_area_density(bdpt_camera_pdf(camera, direction), v, next);
+    }
+
+    if (v.type == bdpt_light_vertex)
+    {
+        return bdpt_emission_pdf(v, next);
+    }
+
+    if (v.is_delta)
+    {
+        return 0.0;
+    }
+
+    material m = MaterialArray(scene.materials).materials[v.material_idx];
+    float pdf = evaluate_bsdf(m, v.normal, normalize(v.position - prev.position), direction).pdf;
+    return bdpt_area_density(pdf, v, next);
+}
+
+// Area density of a light subpath starting at the emitter point v, 0 if its sphere isn't in the light hierarchy
+float bdpt_light_origin_pdf(scene_info scene, bdpt_vertex v, float time)
+{
+    if (v.sphere == no_hit_sphere || scene.lights_count == 0)
+    {
+        return 0.0;
+    }
+
+    float radius = load_sphere_at(scene, v.sphere, time).w;
+    return light_bvh_power_pmf(scene, v.sphere) / (4.0 * pi * radius * radius);
+}
+
+// Area density of the light sample of x picking the emitter point y, like sample_sphere_lights does
+float bdpt_light_sample_pdf(scene_info scene, bdpt_vertex x, bdpt_vertex y, float time)
+{
+    if (y.sphere == no_hit_sphere || scene.lights_count == 0)
+    {
+        return 0.0;
+    }
+
+    float pdf = light_bvh_pmf(scene, x.position, x.normal, y.sphere) *
+        sphere_light_pdf(load_sphere_at(scene, y.sphere, time), x.position);
+    return bdpt_area_density(pdf, x, y);
+}
+
+float bdpt_remap0(float pdf)
+{
+    return pdf != 0.0 ? pdf : 1.0;
+}
+
+// Vertex k of the full path of the strategy with s light and t camera vertices, from the emitter (k = 0) to the
+// camera (k = s + t - 1)
+bdpt_vertex bdpt_path_vertex(uint k, uint s, uint t)
+{
+    if (k < s)
+    {
+        return s == 1 ? bdpt_sampled_light : bdpt_light_vertices[k];
+    }
+
+    return bdpt_camera_vertices[s + t - 1 - k];
+}
+
+// Power heuristic weight of the strategy with s light and t camera vertices against all the strategies that can
+// produce the same path: its squared density over the sum of theirs. The densities of the strategies differ
+// by the vertices on either side of their connections, the weight follows their ratios from s outwards.
+float bdpt_mis_weight(scene_info scene, bdpt_camera camera, uint s, uint t, float time)
+{
+    uint n = s + t - 1;
+    if (n == 1)
+    {
+        return 1.0;
+    }
+
+    // Densities of the vertices sampled by the light and by the camera strategies
+    float light_pdfs[2 * bdpt_max_vertices];
+    float camera_pdfs[2 * bdpt_max_vertices];
+    bool delta[2 * bdpt_max_vertices];
+    for (uint k = 0; k <= n; ++k)
+    {
+        bdpt_vertex v = bdpt_path_vertex(k, s, t);
+        light_pdfs[k] = k < s ? v.pdf_fwd : v.pdf_rev;
+        camera_pdfs[k] = k < s ? v.pdf_rev : v.pdf_fwd;
+        delta[k] = v.is_delta;
+    }
+
+    // The connection decides the densities of its vertices and of their neighbours on the other side
+    bdpt_vertex pt = bdpt_camera_vertices[t - 1];
+    if (s > 0)
+    {
+        bdpt_vertex qs = bdpt_path_vertex(s - 1, s, t);
+        camera_pdfs[s - 1] = bdpt_pdf(scene, camera, t > 1 ? bdpt_camera_vertices[t - 2] : pt, pt, qs);
+        if (s > 1)
+        {
+            camera_pdfs[s - 2] = bdpt_pdf(scene, camera, pt, qs, bdpt_light_vertices[s - 2]);
+        }
+
+        light_pdfs[s] = s > 1 ? bdpt_pdf(scene, camera, bdpt_light_vertices[s - 2], qs, pt) : bdpt_emission_pdf(qs, pt);
+        if (t > 1)
+        {
+            light_pdfs[s + 1] = bdpt_pdf(scene, camera, qs, pt, bdpt_camera_vertices[t - 2]);
+        }
+    }
+    else
+    {
+        light_pdfs[0] = bdpt_light_origin_pdf(scene, pt, time);
+        light_pdfs[1] = bdpt_emission_pdf(pt, bdpt_camera_vertices[t - 2]);
+        delta[0] = false;
+    }
+
+    // The emitter point comes from the camera subpath without light vertex, from the light sample with one,
+    // from the light subpath with more
+    float origin_pdf = light_pdfs[0];
+    float sample_pdf = bdpt_light_sample_pdf(scene, bdpt_path_vertex(1, s, t), bdpt_path_vertex(0, s, t), time);
+    float emitter_pdfs[3] = float[3](bdpt_remap0(camera_pdfs[0]), sample_pdf, origin_pdf);
+    float emitter_pdf = emitter_pdfs[min(s, 2u)];
+    if (emitter_pdf <= 0.0)
+    {
+        return 0.0;
+    }
+
+    float sum = 1.0;
+    float ratio = 1.0;
+    for (uint sp = s + 1; sp <= n; ++sp)
+    {
+        // Vertex sp - 1 moves to the light subpath
+        if (sp > 1)
+        {
+            ratio *= bdpt_remap0(light_pdfs[sp - 1]) / bdpt_remap0(camera_pdfs[sp - 1]);
+        }
+
+        bool valid = sp <= bdpt_max_vertices && n + 1 - sp <= bdpt_max_vertices && emitter_pdfs[min(sp, 2u)] > 0.0 &&
+            !delta[sp - 1] && (sp == n || !delta[sp]);
+        if (valid)
+        {
+            float r = ratio * emitter_pdfs[min(sp, 2u)] / emitter_pdf;
+            sum += r * r;
+        }
+    }
+
+    ratio = 1.0;
+    for (uint sp = s; sp-- > 0;)
+    {
+        // Vertex sp moves to the camera subpath
+        if (sp > 0)
+        {
+            ratio *= bdpt_remap0(camera_pdfs[sp]) / bdpt_remap0(light_pdfs[sp]);
+        }
+
+        bool valid = n + 1 - sp <= bdpt_max_vertices &&
+            (sp == 0 || (emitter_pdfs[min(sp, 2u)] > 0.0 && !delta[sp - 1] && !delta[sp]));
+        if (valid)
+        {
+            float r = ratio * emitter_pdfs[min(sp, 2u)] / emitter_pdf;
+            sum += r * r;
+        }
+    }
+
+    return 1.0 / sum;
+}
+
+// True if nothing is between the points a and b
+bool bdpt_visible(scene_info scene, vec3 a, vec3 b, float time)
+{
+    vec3 d = b - a;
+    float distance = length(d);
+    vec3 direction = d / distance;
+    raycast_result result;
+    uint hit_sphere;
+    return raycast_scene(scene, ray(a + direction * 0.0001f, direction, time), result, hit_sphere) >= distance - 0.0002f;
+}
+
+// Extends the subpath whose first vertices are in the camera or the light vertices by tracing r, sampled with the
+// solid angle density pdf (0 for delta lobes). Returns the vertices count. Camera subpaths end on emitters, and
+// when they leave the scene the environment light they find is added to radiance.
+uint bdpt_random_walk(scene_info scene, bool camera_subpath, uint count, ray r, vec3 throughput, float pdf,
+    uint max_vertices, inout uint state, inout vec3 radiance)
+{
+    bdpt_vertex prev = camera_subpath ? bdpt_camera_vertices[count - 1] : bdpt_light_vertices[count - 1];
+    while (count < max_vertices)
+    {
+        raycast_result result;
+        uint hit_sphere;
+        if (raycast_scene(scene, r, result, hit_sphere) == infinity)
+        {
+            if (camera_subpath)
+            {
+                // Weighted against the environment light samples of the previous vertex
+                float mis_weight = 1.0;
+                if (pdf > 0.0 && prev.type == bdpt_surface_vertex && has_environment_map(scene))
+                {
+                    mis_weight = mis_power_heuristic(pdf, environment_pdf(scene, r.direction));
+                }
+
+                radiance += throughput * environment_radiance(scene, r.direction) * mis_weight;
+            }
+
+            break;
+        }
+
+        if (hit_sphere != no_hit_sphere)
+        {
+            result.material_idx = load_sphere_material_idx(scene, hit_sphere);
+        }
+
+        material m = MaterialArray(scene.materials).materials[result.material_idx];
+        bool emissive = (m.type_parameter >> material_type_shift) == emissive_material_type;
+        if (emissive && !camera_subpath)
+        {
+            break;
+        }
+
+        bdpt_vertex v;
+        v.position = result.point;
+        v.normal = result.normal;
+        v.direction = r.direction;
+        v.throughput = throughput;
+        v.type = bdpt_surface_vertex;
+        v.material_idx = result.material_idx;
+        v.sphere = hit_sphere;
+        v.pdf_fwd = bdpt_area_density(pdf, prev, v);
+        v.pdf_rev = 0.0;
+        v.is_delta = bdpt_is_delta(m);
+        v.front_face = result.front_face;
+
+        bsdf_sample bsdf;
+        bool scattered = !emissive && sample_bsdf(m, result.normal, result.front_face, r.direction, state, bsdf);
+        if (scattered)
+        {
+            // Density of the reverse bounce, sampling prev from v
+            float pdf_rev = bsdf.is_delta ? 0.0 : evaluate_bsdf(m, result.normal, -bsdf.direction, -r.direction).pdf;
+            prev.pdf_rev = bdpt_area_density(pdf_rev, v, prev);
+            if (camera_subpath)
+            {
+                bdpt_camera_vertices[count - 1].pdf_rev = prev.pdf_rev;
+            }
+            else
+            {
+                bdpt_light_vertices[count - 1].pdf_rev = prev.pdf_rev;
+            }
+        }
+
+        if (camera_subpath)
+        {
+            bdpt_camera_vertices[count] = v;
+        }
+        else
+        {
+            bdpt_light_vertices[count] = v;
+        }
+
+        ++count;
+        if (!scattered)
+        {
+            break;
+        }
+
+        throughput *= bsdf.weight;
+        pdf = bsdf.is_delta ? 0.0 : bsdf.pdf;
+        prev = v;
+        r = ray(result.point + bsdf.direction * 0.0001f, bsdf.direction, r.time);
+    }
+
+    return count;
+}
+
+// Light subpath from a point of an emissive sphere picked in proportion to their power, returns its vertices count
+uint bdpt_trace_light_subpath(scene_info scene, float time, uint max_vertices, inout uint state)
+{
+    uint light_idx;
+    float light_pmf;
+    if (scene.lights_count == 0 || !sample_light_bvh_power(scene, state, light_idx, light_pmf))
+    {
+        return 0;
+    }
+
+    uint sphere = LightArray(scene.lights).lights[light_idx].sphere;
+    vec4 s = load_sphere_at(scene, sphere, time);
+    uint material_idx = load_sphere_material_idx(scene, sphere);
+
+    bdpt_vertex v;
+    v.normal = random_unit_vector(state);
+    v.position = s.xyz + s.w * v.normal;
+    v.direction = vec3(0.0);
+    v.type = bdpt_light_vertex;
+    v.material_idx = material_idx;
+    v.sphere = sphere;
+    v.pdf_fwd = light_pmf / (4.0 * pi * s.w * s.w);
+    v.pdf_rev = 0.0;
+    v.is_delta = false;
+    v.front_face = true;
+    v.throughput = MaterialArray(scene.materials).materials[material_idx].albedo / v.pdf_fwd;
+    bdpt_light_vertices[0] = v;
+
+    vec3 local_direction = sample_cosine_hemisphere(random2(state));
+    vec3 direction = to_world(make_frame(v.normal), local_direction);
+    float pdf = local_direction.z / pi;
+    if (pdf <= 0.0)
+    {
+        return 1;
+    }
+
+    // Le * cos / (pdf_position * pdf_direction)
+    vec3 unused_radiance = vec3(0.0);
+    return bdpt_random_walk(scene, false, 1, ray(v.position + direction * 0.0001f, direction, time),
+        v.throughput * pi, pdf, max_vertices, state, unused_radiance);
+}
+
+// Adds a light subpath contribution to the fixed point sums of a pixel, rounded up or down at random so that the
+// sums stay unbiased
+void bdpt_splat(uvec2 splats, ivec2 pixel, uint width, vec3 value, inout uint state)
+{
+    BdptSplatArray values = BdptSplatArray(splats);
+    uint base = 3 * (uint(pixel.y) * width + uint(pixel.x));
+    for (uint c = 0; c < 3; ++c)
+    {
+        float units = value[c] * float(bdpt_fixed_point_scale) + random(state);
+        if (units >= 1.0)
+        {
+            atomicAdd(values.values[base + c], uint(min(units, float(bdpt_max_splat))));
+        }
+    }
+}
+
+// Radiance of a camera ray through the viewport, the light tracing strategies are splatted to the pixels they
+// project to when splats isn't 0. samples_count camera rays are traced per pixel and pass, each one with a light
+// subpath.
+vec3 bdpt_sample(scene_info scene, bdpt_camera camera, ray r, uint max_depth, uint samples_count, uvec2 splats,
+    inout uint state)
+{
+    vec3 radiance = vec3(0.0);
+
+    bdpt_vertex camera_vertex;
+    camera_vertex.position = camera.position;
+    camera_vertex.normal = camera.forward;
+    camera_vertex.direction = camera.forward;
+    camera_vertex.throughput = vec3(1.0);
+    camera_vertex.type = bdpt_camera_vertex;
+    camera_vertex.material_idx = 0;
+    camera_vertex.sphere = no_hit_sphere;
+    camera_vertex.pdf_fwd = 1.0;
+    camera_vertex.pdf_rev = 0.0;
+    camera_vertex.is_delta = false;
+    camera_vertex.front_face = true;
+    bdpt_camera_vertices[0] = camera_vertex;
+
+    // Paths have at most max_depth segments, like the rays of the path integrator
+    uint max_vertices = min(bdpt_max_vertices, max_depth + 1);
+    uint camera_count = bdpt_random_walk(scene, true, 1, r, vec3(1.0), bdpt_camera_pdf(camera, r.direction),
+        max_vertices, state, radiance);
+    uint light_count = bdpt_trace_light_subpath(scene, r.time, min(bdpt_max_vertices, max_depth), state);
+
+    for (uint t = 1; t <= camera_count; ++t)
+    {
+        bdpt_vertex pt = bdpt_camera_vertices[t - 1];
+        material pt_material = MaterialArray(scene.materials).materials[pt.material_idx];
+
+        // The camera subpath hit an emitter
+        if (t > 1 && (pt_material.type_parameter >> material_type_shift) == emissive_material_type)
+        {
+            if (pt.front_face)
+            {
+                radiance += pt.throughput * pt_material.albedo * bdpt_mis_weight(scene, camera, 0, t, r.time);
+            }
+
+            continue;
+        }
+
+        if (t > 1 && !pt.is_delta)
+        {
+            // Environment light sample, weighted against the camera subpath leaving the scene from pt
+            if (t < max_vertices && has_environment_map(scene))
+            {
+                float light_pdf;
+                vec3 light_direction = sample_environment(scene, state, light_pdf);
+                bsdf_eval bsdf = evaluate_bsdf(pt_material, pt.normal, pt.direction, light_direction);
+                raycast_result shadow_result;
+                uint shadow_sphere;
+                if (light_pdf > 0.0 && bsdf.pdf > 0.0 &&
+                    raycast_scene(scene, ray(pt.position + light_direction * 0.0001f, light_direction, r.time), shadow_result, shadow_sphere) == infinity)
+                {
+                    radiance += pt.throughput * bsdf.value * environment_radiance(scene, light_direction) *
+                        mis_power_heuristic(light_pdf, bsdf.pdf) / light_pdf;
+                }
+            }
+
+            // Emissive sphere light sample, a single light vertex
+            uint light_idx;
+            float light_pmf;
+            if (t <= max_depth && scene.lights_count != 0 &&
+                sample_light_bvh(scene, pt.position, pt.normal, state, light_idx, light_pmf))
+            {
+                uint light_sphere = LightArray(scene.lights).lights[light_idx].sphere;
+                vec3 light_direction;
+                float cone_pdf;
+                raycast_result shadow_result;
+                uint shadow_sphere;
+                if (sample_sphere_light(load_sphere_at(scene, light_sphere, r.time), pt.position, random2(state), light_direction, cone_pdf) &&
+                    raycast_scene(scene, ray(pt.position + light_direction * 0.0001f, light_direction, r.time), shadow_result, shadow_sphere) != infinity &&
+                    shadow_sphere == light_sphere && shadow_result.front_face)
+                {
+                    bdpt_vertex y;
+                    y.position = shadow_result.point;
+                    y.normal = shadow_result.normal;
+                    y.direction = vec3(0.0);
+                    y.type = bdpt_light_vertex;
+                    y.material_idx = load_sphere_material_idx(scene, light_sphere);
+                    y.sphere = light_sphere;
+                    y.pdf_rev = 0.0;
+                    y.is_delta = false;
+                    y.front_face = true;
+                    y.pdf_fwd = bdpt_light_origin_pdf(scene, y, r.time);
+                    y.throughput = vec3(0.0);
+                    bdpt_sampled_light = y;
+
+                    vec3 emitted = MaterialArray(scene.materials).materials[y.material_idx].albedo;
+                    vec3 f = evaluate_bsdf(pt_material, pt.normal, pt.direction, light_direction).value;
+                    if (f != vec3(0.0))
+                    {
+                        radiance += pt.throughput * f * emitted / (light_pmf * cone_pdf) *
+                            bdpt_mis_weight(scene, camera, 1, t, r.time);
+                    }
+                }
+            }
+        }
+
+        if (pt.is_delta)
+        {
+            continue;
+        }
+
+        for (uint s = 2; s <= light_count; ++s)
+        {
+            if (s + t - 1 > max_depth)
+            {
+                break;
+            }
+
+            bdpt_vertex qs = bdpt_light_vertices[s - 1];
+            if (qs.is_delta)
+            {
+                continue;
+            }
+
+            material qs_material = MaterialArray(scene.materials).materials[qs.material_idx];
+            vec3 d = pt.position - qs.position;
+            float distance2 = dot(d, d);
+            vec3 to_pt = d * inversesqrt(distance2);
+
+            if (t == 1)
+            {
+                // Light tracing: the light subpath seen by the camera
+                ivec2 pixel;
+                if (splats == uvec2(0) || !bdpt_camera_project(camera, qs.position, pixel))
+                {
+                    continue;
+                }
+
+                vec3 f = evaluate_bsdf(qs_material, qs.normal, qs.direction, to_pt).value;
+                if (f == vec3(0.0) || !bdpt_visible(scene, qs.position, pt.position, r.time))
+                {
+                    continue;
+                }
+
+                // Importance of the camera over the density of its rays through the pixel, We * cos / d^2
+                vec3 contribution = qs.throughput * f * bdpt_camera_pdf(camera, -to_pt) / distance2;
+                bdpt_splat(splats, pixel, uint(camera.dim.x), contribution * bdpt_mis_weight(scene, camera, s, t, r.time) / float(samples_count), state);
+                continue;
+            }
+
+            vec3 f_qs = evaluate_bsdf(qs_material, qs.normal, qs.direction, to_pt).value;
+            vec3 f_pt = evaluate_bsdf(pt_material, pt.normal, pt.direction, -to_pt).value;
+            if (f_qs == vec3(0.0) || f_pt == vec3(0.0) || !bdpt_visible(scene, pt.position, qs.position, r.time))
+            {
+                continue;
+            }
+
+            radiance += qs.throughput * f_qs * f_pt * pt.throughput / distance2 * bdpt_mis_weight(scene, camera, s, t, r.time);
+        }
+    }
+
+    return radiance;
+}
@@ -0,0 +1,277 @@
+// Importance sampled BSDFs of the material types. Needs scene.glsl (materials and random numbers).
+//
+// Directions are in a local frame around the shading normal, which faces the incoming ray: wo (towards where the
+// ray came from) has a positive z. Sampling returns the new direction, its pdf and the weight f * cos / pdf the
+// path throughput is multiplied by. Non delta lobes can also be evaluated for a given direction, for MIS.
+
+// Below this roughness metals are perfect mirrors, GGX is numerically unusable
+const float bsdf_min_roughness = 0.02;
+
+struct bsdf_sample
+{
+    vec3 direction;
+    // f * cos / pdf
+    vec3 weight;
+    // Solid angle density for lobes that aren't delta distributions, otherwise the probability of the chosen lobe
+    float pdf;
+    bool is_delta;
+};
+
+struct bsdf_eval
+{
+    // f * cos
+    vec3 value;
+    float pdf;
+};
+
+struct frame
+{
+    vec3 t;
+    vec3 b;
+    vec3 n;
+};
+
+// Orthonormal basis around a unit vector (Duff et al. 2017)
+frame make_frame(vec3 n)
+{
+    float s = n.z >= 0.0 ? 1.0 : -1.0;
+    float a = -1.0 / (s + n.z);
+    float b = n.x * n.y * a;
+
+    frame f;
+    f.t = vec3(1.0 + s * n.x * n.x * a, s * b, -s * n.x);
+    f.b = vec3(b, s + n.y * n.y * a, -n.y);
+    f.n = n;
+    return f;
+}
+
+vec3 to_local(frame f, vec3 v)
+{
+    return vec3(dot(v, f.t), dot(v, f.b), dot(v, f.n));
+}
+
+vec3 to_world(frame f, vec3 v)
+{
+    return v.x * f.t + v.y * f.b + v.z * f.n;
+}
+
+// Weight of a sample of strategy a when strategy b could have produced it too (Veach 1997)
+float mis_power_heuristic(float pdf_a, float pdf_b)
+{
+    float a2 = pdf_a * pdf_a;
+    float b2 = pdf_b * pdf_b;
+    return a2 > 0.0 ? a2 / (a2 + b2) : 0.0;
+}
+
+// Lambertian
+
+vec3 sample_cosine_hemisphere(vec2 u)
+{
+    float r = sqrt(u.x);
+    float phi = 2.0 * pi * u.y;
+    return vec3(r * cos(phi), r * sin(phi), sqrt(max(0.0, 1.0 - u.x)));
+}
+
+bsdf_eval eval_lambertian(vec3 albedo, vec3 wi)
+{
+    bsdf_eval e;
+    float cos_theta = max(wi.z, 0.0);
+    e.value = albedo * cos_theta / pi;
+    e.pdf = cos_theta / pi;
+    return e;
+}
+
+// GGX metal, Fresnel of a conductor approximated by Schlick with the albedo at normal incidence
+
+vec3 fresnel_schlick(vec3 f0, float cos_theta)
+{
+    float m = 1.0 - clamp(cos_theta, 0.0, 1.0);
+    float m2 = m * m;
+    return f0 + (1.0 - f0) * (m2 * m2 * m);
+}
+
+float ggx_d(vec3 m, float alpha)
+{
+    float a2 = alpha * alpha;
+    float d = (a2 - 1.0) * m.z * m.z + 1.0;
+    return a2 / (pi * d * d);
+}
+
+// Smith Lambda of the GGX distribution
+float ggx_lambda(vec3 w, float alpha)
+{
+    float cos2 = w.z * w.z;
+    float tan2 = max(1.0 - cos2, 0.0) / max(cos2, 1e-8);
+    return 0.5 * (sqrt(1.0 + alpha * alpha * tan2) - 1.0);
+}
+
+// Microfacet normal distributed like the normals visible from wo (Heitz 2018)
+vec3 sample_ggx_vndf(vec3 wo, float alpha, vec2 u)
+{
+    vec3 vh = normalize(vec3(alpha * wo.x, alpha * wo.y, wo.z));
+    float length2 = vh.x * vh.x + vh.y * vh.y;
+    vec3 t1 = length2 > 0.0 ? vec3(-vh.y, vh.x, 0.0) * inversesqrt(length2) : vec3(1.0, 0.0, 0.0);
+    vec3 t2 = cross(vh, t1);
+
+    float r = sqrt(u.x);
+    float phi = 2.0 * pi * u.y;
+    float p1 = r * cos(phi);
+    float p2 = r * sin(phi);
+    float s = 0.5 * (1.0 + vh.z);
+    p2 = (1.0 - s) * sqrt(max(0.0, 1.0 - p1 * p1)) + s * p2;
+
+    vec3 nh = p1 * t1 + p2 * t2 + sqrt(max(0.0, 1.0 - p1 * p1 - p2 * p2)) * vh;
+    return normalize(vec3(alpha * nh.x, alpha * nh.y, max(0.0, nh.z)));
+}
+
+bsdf_eval eval_ggx(vec3 f0, float alpha, vec3 wo, vec3 wi)
+{
+    bsdf_eval e;
+    e.value = vec3(0.0);
+    e.pdf = 0.0;
+    if (wi.z <= 0.0 || wo.z <= 0.0)
+    {
+        return e;
+    }
+
+    vec3 m = normalize(wo + wi);
+    float d = ggx_d(m, alpha);
+    float lambda_o = ggx_lambda(wo, alpha);
+    float g2 = 1.0 / (1.0 + lambda_o + ggx_lambda(wi, alpha));
+
+    e.value = fresnel_schlick(f0, dot(wo, m)) * d * g2 / (4.0 * wo.z);
+    // Visible normals pdf G1(wo) * D(m) * dot(wo, m) / wo.z, times the reflection jacobian 1 / (4 * dot(wo, m))
+    e.pdf = d / ((1.0 + lambda_o) * 4.0 * wo.z);
+    return e;
+}
+
+// Dielectric
+
+// Unpolarized Fresnel reflectance, eta is the ratio of the refraction indices of the incident and transmitted sides
+float fresnel_dielectric(float cos_i, float eta)
+{
+    float sin2_t = eta * eta * max(0.0, 1.0 - cos_i * cos_i);
+    if (sin2_t >= 1.0)
+    {
+        return 1.0;
+    }
+
+    float cos_t = sqrt(1.0 - sin2_t);
+    float rs = (eta * cos_i - cos_t) / (eta * cos_i + cos_t);
+    float rp = (cos_i - eta * cos_t) / (cos_i + eta * cos_t);
+    return 0.5 * (rs * rs + rp * rp);
+}
+
+// Throughput weight and direction of a bounce off the material. normal faces the incoming ray, front_face tells
+// whether the ray comes from outside the surface. False if the path is absorbed.
+bool sample_bsdf(material m, vec3 normal, bool front_face, vec3 direction, inout uint state, out bsdf_sample s)
+{
+    uint type = m.type_parameter >> material_type_shift;
+    // Roughness (metal) or refraction index (dielectric)
+    float parameter = unpackHalf2x16(m.type_parameter).x;
+
+    // Emitters don't reflect
+    if (type == emissive_material_type)
+    {
+        return false;
+    }
+
+    frame f = make_frame(normal);
+    vec3 wo = to_local(f, -direction);
+    wo.z = max(wo.z, 1e-6);
+
+    if (type == lambertian_material_type)
+    {
+        vec3 wi = sample_cosine_hemisphere(random2(state));
+        s.direction = to_world(f, wi);
+        s.weight = m.albedo;
+        s.pdf = wi.z / pi;
+        s.is_delta = false;
+        return wi.z > 0.0;
+    }
+
+    if (type == metal_material_type)
+    {
+        if (parameter < bsdf_min_roughness)
+        {
+            s.direction = reflect(direction, normal);
+            s.weight = fresnel_schlick(m.albedo, wo.z);
+            s.pdf = 1.0;
+            s.is_delta = true;
+            return true;
+        }
+
+        float alpha = parameter * parameter;
+        vec3 h = sample_ggx_vndf(wo, alpha, random2(state));
+        vec3 wi = reflect(-wo, h);
+        if (wi.z <= 0.0)
+        {
+            return false;
+        }
+
+        // f * cos / pdf reduces to F * G2 / G1(wo)
+        float lambda_o = ggx_lambda(wo, alpha);
+        s.direction = to_world(f, wi);
+        s.weight = fresnel_schlick(m.albedo, dot(wo, h)) * (1.0 + lambda_o) / (1.0 + lambda_o + ggx_lambda(wi, alpha));
+        s.pdf = eval_ggx(m.albedo, alpha, wo, wi).pdf;
+        s.is_delta = false;
+        return true;
+    }
+
+    // Dielectric: reflection or refraction picked with the Fresnel reflectance as probability, the weight is 1
+    float eta = front_face ? 1.0 / parameter : parameter;
+    float reflectance = fresnel_dielectric(wo.z, eta);
+    s.weight = vec3(1.0);
+    s.is_delta = true;
+    if (random(state) < reflectance)
+    {
+        s.direction = reflect(direction, normal);
+        s.pdf = reflectance;
+    }
+    else
+    {
+        s.direction = refract(direction, normal, eta);
+        s.pdf = 1.0 - reflectance;
+    }
+
+    return true;
+}
+
+// 1 for Lambertian materials, the GGX roughness of metals, 0 for mirrors, dielectrics and emitters
+float material_roughness(material m)
+{
+    uint type = m.type_parameter >> material_type_shift;
+    float parameter = unpackHalf2x16(m.type_parameter).x;
+    if (type == lambertian_material_type)
+    {
+        return 1.0;
+    }
+
+    return type == metal_material_type && parameter >= bsdf_min_roughness ? parameter : 0.0;
+}
+
+// f * cos and pdf of the material for a direction wi, zero for the delta lobes
+bsdf_eval evaluate_bsdf(material m, vec3 normal, vec3 direction, vec3 wi_world)
+{
+    uint type = m.type_parameter >> material_type_shift;
+    float parameter = unpackHalf2x16(m.type_parameter).x;
+
+    frame f = make_frame(normal);
+    vec3 wo = to_local(f, -direction);
+    vec3 wi = to_local(f, wi_world);
+
+    if (type == lambertian_material_type)
+    {
+        return eval_lambertian(m.albedo, wi);
+    }
+
+    if (type == metal_material_type && parameter >= bsdf_min_roughness)
+    {
+        return eval_ggx(m.albedo, parameter * parameter, wo, wi);
+    }
+
+    bsdf_eval e;
+    e.value = vec3(0.0);
+    e.pdf = 0.0;
+    return e;
+}
@@ -1,4 +1,28 @@
 "%VULKAN_SDK%\bin\glslc.exe" texture.vert -o texture.vert.spv
 "%VULKAN_SDK%\bin\glslc.exe" texture.frag -o texture.frag.spv
-"%VULKAN_SDK%\bin\glslc.exe" raytracing.comp -o raytracing.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 raytracing.comp -o raytracing.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 animate_spheres.comp -o animate_spheres.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 lbvh_bounds.comp -o lbvh_bounds.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 lbvh_morton.comp -o lbvh_morton.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 lbvh_sort_histogram.comp -o lbvh_sort_histogram.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 lbvh_sort_scan.comp -o lbvh_sort_scan.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 lbvh_sort_scatter.comp -o lbvh_sort_scatter.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 lbvh_hierarchy.comp -o lbvh_hierarchy.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 lbvh_refit.comp -o lbvh_refit.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 grid_bounds.comp -o grid_bounds.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 grid_setup.comp -o grid_setup.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 grid_count.comp -o grid_count.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 grid_scan_blocks.comp -o grid_scan_blocks.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 grid_scan_block_sums.comp -o grid_scan_block_sums.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 grid_scan_add.comp -o grid_scan_add.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 grid_fill.comp -o grid_fill.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 restir_initial.comp -o restir_initial.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 restir_temporal.comp -o restir_temporal.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 restir_spatial.comp -o restir_spatial.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 radiance_cache_resolve.comp -o radiance_cache_resolve.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 guiding_build.comp -o guiding_build.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 bdpt_resolve.comp -o bdpt_resolve.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 wavefront_generate.comp -o wavefront_generate.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 wavefront_extend.comp -o wavefront_extend.comp.spv
+"%VULKAN_SDK%\bin\glslc.exe" --target-env=vulkan1.2 wavefront_accumulate.comp -o wavefront_accumulate.comp.spv
 pause
\ No newline at end of file
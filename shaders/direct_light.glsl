@@ -0,0 +1,69 @@
+// Next event estimation of the path integrator, shared by raytracing.comp and the wavefront passes. Needs
+// scene.glsl, raycast.glsl, bsdf.glsl, environment.glsl, lights.glsl and guiding.glsl.
+//
+// The light samples are weighted against the sampling of the bounce, which mixes in the guiding distribution of
+// guiding_entry when it has one (guiding_capacity without path guiding).
+
+// Next event estimation: light coming from a direction picked in the environment map, if the shadow ray leaves
+// the scene. Weighted against BSDF sampling with the power heuristic, delta lobes get nothing.
+vec3 sample_environment_light(scene_info scene, ray r, raycast_result result, material m, guiding_info guiding,
+    uint guiding_entry, inout uint state)
+{
+    float light_pdf;
+    vec3 light_direction = sample_environment(scene, state, light_pdf);
+    bsdf_eval bsdf = evaluate_bsdf(m, result.normal, r.direction, light_direction);
+    if (light_pdf <= 0.0 || bsdf.pdf <= 0.0)
+    {
+        return vec3(0.0);
+    }
+
+    raycast_result shadow_result;
+    uint shadow_sphere;
+    if (raycast_scene(scene, ray(result.point + light_direction * 0.0001f, light_direction, r.time), shadow_result, shadow_sphere) != infinity)
+    {
+        return vec3(0.0);
+    }
+
+    float bounce_pdf = guided_bsdf_pdf(guiding, guiding_entry, light_direction, bsdf.pdf);
+    return bsdf.value * environment_radiance(scene, light_direction) * mis_power_heuristic(light_pdf, bounce_pdf) / light_pdf;
+}
+
+// Next event estimation: light coming from a point of an emissive sphere picked with the light hierarchy, if the
+// shadow ray hits that sphere first. Weighted against BSDF sampling like the environment light samples.
+vec3 sample_sphere_lights(scene_info scene, ray r, raycast_result result, material m, guiding_info guiding,
+    uint guiding_entry, inout uint state)
+{
+    uint light_idx;
+    float light_pmf;
+    if (!sample_light_bvh(scene, result.point, result.normal, state, light_idx, light_pmf))
+    {
+        return vec3(0.0);
+    }
+
+    uint light_sphere = LightArray(scene.lights).lights[light_idx].sphere;
+    vec3 light_direction;
+    float cone_pdf;
+    if (!sample_sphere_light(load_sphere_at(scene, light_sphere, r.time), result.point, random2(state), light_direction, cone_pdf))
+    {
+        return vec3(0.0);
+    }
+
+    bsdf_eval bsdf = evaluate_bsdf(m, result.normal, r.direction, light_direction);
+    if (bsdf.pdf <= 0.0)
+    {
+        return vec3(0.0);
+    }
+
+    raycast_result shadow_result;
+    uint shadow_sphere;
+    raycast_scene(scene, ray(result.point + light_direction * 0.0001f, light_direction, r.time), shadow_result, shadow_sphere);
+    if (shadow_sphere != light_sphere || !shadow_result.front_face)
+    {
+        return vec3(0.0);
+    }
+
+    float light_pdf = light_pmf * cone_pdf;
+    vec3 emitted = MaterialArray(scene.materials).materials[load_sphere_material_idx(scene, light_sphere)].albedo;
+    float bounce_pdf = guided_bsdf_pdf(guiding, guiding_entry, light_direction, bsdf.pdf);
+    return bsdf.value * emitted * mis_power_heuristic(light_pdf, bounce_pdf) / light_pdf;
+}
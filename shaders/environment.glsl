@@ -0,0 +1,90 @@
+// Light of the rays leaving the scene: the equirectangular environment map of the scene, or a sky gradient
+// without one. Needs scene.glsl.
+//
+// The map is sampled with the alias table built by EnvironmentMap: a pixel is picked in constant time with a
+// probability proportional to its luminance times its solid angle, then a direction uniformly within the pixel.
+
+layout(buffer_reference, scalar, buffer_reference_align = 8) readonly buffer EnvironmentPixelArray
+{
+    uvec2 pixels[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer EnvironmentAliasArray
+{
+    environment_alias_entry entries[];
+};
+
+bool has_environment_map(scene_info scene)
+{
+    return scene.environment_width != 0;
+}
+
+// Row 0 of the map is +Y, u goes around the Y axis
+vec2 environment_direction_to_uv(vec3 direction)
+{
+    float u = atan(direction.z, direction.x) / (2.0 * pi) + 0.5;
+    float v = acos(clamp(direction.y, -1.0, 1.0)) / pi;
+    return vec2(u, v);
+}
+
+vec3 environment_uv_to_direction(vec2 uv)
+{
+    float phi = (uv.x - 0.5) * 2.0 * pi;
+    float theta = uv.y * pi;
+    float sin_theta = sin(theta);
+    return vec3(sin_theta * cos(phi), cos(theta), sin_theta * sin(phi));
+}
+
+uint environment_pixel_idx(scene_info scene, vec2 uv)
+{
+    uvec2 size = uvec2(scene.environment_width, scene.environment_height);
+    uvec2 pixel = min(uvec2(uv * vec2(size)), size - 1);
+    return pixel.y * size.x + pixel.x;
+}
+
+vec3 environment_radiance(scene_info scene, vec3 direction)
+{
+    if (!has_environment_map(scene))
+    {
+        vec3 unit_direction = normalize(direction);
+        float a = 0.5 * (unit_direction.y + 1.0);
+        return (1.0 - a) * vec3(1.0, 1.0, 1.0) + a * vec3(0.5, 0.7, 1.0);
+    }
+
+    uvec2 packed = EnvironmentPixelArray(scene.environment_pixels).pixels[environment_pixel_idx(scene, environment_direction_to_uv(direction))];
+    return vec3(unpackHalf2x16(packed.x), unpackHalf2x16(packed.y).x);
+}
+
+// Solid angle density of sample_environment for a direction. The pixel probability is spread uniformly over
+// the pixel in uv, the equirectangular mapping stretches uv by 2 * pi^2 * sin(theta).
+float environment_pdf(scene_info scene, vec3 direction)
+{
+    vec2 uv = environment_direction_to_uv(direction);
+    float sin_theta = sqrt(max(0.0, 1.0 - direction.y * direction.y));
+    if (sin_theta <= 0.0)
+    {
+        return 0.0;
+    }
+
+    float pixel_pdf = EnvironmentAliasArray(scene.environment_alias_table).entries[environment_pixel_idx(scene, uv)].pdf;
+    float pixels_count = float(scene.environment_width * scene.environment_height);
+    return pixel_pdf * pixels_count / (2.0 * pi * pi * sin_theta);
+}
+
+// Map only
+vec3 sample_environment(scene_info scene, inout uint state, out float pdf)
+{
+    // Separate numbers for the entry and the choice with its alias, large maps leave few bits of a single one for the latter
+    uint idx = random_below(state, scene.environment_width * scene.environment_height);
+
+    environment_alias_entry entry = EnvironmentAliasArray(scene.environment_alias_table).entries[idx];
+    if (random(state) >= entry.threshold)
+    {
+        idx = entry.alias;
+    }
+
+    vec2 pixel = vec2(idx % scene.environment_width, idx / scene.environment_width) + random2(state);
+    vec3 direction = environment_uv_to_direction(pixel / vec2(scene.environment_width, scene.environment_height));
+    pdf = environment_pdf(scene, direction);
+    return direction;
+}
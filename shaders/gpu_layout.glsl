@@ -0,0 +1,509 @@
+// Generated by gpulayoutgen from src/base/GpuLayout.h, do not edit.
+// Blocks using these structs need the scalar layout (GL_EXT_scalar_block_layout).
+// <STRUCT>_MEMBERS lists the members of a struct to declare a uniform or push constant block with them.
+
+const uint packed_scene_encoding = 0u;
+const uint quantized_scene_encoding = 1u;
+const uint sphere_chunk_size = 256u;
+const uint material_type_shift = 16u;
+const uint lambertian_material_type = 0u;
+const uint metal_material_type = 1u;
+const uint dielectric_material_type = 2u;
+const uint emissive_material_type = 3u;
+const uint linear_scene_acceleration = 0u;
+const uint lbvh_scene_acceleration = 1u;
+const uint grid_scene_acceleration = 2u;
+const uint wide_bvh_scene_acceleration = 3u;
+const uint bvh_leaf_flag = 2147483648u;
+const uint bvh_stack_size = 64u;
+const uint lbvh_block_size = 256u;
+const uint lbvh_radix_bits = 4u;
+const uint grid_workgroup_size = 256u;
+const uint grid_scan_block_size = 1024u;
+const uint grid_max_cells_per_sphere = 8u;
+const uint wide_bvh_width = 8u;
+const uint wide_bvh_child_valid = 128u;
+const uint wide_bvh_leaf_count_shift = 5u;
+const uint wide_bvh_offset_mask = 31u;
+const uint wide_bvh_max_leaf_spheres = 3u;
+const uint wide_bvh_stack_size = 64u;
+const uint light_bvh_leaf_flag = 2147483648u;
+const uint restir_workgroup_size = 8u;
+const uint restir_candidates_count = 8u;
+const uint restir_spatial_neighbours = 5u;
+const uint restir_spatial_radius = 30u;
+const uint restir_max_history = 20u;
+const uint restir_no_light = 4294967295u;
+const uint radiance_cache_capacity = 1048576u;
+const uint radiance_cache_bucket_size = 8u;
+const uint radiance_cache_workgroup_size = 256u;
+const uint radiance_cache_fixed_point_scale = 256u;
+const uint radiance_cache_min_samples = 8u;
+const uint radiance_cache_max_samples = 128u;
+const uint radiance_cache_max_age = 64u;
+const uint radiance_cache_training_ratio = 8u;
+const uint radiance_cache_path_vertices = 4u;
+const uint guiding_capacity = 65536u;
+const uint guiding_bucket_size = 8u;
+const uint guiding_resolution = 8u;
+const uint guiding_bins = 64u;
+const uint guiding_workgroup_size = 256u;
+const uint guiding_min_samples = 32u;
+const uint guiding_fixed_point_scale = 64u;
+const uint guiding_path_vertices = 4u;
+const uint path_integrator = 0u;
+const uint bidirectional_integrator = 1u;
+const uint tile_order_row_major = 0u;
+const uint tile_order_strips = 1u;
+const uint tile_order_morton = 2u;
+const uint tile_order_hilbert = 3u;
+const uint bdpt_max_vertices = 8u;
+const uint bdpt_fixed_point_scale = 1024u;
+const uint bdpt_max_splat = 1048576u;
+const uint bdpt_workgroup_size = 8u;
+const uint wavefront_workgroup_size = 256u;
+const uint wavefront_path_active = 1u;
+const uint wavefront_path_bsdf_delta = 2u;
+const uint wavefront_no_pixel = 4294967295u;
+const uint ray_sort_key_bits = 24u;
+const uint ray_sort_ended_key = 16777215u;
+
+#define PACKED_SPHERE_MEMBERS \
+    vec3 center; /* offset 0 */ \
+    float radius; /* offset 12 */
+
+// 16 bytes
+struct packed_sphere
+{
+    PACKED_SPHERE_MEMBERS
+};
+
+#define QUANTIZED_SPHERE_MEMBERS \
+    uint xy; /* offset 0 */ \
+    uint zr; /* offset 4 */
+
+// 8 bytes
+struct quantized_sphere
+{
+    QUANTIZED_SPHERE_MEMBERS
+};
+
+#define SPHERE_CHUNK_MEMBERS \
+    vec3 origin; /* offset 0 */ \
+    vec3 extent; /* offset 12 */ \
+    float max_radius; /* offset 24 */
+
+// 28 bytes
+struct sphere_chunk
+{
+    SPHERE_CHUNK_MEMBERS
+};
+
+#define MATERIAL_MEMBERS \
+    vec3 albedo; /* offset 0 */ \
+    uint type_parameter; /* offset 12 */
+
+// 16 bytes
+struct material
+{
+    MATERIAL_MEMBERS
+};
+
+#define PLANE_MEMBERS \
+    vec3 normal; /* offset 0 */ \
+    float distance; /* offset 12 */ \
+    uint material_idx; /* offset 16 */
+
+// 20 bytes
+struct plane
+{
+    PLANE_MEMBERS
+};
+
+#define QUAD_MEMBERS \
+    vec3 origin; /* offset 0 */ \
+    uint material_idx; /* offset 12 */ \
+    vec3 edge_u; /* offset 16 */ \
+    vec3 edge_v; /* offset 28 */
+
+// 40 bytes
+struct quad
+{
+    QUAD_MEMBERS
+};
+
+#define BOX_MEMBERS \
+    vec3 bounds_min; /* offset 0 */ \
+    uint material_idx; /* offset 12 */ \
+    vec3 bounds_max; /* offset 16 */
+
+// 28 bytes
+struct box
+{
+    BOX_MEMBERS
+};
+
+#define SPHERE_FIELD_MEMBERS \
+    vec3 bounds_min; /* offset 0 */ \
+    float cell_size; /* offset 12 */ \
+    uvec3 resolution; /* offset 16 */ \
+    uint seed; /* offset 28 */ \
+    float density; /* offset 32 */ \
+    float radius_min; /* offset 36 */ \
+    float radius_max; /* offset 40 */ \
+    uint material_idx; /* offset 44 */
+
+// 48 bytes
+struct sphere_field
+{
+    SPHERE_FIELD_MEMBERS
+};
+
+#define ENVIRONMENT_ALIAS_ENTRY_MEMBERS \
+    float threshold; /* offset 0 */ \
+    uint alias; /* offset 4 */ \
+    float pdf; /* offset 8 */
+
+// 12 bytes
+struct environment_alias_entry
+{
+    ENVIRONMENT_ALIAS_ENTRY_MEMBERS
+};
+
+#define LIGHT_BVH_NODE_MEMBERS \
+    vec3 bounds_min; /* offset 0 */ \
+    float power; /* offset 12 */ \
+    vec3 bounds_max; /* offset 16 */ \
+    float cos_theta_o; /* offset 28 */ \
+    vec3 axis; /* offset 32 */ \
+    float cos_theta_e; /* offset 44 */ \
+    uint child; /* offset 48 */
+
+// 52 bytes
+struct light_bvh_node
+{
+    LIGHT_BVH_NODE_MEMBERS
+};
+
+#define LIGHT_MEMBERS \
+    uvec2 bit_trail; /* offset 0 */ \
+    uint sphere; /* offset 8 */
+
+// 12 bytes
+struct light
+{
+    LIGHT_MEMBERS
+};
+
+#define BVH_NODE_MEMBERS \
+    vec3 bounds_min; /* offset 0 */ \
+    uint left_child; /* offset 12 */ \
+    vec3 bounds_max; /* offset 16 */ \
+    uint right_child; /* offset 28 */
+
+// 32 bytes
+struct bvh_node
+{
+    BVH_NODE_MEMBERS
+};
+
+#define MOTION_BOUNDS_MEMBERS \
+    vec3 bounds_min; /* offset 0 */ \
+    vec3 bounds_max; /* offset 12 */
+
+// 24 bytes
+struct motion_bounds
+{
+    MOTION_BOUNDS_MEMBERS
+};
+
+#define WIDE_BVH_NODE_MEMBERS \
+    vec3 origin; /* offset 0 */ \
+    uint exponents; /* offset 12 */ \
+    uint child_base; /* offset 16 */ \
+    uint sphere_base; /* offset 20 */ \
+    uvec2 meta; /* offset 24 */ \
+    uvec2 low_x; /* offset 32 */ \
+    uvec2 low_y; /* offset 40 */ \
+    uvec2 low_z; /* offset 48 */ \
+    uvec2 high_x; /* offset 56 */ \
+    uvec2 high_y; /* offset 64 */ \
+    uvec2 high_z; /* offset 72 */
+
+// 80 bytes
+struct wide_bvh_node
+{
+    WIDE_BVH_NODE_MEMBERS
+};
+
+#define GRID_INFO_MEMBERS \
+    vec3 bounds_min; /* offset 0 */ \
+    uint large_spheres_count; /* offset 12 */ \
+    vec3 bounds_max; /* offset 16 */ \
+    vec3 cell_size; /* offset 28 */ \
+    uvec3 resolution; /* offset 40 */
+
+// 52 bytes
+struct grid_info
+{
+    GRID_INFO_MEMBERS
+};
+
+#define SCENE_INFO_MEMBERS \
+    uvec2 sphere_geometry; /* offset 0 */ \
+    uvec2 sphere_materials; /* offset 8 */ \
+    uvec2 sphere_chunks; /* offset 16 */ \
+    uvec2 materials; /* offset 24 */ \
+    uvec2 sphere_motion; /* offset 32 */ \
+    uvec2 bvh_nodes; /* offset 40 */ \
+    uvec2 bvh_leaves; /* offset 48 */ \
+    uvec2 bvh_motion_bounds; /* offset 56 */ \
+    uvec2 grid_info; /* offset 64 */ \
+    uvec2 grid_cells; /* offset 72 */ \
+    uvec2 grid_references; /* offset 80 */ \
+    uvec2 grid_large_spheres; /* offset 88 */ \
+    uvec2 wide_bvh_nodes; /* offset 96 */ \
+    uvec2 planes; /* offset 104 */ \
+    uvec2 quads; /* offset 112 */ \
+    uvec2 boxes; /* offset 120 */ \
+    uvec2 sphere_fields; /* offset 128 */ \
+    uvec2 environment_pixels; /* offset 136 */ \
+    uvec2 environment_alias_table; /* offset 144 */ \
+    uvec2 light_bvh_nodes; /* offset 152 */ \
+    uvec2 lights; /* offset 160 */ \
+    uint spheres_count; /* offset 168 */ \
+    uint encoding; /* offset 172 */ \
+    uint acceleration; /* offset 176 */ \
+    uint planes_count; /* offset 180 */ \
+    uint quads_count; /* offset 184 */ \
+    uint boxes_count; /* offset 188 */ \
+    uint sphere_fields_count; /* offset 192 */ \
+    uint has_sphere_motion; /* offset 196 */ \
+    uint environment_width; /* offset 200 */ \
+    uint environment_height; /* offset 204 */ \
+    uint lights_count; /* offset 208 */ \
+    uint padding; /* offset 212 */
+
+// 216 bytes
+struct scene_info
+{
+    SCENE_INFO_MEMBERS
+};
+
+#define COMPUTE_UNIFORMS_MEMBERS \
+    vec3 camera_position; /* offset 0 */ \
+    float aspect_ratio; /* offset 12 */ \
+    vec3 camera_direction; /* offset 16 */ \
+    float defocus_angle; /* offset 28 */ \
+    float focus_dist; /* offset 32 */ \
+    uint samples_per_pixel; /* offset 36 */ \
+    uint max_depth; /* offset 40 */ \
+    uint tile_offset; /* offset 44 */ \
+    uint tiles_count; /* offset 48 */ \
+    uint accumulated_passes; /* offset 52 */ \
+    uint accumulate; /* offset 56 */
+
+// 60 bytes
+struct compute_uniforms
+{
+    COMPUTE_UNIFORMS_MEMBERS
+};
+
+#define COMPUTE_PUSH_CONSTANTS_MEMBERS \
+    uvec2 scene; /* offset 0 */ \
+    uvec2 restir_reservoirs; /* offset 8 */ \
+    uvec2 radiance_cache; /* offset 16 */ \
+    uvec2 guiding; /* offset 24 */ \
+    uvec2 bdpt_splats; /* offset 32 */ \
+    uvec2 bdpt_light; /* offset 40 */ \
+    uvec2 wavefront_paths; /* offset 48 */ \
+    uvec2 wavefront_queue; /* offset 56 */ \
+    uvec2 wavefront_sort_keys; /* offset 64 */ \
+    uint wavefront_paths_count; /* offset 72 */ \
+    uint wavefront_tile_width; /* offset 76 */ \
+    uint wavefront_tile_height; /* offset 80 */ \
+    uint wavefront_sample; /* offset 84 */ \
+    uvec2 trace_counters; /* offset 88 */ \
+    uint lane_statistics; /* offset 96 */ \
+    uint padding; /* offset 100 */
+
+// 104 bytes
+struct compute_push_constants
+{
+    COMPUTE_PUSH_CONSTANTS_MEMBERS
+};
+
+#define TRACE_COUNTERS_MEMBERS \
+    uint next_work; /* offset 0 */ \
+    uint busy_lanes; /* offset 4 */ \
+    uint lanes; /* offset 8 */
+
+// 12 bytes
+struct trace_counters
+{
+    TRACE_COUNTERS_MEMBERS
+};
+
+#define WAVEFRONT_PATH_MEMBERS \
+    vec3 origin; /* offset 0 */ \
+    float time; /* offset 12 */ \
+    vec3 direction; /* offset 16 */ \
+    float bsdf_pdf; /* offset 28 */ \
+    vec3 throughput; /* offset 32 */ \
+    uint state; /* offset 44 */ \
+    vec3 radiance; /* offset 48 */ \
+    uint pixel; /* offset 60 */ \
+    vec3 bsdf_point; /* offset 64 */ \
+    uint flags; /* offset 76 */ \
+    vec3 bsdf_normal; /* offset 80 */
+
+// 92 bytes
+struct wavefront_path
+{
+    WAVEFRONT_PATH_MEMBERS
+};
+
+#define LBVH_PUSH_CONSTANTS_MEMBERS \
+    uvec2 scene; /* offset 0 */ \
+    uvec2 bounds; /* offset 8 */ \
+    uvec2 keys_in; /* offset 16 */ \
+    uvec2 values_in; /* offset 24 */ \
+    uvec2 keys_out; /* offset 32 */ \
+    uvec2 values_out; /* offset 40 */ \
+    uvec2 histogram; /* offset 48 */ \
+    uvec2 parents; /* offset 56 */ \
+    uvec2 visits; /* offset 64 */ \
+    uint count; /* offset 72 */ \
+    uint shift; /* offset 76 */
+
+// 80 bytes
+struct lbvh_push_constants
+{
+    LBVH_PUSH_CONSTANTS_MEMBERS
+};
+
+#define GRID_PUSH_CONSTANTS_MEMBERS \
+    uvec2 scene; /* offset 0 */ \
+    uvec2 bounds; /* offset 8 */ \
+    uvec2 block_sums; /* offset 16 */ \
+    uint count; /* offset 24 */ \
+    uint cells_capacity; /* offset 28 */
+
+// 32 bytes
+struct grid_push_constants
+{
+    GRID_PUSH_CONSTANTS_MEMBERS
+};
+
+#define ANIMATION_PUSH_CONSTANTS_MEMBERS \
+    uvec2 scene; /* offset 0 */ \
+    float delta_time; /* offset 8 */ \
+    float angular_speed; /* offset 12 */
+
+// 16 bytes
+struct animation_push_constants
+{
+    ANIMATION_PUSH_CONSTANTS_MEMBERS
+};
+
+#define RESTIR_RESERVOIR_MEMBERS \
+    uint light; /* offset 0 */ \
+    uint direction; /* offset 4 */ \
+    float weight; /* offset 8 */ \
+    float candidates_count; /* offset 12 */
+
+// 16 bytes
+struct restir_reservoir
+{
+    RESTIR_RESERVOIR_MEMBERS
+};
+
+#define RESTIR_SURFACE_MEMBERS \
+    float distance; /* offset 0 */ \
+    uint normal; /* offset 4 */ \
+    uint material_idx; /* offset 8 */
+
+// 12 bytes
+struct restir_surface
+{
+    RESTIR_SURFACE_MEMBERS
+};
+
+#define RESTIR_PUSH_CONSTANTS_MEMBERS \
+    uvec2 scene; /* offset 0 */ \
+    uvec2 surfaces; /* offset 8 */ \
+    uvec2 previous_surfaces; /* offset 16 */ \
+    uvec2 reservoirs; /* offset 24 */ \
+    uvec2 previous_reservoirs; /* offset 32 */ \
+    uvec2 final_reservoirs; /* offset 40 */ \
+    vec3 camera_position; /* offset 48 */ \
+    float aspect_ratio; /* offset 60 */ \
+    vec3 camera_direction; /* offset 64 */ \
+    uint width; /* offset 76 */ \
+    vec3 previous_camera_position; /* offset 80 */ \
+    uint height; /* offset 92 */ \
+    vec3 previous_camera_direction; /* offset 96 */ \
+    uint frame; /* offset 108 */ \
+    uint history_valid; /* offset 112 */ \
+    uint padding; /* offset 116 */
+
+// 120 bytes
+struct restir_push_constants
+{
+    RESTIR_PUSH_CONSTANTS_MEMBERS
+};
+
+#define RADIANCE_CACHE_ENTRY_MEMBERS \
+    uint key; /* offset 0 */ \
+    uint age; /* offset 4 */ \
+    uint frame_red; /* offset 8 */ \
+    uint frame_green; /* offset 12 */ \
+    uint frame_blue; /* offset 16 */ \
+    uint frame_samples; /* offset 20 */ \
+    vec3 radiance; /* offset 24 */ \
+    uint samples; /* offset 36 */
+
+// 40 bytes
+struct radiance_cache_entry
+{
+    RADIANCE_CACHE_ENTRY_MEMBERS
+};
+
+#define RADIANCE_CACHE_PUSH_CONSTANTS_MEMBERS \
+    uvec2 entries; /* offset 0 */
+
+// 8 bytes
+struct radiance_cache_push_constants
+{
+    RADIANCE_CACHE_PUSH_CONSTANTS_MEMBERS
+};
+
+#define GUIDING_CELL_MEMBERS \
+    uint key; /* offset 0 */ \
+    uint samples; /* offset 4 */
+
+// 8 bytes
+struct guiding_cell
+{
+    GUIDING_CELL_MEMBERS
+};
+
+#define GUIDING_INFO_MEMBERS \
+    uvec2 cells; /* offset 0 */ \
+    uvec2 histograms; /* offset 8 */ \
+    uvec2 distributions; /* offset 16 */
+
+// 24 bytes
+struct guiding_info
+{
+    GUIDING_INFO_MEMBERS
+};
+
+#define GUIDING_PUSH_CONSTANTS_MEMBERS \
+    uvec2 info; /* offset 0 */
+
+// 8 bytes
+struct guiding_push_constants
+{
+    GUIDING_PUSH_CONSTANTS_MEMBERS
+};
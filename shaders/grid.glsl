@@ -0,0 +1,37 @@
+// Shared by the grid build passes (see GridBuilder)
+
+#include "scene.glsl"
+#include "ordered_float.glsl"
+
+layout(local_size_x = grid_workgroup_size) in;
+
+layout(push_constant, scalar) uniform PushConstants
+{
+    GRID_PUSH_CONSTANTS_MEMBERS
+} push_constants;
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer UintArray
+{
+    uint values[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer WritableGridInfo
+{
+    grid_info grid;
+};
+
+// Cells overlapped by the bounds of a sphere, moving spheres are referenced by every cell they go through
+void grid_sphere_cells(scene_info scene, grid_info grid, uint idx, out uvec3 first, out uvec3 last)
+{
+    vec3 bounds_min, bounds_max;
+    load_sphere_swept_bounds(scene, idx, bounds_min, bounds_max);
+    first = grid_cell_coords(grid, bounds_min);
+    last = grid_cell_coords(grid, bounds_max);
+}
+
+// Spheres overlapping too many cells are tested by every ray instead
+bool is_large_sphere(uvec3 first, uvec3 last)
+{
+    uvec3 size = last - first + 1;
+    return size.x * size.y * size.z > grid_max_cells_per_sphere;
+}
@@ -0,0 +1,201 @@
+// Path guiding (after Muller et al. 2017, on a hash grid instead of an SD-tree). Needs scene.glsl, hash_grid.glsl
+// and bsdf.glsl.
+//
+// Every cell of a hash grid learns how the light arriving at the rough surfaces in it is spread over the
+// directions: paths add estimates of the incident light of the directions they bounce in to a histogram of the
+// cell, turned into the sampled distribution at the end of each training iteration (see PathGuiding). Bounces
+// off rough surfaces then sample either the BSDF or the distribution of their cell, and are weighted with the
+// pdf of the mixture (one sample MIS).
+
+layout(buffer_reference, scalar, buffer_reference_align = 8) readonly buffer GuidingInfoRef
+{
+    guiding_info info;
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer GuidingCellArray
+{
+    guiding_cell cells[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer GuidingHistogramArray
+{
+    uint values[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer GuidingDistributionArray
+{
+    float cdf[];
+};
+
+// Side of the cells over their distance to the camera, about 32 pixels of the 2048 pixels wide compute target
+const float guiding_cell_angle = 1.0 / 32.0;
+
+// Glossier lobes are already narrower than the distributions
+const float guiding_min_roughness = 0.5;
+
+// Probability of sampling the distribution of the cell rather than the BSDF
+const float guiding_probability = 0.5;
+
+// Share of the distributions spread uniformly over the directions, for the light the training missed
+const float guiding_uniform_fraction = 0.2;
+
+// Training estimates are clamped so the fixed point sums of an iteration don't overflow
+const float guiding_max_estimate = 1024.0;
+
+hash_grid_cell guiding_find_cell(vec3 p, vec3 n, vec3 camera_position)
+{
+    return hash_grid_find_cell(p, n, camera_position, guiding_cell_angle, guiding_capacity, guiding_bucket_size);
+}
+
+// Entry of the cell, guiding_capacity if it isn't in the grid. insert takes a free entry for a new cell, unless
+// its bucket is full.
+uint guiding_cell_entry(guiding_info info, hash_grid_cell cell, bool insert)
+{
+    GuidingCellArray cells = GuidingCellArray(info.cells);
+    for (uint i = 0; i < guiding_bucket_size; ++i)
+    {
+        uint idx = cell.bucket + i;
+        uint key = insert ? atomicCompSwap(cells.cells[idx].key, 0u, cell.key) : cells.cells[idx].key;
+        if (key == cell.key || (insert && key == 0u))
+        {
+            return idx;
+        }
+    }
+
+    return guiding_capacity;
+}
+
+// Equal area bins: cos theta from the vertical axis along the rows, phi along the columns
+uint guiding_direction_bin(vec3 w)
+{
+    vec2 uv = vec2(0.5 * (w.y + 1.0), atan(w.z, w.x) / (2.0 * pi) + 0.5);
+    uvec2 bin = min(uvec2(uv * float(guiding_resolution)), uvec2(guiding_resolution - 1));
+    return bin.x * guiding_resolution + bin.y;
+}
+
+// Uniform in the bin
+vec3 guiding_bin_direction(uint bin, vec2 u)
+{
+    float cos_theta = (float(bin / guiding_resolution) + u.x) / float(guiding_resolution) * 2.0 - 1.0;
+    float phi = ((float(bin % guiding_resolution) + u.y) / float(guiding_resolution) - 0.5) * 2.0 * pi;
+    float sin_theta = sqrt(max(0.0, 1.0 - cos_theta * cos_theta));
+    return vec3(sin_theta * cos(phi), cos_theta, sin_theta * sin(phi));
+}
+
+bool guiding_has_distribution(guiding_info info, uint entry)
+{
+    return entry < guiding_capacity &&
+        GuidingDistributionArray(info.distributions).cdf[entry * guiding_bins + guiding_bins - 1] > 0.0;
+}
+
+// Solid angle density of sample_guiding, the bins cover 4 pi / guiding_bins each
+float guiding_pdf(guiding_info info, uint entry, vec3 w)
+{
+    GuidingDistributionArray distributions = GuidingDistributionArray(info.distributions);
+    uint bin = guiding_direction_bin(w);
+    uint base = entry * guiding_bins;
+    float probability = distributions.cdf[base + bin] - (bin > 0 ? distributions.cdf[base + bin - 1] : 0.0);
+    return probability * float(guiding_bins) / (4.0 * pi);
+}
+
+vec3 sample_guiding(guiding_info info, uint entry, inout uint state, out float pdf)
+{
+    GuidingDistributionArray distributions = GuidingDistributionArray(info.distributions);
+    uint base = entry * guiding_bins;
+
+    // First bin whose cumulative probability is above u
+    float u = random(state);
+    uint low = 0;
+    uint high = guiding_bins - 1;
+    while (low < high)
+    {
+        uint middle = (low + high) / 2;
+        if (distributions.cdf[base + middle] <= u)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    vec3 w = guiding_bin_direction(low, random2(state));
+    pdf = guiding_pdf(info, entry, w);
+    return w;
+}
+
+// Density of sample_guided_bsdf for a direction of pdf bsdf_pdf under the BSDF, what the light samples of the
+// vertex are weighted against
+float guided_bsdf_pdf(guiding_info info, uint entry, vec3 w, float bsdf_pdf)
+{
+    if (!guiding_has_distribution(info, entry))
+    {
+        return bsdf_pdf;
+    }
+
+    return guiding_probability * guiding_pdf(info, entry, w) + (1.0 - guiding_probability) * bsdf_pdf;
+}
+
+// sample_bsdf mixed with the distribution of the entry, if it has one. The weight and pdf of the sample are the
+// ones of the mixture.
+bool sample_guided_bsdf(guiding_info info, uint entry, material m, vec3 normal, bool front_face, vec3 direction,
+    inout uint state, out bsdf_sample s)
+{
+    if (!guiding_has_distribution(info, entry))
+    {
+        return sample_bsdf(m, normal, front_face, direction, state, s);
+    }
+
+    vec3 f_cos;
+    float bsdf_pdf;
+    float distribution_pdf;
+    if (random(state) < guiding_probability)
+    {
+        s.direction = sample_guiding(info, entry, state, distribution_pdf);
+        s.is_delta = false;
+        bsdf_eval e = evaluate_bsdf(m, normal, direction, s.direction);
+        // Directions below the surface carry no light
+        if (e.value == vec3(0.0))
+        {
+            return false;
+        }
+
+        f_cos = e.value;
+        bsdf_pdf = e.pdf;
+    }
+    else
+    {
+        if (!sample_bsdf(m, normal, front_face, direction, state, s))
+        {
+            return false;
+        }
+
+        if (s.is_delta)
+        {
+            return true;
+        }
+
+        f_cos = s.weight * s.pdf;
+        bsdf_pdf = s.pdf;
+        distribution_pdf = guiding_pdf(info, entry, s.direction);
+    }
+
+    s.pdf = guiding_probability * distribution_pdf + (1.0 - guiding_probability) * bsdf_pdf;
+    s.weight = f_cos / s.pdf;
+    return s.pdf > 0.0;
+}
+
+// Adds an estimate of the light arriving at the cell of the entry from the directions of a bin: the luminance of
+// the light found along a sampled direction over its pdf
+void guiding_train(guiding_info info, uint entry, uint bin, float estimate)
+{
+    if (isnan(estimate) || estimate <= 0.0)
+    {
+        estimate = 0.0;
+    }
+
+    uint fixed_point = uint(min(estimate, guiding_max_estimate) * float(guiding_fixed_point_scale));
+    atomicAdd(GuidingHistogramArray(info.histograms).values[entry * guiding_bins + bin], fixed_point);
+    atomicAdd(GuidingCellArray(info.cells).cells[entry].samples, 1u);
+}
@@ -0,0 +1,32 @@
+// Cells of the world space hash grids of the radiance cache and of the path guiding. Needs scene.glsl.
+//
+// Cells are cubes whose side grows with their distance to the camera, so they cover about as many pixels
+// anywhere in the image, split by the dominant axis of the surface normal. A cell hashes to a bucket of entries
+// searched linearly, a second hash tells it apart from the other cells of the bucket.
+
+struct hash_grid_cell
+{
+    // First entry of the bucket
+    uint bucket;
+    uint key;
+};
+
+// cell_angle is the side of the cells over their distance to the camera
+hash_grid_cell hash_grid_find_cell(vec3 p, vec3 n, vec3 camera_position, float cell_angle, uint capacity, uint bucket_size)
+{
+    // Power of two sides, the exponent tells apart the cells of different sizes
+    int size_exponent = int(ceil(log2(max(distance(p, camera_position) * cell_angle, 1e-6))));
+    ivec3 coords = ivec3(floor(p / exp2(float(size_exponent))));
+
+    vec3 a = abs(n);
+    uint axis = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+    uint side = axis * 2 + (n[axis] < 0.0 ? 1 : 0);
+
+    uint h = pcg_hash(uint(coords.x) ^ pcg_hash(uint(coords.y) ^ pcg_hash(uint(coords.z) ^ pcg_hash(uint(size_exponent) * 6 + side))));
+
+    hash_grid_cell cell;
+    cell.bucket = (h % (capacity / bucket_size)) * bucket_size;
+    // 0 marks the free entries
+    cell.key = max(pcg_hash(h ^ 0x9E3779B9u), 1u);
+    return cell;
+}
@@ -0,0 +1,38 @@
+// Shared by the LBVH build passes (see LbvhBuilder).
+// Every pass runs workgroups of lbvh_block_size invocations, one element per invocation.
+
+#include "scene.glsl"
+#include "ordered_float.glsl"
+
+layout(local_size_x = lbvh_block_size) in;
+
+layout(push_constant, scalar) uniform PushConstants
+{
+    LBVH_PUSH_CONSTANTS_MEMBERS
+} push_constants;
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer UintArray
+{
+    uint values[];
+};
+
+// Written and read by different workgroups of the same dispatch
+layout(buffer_reference, scalar, buffer_reference_align = 4) coherent buffer CoherentUintArray
+{
+    uint values[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 16) coherent buffer CoherentBvhNodeArray
+{
+    bvh_node nodes[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) coherent buffer CoherentMotionBoundsArray
+{
+    motion_bounds bounds[];
+};
+
+const uint invalid_node = 0xFFFFFFFFu;
+
+// Digit values of a radix sort pass
+const uint radix_size = 1u << lbvh_radix_bits;
@@ -0,0 +1,276 @@
+// Emissive spheres sampled through the light hierarchy built by LightBvh. Needs scene.glsl and bsdf.glsl.
+//
+// A light is picked by walking down from the root, choosing each child with a probability proportional to its
+// importance: its power over the squared distance, reduced by the angles between its emission cone and the
+// shaded point and between the surface normal and the node. Then a direction is picked uniformly within the
+// cone the sphere subtends from the point.
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer LightBvhNodeArray
+{
+    light_bvh_node nodes[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer LightArray
+{
+    light lights[];
+};
+
+// cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of the angles
+float cos_sub_clamped(float sin_a, float cos_a, float sin_b, float cos_b)
+{
+    return cos_a > cos_b ? 1.0 : cos_a * cos_b + sin_a * sin_b;
+}
+
+float sin_sub_clamped(float sin_a, float cos_a, float sin_b, float cos_b)
+{
+    return cos_a > cos_b ? 0.0 : sin_a * cos_b - cos_a * sin_b;
+}
+
+// Same as LightBvh::Importance
+float light_importance(light_bvh_node node, vec3 p, vec3 n)
+{
+    vec3 center = 0.5 * (node.bounds_min + node.bounds_max);
+    vec3 half_diagonal = 0.5 * (node.bounds_max - node.bounds_min);
+    float radius2 = dot(half_diagonal, half_diagonal);
+    vec3 d = p - center;
+    float distance2 = dot(d, d);
+
+    // Directions from the node to p, within theta b of wi. Points inside the bounding sphere see it everywhere.
+    vec3 wi = distance2 > 0.0 ? d * inversesqrt(distance2) : vec3(0.0, 0.0, 1.0);
+    float sin_theta_b = 0.0;
+    float cos_theta_b = -1.0;
+    if (distance2 > radius2)
+    {
+        sin_theta_b = sqrt(radius2 / distance2);
+        cos_theta_b = sqrt(max(0.0, 1.0 - radius2 / distance2));
+    }
+
+    // Smallest angle between an emission direction and a direction to p
+    float cos_theta_w = dot(node.axis, wi);
+    float sin_theta_w = sqrt(max(0.0, 1.0 - cos_theta_w * cos_theta_w));
+    float sin_theta_o = sqrt(max(0.0, 1.0 - node.cos_theta_o * node.cos_theta_o));
+    float cos_theta_x = cos_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, node.cos_theta_o);
+    float sin_theta_x = sin_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, node.cos_theta_o);
+    float cos_theta_p = cos_sub_clamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+    if (cos_theta_p <= node.cos_theta_e)
+    {
+        return 0.0;
+    }
+
+    // Clamped to the bounding sphere so the nodes around p don't get all the samples
+    float importance = node.power * cos_theta_p / max(distance2, radius2);
+
+    // Smallest angle between n and a direction to the lights
+    float cos_theta_i = -dot(wi, n);
+    float sin_theta_i = sqrt(max(0.0, 1.0 - cos_theta_i * cos_theta_i));
+    return importance * max(cos_sub_clamped(sin_theta_i, cos_theta_i, sin_theta_b, cos_theta_b), 0.0);
+}
+
+// Light picked for a point p of a surface facing n, and its probability. False if no light can reach the point.
+bool sample_light_bvh(scene_info scene, vec3 p, vec3 n, inout uint state, out uint light_idx, out float pmf)
+{
+    LightBvhNodeArray nodes = LightBvhNodeArray(scene.light_bvh_nodes);
+    uint node_idx = 0;
+    light_bvh_node node = nodes.nodes[0];
+    pmf = 1.0;
+    if (light_importance(node, p, n) <= 0.0)
+    {
+        return false;
+    }
+
+    while ((node.child & light_bvh_leaf_flag) == 0)
+    {
+        light_bvh_node first = nodes.nodes[node_idx + 1];
+        light_bvh_node second = nodes.nodes[node.child];
+        float first_importance = light_importance(first, p, n);
+        float second_importance = light_importance(second, p, n);
+        if (first_importance + second_importance <= 0.0)
+        {
+            return false;
+        }
+
+        float first_probability = first_importance / (first_importance + second_importance);
+        if (random(state) < first_probability)
+        {
+            node_idx = node_idx + 1;
+            node = first;
+            pmf *= first_probability;
+        }
+        else
+        {
+            node_idx = node.child;
+            node = second;
+            pmf *= 1.0 - first_probability;
+        }
+    }
+
+    light_idx = node.child & ~light_bvh_leaf_flag;
+    return true;
+}
+
+// Position of the light of sphere in the lights, sorted by sphere, lights_count if the sphere isn't a light
+uint find_light(scene_info scene, uint sphere)
+{
+    LightArray lights = LightArray(scene.lights);
+    uint low = 0;
+    uint high = scene.lights_count;
+    while (low < high)
+    {
+        uint middle = (low + high) / 2;
+        if (lights.lights[middle].sphere < sphere)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low < scene.lights_count && lights.lights[low].sphere == sphere ? low : scene.lights_count;
+}
+
+// Probability of sample_light_bvh picking the light of sphere for a point p of a surface facing n, 0 if the sphere
+// isn't a light. The path to its leaf is given by the bit trail of the light.
+float light_bvh_pmf(scene_info scene, vec3 p, vec3 n, uint sphere)
+{
+    uint light_idx = find_light(scene, sphere);
+    if (light_idx == scene.lights_count)
+    {
+        return 0.0;
+    }
+
+    uvec2 bit_trail = LightArray(scene.lights).lights[light_idx].bit_trail;
+    LightBvhNodeArray nodes = LightBvhNodeArray(scene.light_bvh_nodes);
+    uint node_idx = 0;
+    light_bvh_node node = nodes.nodes[0];
+    float pmf = 1.0;
+    if (light_importance(node, p, n) <= 0.0)
+    {
+        return 0.0;
+    }
+
+    for (uint depth = 0; (node.child & light_bvh_leaf_flag) == 0; ++depth)
+    {
+        light_bvh_node first = nodes.nodes[node_idx + 1];
+        light_bvh_node second = nodes.nodes[node.child];
+        float first_importance = light_importance(first, p, n);
+        float second_importance = light_importance(second, p, n);
+        if (first_importance + second_importance <= 0.0)
+        {
+            return 0.0;
+        }
+
+        bool take_second = (((depth < 32 ? bit_trail.x : bit_trail.y) >> (depth & 31)) & 1) != 0;
+        pmf *= (take_second ? second_importance : first_importance) / (first_importance + second_importance);
+        node_idx = take_second ? node.child : node_idx + 1;
+        node = take_second ? second : first;
+    }
+
+    return pmf;
+}
+
+// Light picked with probabilities proportional to the power of the nodes, wherever it is seen from: the emitter of
+// the light subpaths of the bidirectional integrator
+bool sample_light_bvh_power(scene_info scene, inout uint state, out uint light_idx, out float pmf)
+{
+    LightBvhNodeArray nodes = LightBvhNodeArray(scene.light_bvh_nodes);
+    uint node_idx = 0;
+    light_bvh_node node = nodes.nodes[0];
+    pmf = 1.0;
+    while ((node.child & light_bvh_leaf_flag) == 0)
+    {
+        light_bvh_node first = nodes.nodes[node_idx + 1];
+        light_bvh_node second = nodes.nodes[node.child];
+        if (first.power + second.power <= 0.0)
+        {
+            return false;
+        }
+
+        float first_probability = first.power / (first.power + second.power);
+        if (random(state) < first_probability)
+        {
+            node_idx = node_idx + 1;
+            node = first;
+            pmf *= first_probability;
+        }
+        else
+        {
+            node_idx = node.child;
+            node = second;
+            pmf *= 1.0 - first_probability;
+        }
+    }
+
+    light_idx = node.child & ~light_bvh_leaf_flag;
+    return pmf > 0.0;
+}
+
+// Probability of sample_light_bvh_power picking the light of sphere, 0 if the sphere isn't a light
+float light_bvh_power_pmf(scene_info scene, uint sphere)
+{
+    uint light_idx = find_light(scene, sphere);
+    if (light_idx == scene.lights_count)
+    {
+        return 0.0;
+    }
+
+    uvec2 bit_trail = LightArray(scene.lights).lights[light_idx].bit_trail;
+    LightBvhNodeArray nodes = LightBvhNodeArray(scene.light_bvh_nodes);
+    uint node_idx = 0;
+    light_bvh_node node = nodes.nodes[0];
+    float pmf = 1.0;
+    for (uint depth = 0; (node.child & light_bvh_leaf_flag) == 0; ++depth)
+    {
+        light_bvh_node first = nodes.nodes[node_idx + 1];
+        light_bvh_node second = nodes.nodes[node.child];
+        if (first.power + second.power <= 0.0)
+        {
+            return 0.0;
+        }
+
+        bool take_second = (((depth < 32 ? bit_trail.x : bit_trail.y) >> (depth & 31)) & 1) != 0;
+        pmf *= (take_second ? second.power : first.power) / (first.power + second.power);
+        node_idx = take_second ? node.child : node_idx + 1;
+        node = take_second ? second : first;
+    }
+
+    return pmf;
+}
+
+// 1 - cos of the half angle of the cone the sphere s subtends from p, 0 if p is inside. Computed from the squared
+// sine, small distant spheres would round the cosine to 1.
+float sphere_one_minus_cos_theta_max(vec4 s, vec3 p)
+{
+    vec3 d = s.xyz - p;
+    float sin2_theta_max = s.w * s.w / dot(d, d);
+    if (sin2_theta_max >= 1.0)
+    {
+        return 0.0;
+    }
+
+    return sin2_theta_max / (1.0 + sqrt(1.0 - sin2_theta_max));
+}
+
+// Direction from p to a uniform point of the cone subtended by the sphere s, and its solid angle density
+bool sample_sphere_light(vec4 s, vec3 p, vec2 u, out vec3 direction, out float pdf)
+{
+    float one_minus_cos_theta_max = sphere_one_minus_cos_theta_max(s, p);
+    if (one_minus_cos_theta_max <= 0.0)
+    {
+        return false;
+    }
+
+    float cos_theta = 1.0 - u.x * one_minus_cos_theta_max;
+    float sin_theta = sqrt(max(0.0, 1.0 - cos_theta * cos_theta));
+    float phi = 2.0 * pi * u.y;
+    direction = to_world(make_frame(normalize(s.xyz - p)), vec3(sin_theta * cos(phi), sin_theta * sin(phi), cos_theta));
+    pdf = 1.0 / (2.0 * pi * one_minus_cos_theta_max);
+    return true;
+}
+
+float sphere_light_pdf(vec4 s, vec3 p)
+{
+    float one_minus_cos_theta_max = sphere_one_minus_cos_theta_max(s, p);
+    return one_minus_cos_theta_max > 0.0 ? 1.0 / (2.0 * pi * one_minus_cos_theta_max) : 0.0;
+}
@@ -0,0 +1,11 @@
+// Unsigned integers with the same order as the floats, for atomicMin / atomicMax on floats
+uint float_to_ordered_uint(float f)
+{
+    uint u = floatBitsToUint(f);
+    return (u & 0x80000000u) != 0 ? ~u : (u | 0x80000000u);
+}
+
+float ordered_uint_to_float(uint u)
+{
+    return uintBitsToFloat((u & 0x80000000u) != 0 ? (u & 0x7FFFFFFFu) : ~u);
+}
@@ -0,0 +1,64 @@
+// World space radiance cache: a hash grid of the light leaving the rough surfaces, filled by the paths as they
+// are traced and resolved once per frame (see RadianceCache). Needs scene.glsl and hash_grid.glsl.
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer RadianceCacheEntryArray
+{
+    radiance_cache_entry entries[];
+};
+
+// Side of the cells over their distance to the camera, about 8 pixels of the 2048 pixels wide compute target
+const float radiance_cache_cell_angle = 1.0 / 128.0;
+
+// Below this roughness the light leaving a surface depends too much on its direction to be shared
+const float radiance_cache_min_roughness = 0.5;
+
+// Radiance of a single path is clamped so the fixed point sums of a frame don't overflow
+const float radiance_cache_max_radiance = 64.0;
+
+hash_grid_cell radiance_cache_find_cell(vec3 p, vec3 n, vec3 camera_position)
+{
+    return hash_grid_find_cell(p, n, camera_position, radiance_cache_cell_angle, radiance_cache_capacity, radiance_cache_bucket_size);
+}
+
+// Light leaving the cell, false while the cache doesn't know enough about it
+bool radiance_cache_lookup(uvec2 cache, hash_grid_cell cell, out vec3 radiance)
+{
+    RadianceCacheEntryArray entries = RadianceCacheEntryArray(cache);
+    for (uint i = 0; i < radiance_cache_bucket_size; ++i)
+    {
+        if (entries.entries[cell.bucket + i].key == cell.key)
+        {
+            radiance = entries.entries[cell.bucket + i].radiance;
+            return entries.entries[cell.bucket + i].samples >= radiance_cache_min_samples;
+        }
+    }
+
+    return false;
+}
+
+// Adds a sample of the light leaving the cell to the frame sums of its entry, taking a free one for a new cell.
+// Samples of the cells of full buckets are dropped.
+void radiance_cache_add(uvec2 cache, hash_grid_cell cell, vec3 radiance)
+{
+    if (any(isnan(radiance)))
+    {
+        return;
+    }
+
+    uvec3 fixed_point = uvec3(min(radiance, vec3(radiance_cache_max_radiance)) * float(radiance_cache_fixed_point_scale));
+
+    RadianceCacheEntryArray entries = RadianceCacheEntryArray(cache);
+    for (uint i = 0; i < radiance_cache_bucket_size; ++i)
+    {
+        uint idx = cell.bucket + i;
+        uint key = atomicCompSwap(entries.entries[idx].key, 0u, cell.key);
+        if (key == 0u || key == cell.key)
+        {
+            atomicAdd(entries.entries[idx].frame_red, fixed_point.r);
+            atomicAdd(entries.entries[idx].frame_green, fixed_point.g);
+            atomicAdd(entries.entries[idx].frame_blue, fixed_point.b);
+            atomicAdd(entries.entries[idx].frame_samples, 1u);
+            return;
+        }
+    }
+}
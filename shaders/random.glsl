@@ -0,0 +1,76 @@
+// Random numbers and hashes shared by the shaders. The generator is PCG (O'Neill 2014): a 32 bit LCG state
+// whose output goes through the RXS-M-XS permutation. The permutation alone is the PCG hash of Jarzynski and
+// Olano 2020, used where values must only depend on their inputs (procedural geometry, seeds).
+
+const float pi = 3.1415926535897932384626433832795;
+
+uint pcg_permute(uint state)
+{
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+uint pcg_hash(uint v)
+{
+    return pcg_permute(v * 747796405u + 2891336453u);
+}
+
+// Uniform in [0, 1)
+float hash_to_unit_float(uint h)
+{
+    return float(h >> 8) * (1.0 / 16777216.0);
+}
+
+// State of a pixel, every pass of the accumulation gets a different sequence
+uint random_seed(uvec2 pixel, uint pass)
+{
+    return pcg_hash(pixel.x ^ pcg_hash(pixel.y ^ pcg_hash(pass)));
+}
+
+// All 32 bits of the next output
+uint random_uint(inout uint state)
+{
+    state = state * 747796405u + 2891336453u;
+    return pcg_permute(state);
+}
+
+// Uniform in [0, 1)
+float random(inout uint state)
+{
+    return hash_to_unit_float(random_uint(state));
+}
+
+// Uniform integer in [0, count), the high word of the 32x32 bit product (Lemire 2019). Unlike scaling random(),
+// which has 24 bits, every one of up to 2^32 values can be drawn.
+uint random_below(inout uint state, uint count)
+{
+    uint high;
+    uint low;
+    umulExtended(random_uint(state), count, high, low);
+    return high;
+}
+
+vec2 random2(inout uint state)
+{
+    float u = random(state);
+    return vec2(u, random(state));
+}
+
+// Uniform on the unit sphere
+vec3 random_unit_vector(inout uint state)
+{
+    vec2 u = random2(state);
+    float z = 1.0 - 2.0 * u.x;
+    float r = sqrt(max(0.0, 1.0 - z * z));
+    float phi = 2.0 * pi * u.y;
+    return vec3(r * cos(phi), r * sin(phi), z);
+}
+
+// Uniform in the unit disk
+vec2 random_in_unit_disk(inout uint state)
+{
+    vec2 u = random2(state);
+    float r = sqrt(u.x);
+    float phi = 2.0 * pi * u.y;
+    return vec2(r * cos(phi), r * sin(phi));
+}
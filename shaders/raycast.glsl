@@ -0,0 +1,528 @@
+// Closest hit queries against the planes, quads, boxes, sphere fields and the spheres of the scene through its
+// acceleration structure. Needs scene.glsl.
+
+float infinity = 1.0 / 0.0;
+
+struct interval
+{
+    float min;
+    float max;
+};
+
+interval make_empty_interval()
+{
+    interval i;
+    i.min = infinity;
+    i.max = -infinity;
+    return i;
+}
+
+interval make_universe_interval()
+{
+    interval i;
+    i.min = -infinity;
+    i.max = infinity;
+    return i;
+}
+
+bool interval_contains(interval i, float v)
+{
+    return i.min <= v && v <= i.max;
+}
+
+bool interval_surrounds(interval i, float v)
+{
+    return i.min < v && v < i.max;
+}
+
+struct ray
+{
+    vec3 origin;
+    vec3 direction;
+    // Between 0 (shutter opening) and 1 (shutter closing), where the moving spheres are when the ray is traced
+    float time;
+};
+
+vec3 ray_at(ray r, float t)
+{
+    return r.origin + r.direction * t;
+}
+
+struct raycast_result
+{
+    vec3 point;
+    vec3 normal;
+    float t;
+    bool front_face;
+    uint material_type;
+    uint material_idx;
+};
+
+// Materials are assigned to the closest hit only, so the intersection loop just reads sphere geometry
+raycast_result raycast_sphere(ray r, interval i, vec4 s)
+{
+    raycast_result result;
+    vec3 center = s.xyz;
+    float radius = s.w;
+    vec3 oc = r.origin - center;
+    float a = dot(r.direction, r.direction);
+    float half_b = dot(oc, r.direction);
+    float c = dot(oc, oc) - radius * radius;
+    float discriminant = half_b * half_b - a * c;
+
+    if (discriminant < 0.0)
+    {
+        result.t = i.max;
+        return result;
+    }
+    else
+    {
+        float sqrtd = sqrt(discriminant);
+
+        // Find the nearest root that lies in the acceptable range.
+        float root = (-half_b - sqrtd) / a;
+        if (!interval_surrounds(i, root)) 
+        {
+            root = (-half_b + sqrtd) / a;
+            if (!interval_surrounds(i, root))
+            {
+                result.t = i.max;
+                return result;
+            }
+        }
+
+        result.t = root;
+        result.point = ray_at(r, root);
+
+        vec3 outward_normal = (result.point - center) / radius;
+
+        result.front_face = dot(r.direction, outward_normal) < 0;
+        result.normal = result.front_face ? outward_normal : -outward_normal;
+        return result;
+    }
+}
+
+// Surfaces are two sided, the normal faces the ray like for spheres
+void set_face_normal(ray r, vec3 outward_normal, inout raycast_result result)
+{
+    result.front_face = dot(r.direction, outward_normal) < 0;
+    result.normal = result.front_face ? outward_normal : -outward_normal;
+}
+
+raycast_result raycast_plane(ray r, interval i, plane p)
+{
+    raycast_result result;
+    result.t = i.max;
+
+    float denominator = dot(p.normal, r.direction);
+    if (abs(denominator) < 1e-8)
+    {
+        return result;
+    }
+
+    float root = (p.distance - dot(p.normal, r.origin)) / denominator;
+    if (!interval_surrounds(i, root))
+    {
+        return result;
+    }
+
+    result.t = root;
+    result.point = ray_at(r, root);
+    set_face_normal(r, p.normal, result);
+    result.material_idx = p.material_idx;
+    return result;
+}
+
+raycast_result raycast_quad(ray r, interval i, quad q)
+{
+    raycast_result result;
+    result.t = i.max;
+
+    vec3 n = cross(q.edge_u, q.edge_v);
+    float denominator = dot(n, r.direction);
+    if (abs(denominator) < 1e-8)
+    {
+        return result;
+    }
+
+    float root = dot(n, q.origin - r.origin) / denominator;
+    if (!interval_surrounds(i, root))
+    {
+        return result;
+    }
+
+    // Coordinates of the hit point along the two edges
+    vec3 point = ray_at(r, root);
+    vec3 planar = point - q.origin;
+    vec3 w = n / dot(n, n);
+    float alpha = dot(w, cross(planar, q.edge_v));
+    float beta = dot(w, cross(q.edge_u, planar));
+    if (alpha < 0.0 || alpha > 1.0 || beta < 0.0 || beta > 1.0)
+    {
+        return result;
+    }
+
+    result.t = root;
+    result.point = point;
+    set_face_normal(r, normalize(n), result);
+    result.material_idx = q.material_idx;
+    return result;
+}
+
+// Rays starting inside the box hit its back faces
+raycast_result raycast_box_primitive(ray r, interval i, box b)
+{
+    raycast_result result;
+    result.t = i.max;
+
+    vec3 inv_direction = 1.0 / r.direction;
+    vec3 t0 = (b.bounds_min - r.origin) * inv_direction;
+    vec3 t1 = (b.bounds_max - r.origin) * inv_direction;
+    vec3 t_near = min(t0, t1);
+    vec3 t_far = max(t0, t1);
+    float entry = max(max(t_near.x, t_near.y), t_near.z);
+    float exit = min(min(t_far.x, t_far.y), t_far.z);
+    if (entry > exit)
+    {
+        return result;
+    }
+
+    bool entering = interval_surrounds(i, entry);
+    if (!entering && !interval_surrounds(i, exit))
+    {
+        return result;
+    }
+
+    // The slab of the hit face, its normal points against the ray on entry and along it on exit
+    float root = entering ? entry : exit;
+    vec3 t_face = entering ? t_near : t_far;
+    uint axis = t_face.x == root ? 0 : (t_face.y == root ? 1 : 2);
+    vec3 outward_normal = vec3(0.0);
+    outward_normal[axis] = (r.direction[axis] < 0.0) == entering ? 1.0 : -1.0;
+
+    result.t = root;
+    result.point = ray_at(r, root);
+    set_face_normal(r, outward_normal, result);
+    result.material_idx = b.material_idx;
+    return result;
+}
+
+// Entry and exit distances of the ray through a box, the box is missed when entry > exit
+vec2 raycast_box(vec3 origin, vec3 inv_direction, vec3 box_min, vec3 box_max)
+{
+    vec3 t0 = (box_min - origin) * inv_direction;
+    vec3 t1 = (box_max - origin) * inv_direction;
+    vec3 t_near = min(t0, t1);
+    vec3 t_far = max(t0, t1);
+    return vec2(max(max(t_near.x, t_near.y), t_near.z), min(min(t_far.x, t_far.y), t_far.z));
+}
+
+// Keeps the hit with sphere s if it's the closest one so far
+void raycast_candidate(scene_info scene, ray r, uint s, inout float ray_tmax, inout raycast_result result, inout uint hit_sphere)
+{
+    raycast_result sphere_result = raycast_sphere(r, interval(0, ray_tmax), load_sphere_at(scene, s, r.time));
+    if (sphere_result.t < ray_tmax)
+    {
+        ray_tmax = sphere_result.t;
+        result = sphere_result;
+        hit_sphere = s;
+    }
+}
+
+// hit_sphere of the hits on planes, quads and boxes
+const uint no_hit_sphere = 0xFFFFFFFFu;
+
+// Planes, quads and boxes are few, every ray tests all of them before the spheres so the closest one already
+// bounds the sphere traversal
+void raycast_surfaces(scene_info scene, ray r, inout float ray_tmax, inout raycast_result result)
+{
+    PlaneArray planes = PlaneArray(scene.planes);
+    for (uint i = 0; i < scene.planes_count; ++i)
+    {
+        raycast_result surface_result = raycast_plane(r, interval(0, ray_tmax), planes.planes[i]);
+        if (surface_result.t < ray_tmax)
+        {
+            ray_tmax = surface_result.t;
+            result = surface_result;
+        }
+    }
+
+    QuadArray quads = QuadArray(scene.quads);
+    for (uint i = 0; i < scene.quads_count; ++i)
+    {
+        raycast_result surface_result = raycast_quad(r, interval(0, ray_tmax), quads.quads[i]);
+        if (surface_result.t < ray_tmax)
+        {
+            ray_tmax = surface_result.t;
+            result = surface_result;
+        }
+    }
+
+    BoxArray boxes = BoxArray(scene.boxes);
+    for (uint i = 0; i < scene.boxes_count; ++i)
+    {
+        raycast_result surface_result = raycast_box_primitive(r, interval(0, ray_tmax), boxes.boxes[i]);
+        if (surface_result.t < ray_tmax)
+        {
+            ray_tmax = surface_result.t;
+            result = surface_result;
+        }
+    }
+}
+
+// Walks the cells of every procedural field along the ray, generating their spheres. Spheres don't leave
+// their cell, the first hit of a field is its closest one.
+void raycast_sphere_fields(scene_info scene, ray r, inout float ray_tmax, inout raycast_result result)
+{
+    SphereFieldArray fields = SphereFieldArray(scene.sphere_fields);
+    vec3 inv_direction = 1.0 / r.direction;
+
+    for (uint f = 0; f < scene.sphere_fields_count; ++f)
+    {
+        sphere_field field = fields.fields[f];
+        vec3 bounds_max = field.bounds_min + vec3(field.resolution) * field.cell_size;
+        vec2 t = raycast_box(r.origin, inv_direction, field.bounds_min, bounds_max);
+        t.x = max(t.x, 0.0);
+        if (t.x > t.y || t.x > ray_tmax)
+        {
+            continue;
+        }
+
+        // Same 3D-DDA as the grid acceleration
+        uvec3 cell = uvec3(clamp(ivec3((ray_at(r, t.x) - field.bounds_min) / field.cell_size), ivec3(0), ivec3(field.resolution) - 1));
+        ivec3 cell_step = ivec3(sign(r.direction));
+        vec3 next_boundary = field.bounds_min + (vec3(cell) + max(vec3(cell_step), vec3(0.0))) * field.cell_size;
+        vec3 t_next = mix((next_boundary - r.origin) * inv_direction, vec3(infinity), equal(cell_step, ivec3(0)));
+        vec3 t_delta = abs(field.cell_size * inv_direction);
+
+        while (true)
+        {
+            vec4 sphere = sphere_field_sphere(field, cell);
+            if (sphere.w > 0.0)
+            {
+                raycast_result sphere_result = raycast_sphere(r, interval(0, ray_tmax), sphere);
+                if (sphere_result.t < ray_tmax)
+                {
+                    ray_tmax = sphere_result.t;
+                    result = sphere_result;
+                    result.material_idx = field.material_idx;
+                    break;
+                }
+            }
+
+            float t_exit = min(t_next.x, min(t_next.y, t_next.z));
+            if (ray_tmax <= t_exit || t_exit > t.y)
+            {
+                break;
+            }
+
+            uint axis = (t_next.x < t_next.y) ? ((t_next.x < t_next.z) ? 0 : 2) : ((t_next.y < t_next.z) ? 1 : 2);
+            int next_cell = int(cell[axis]) + cell_step[axis];
+            if (next_cell < 0 || next_cell >= int(field.resolution[axis]))
+            {
+                break;
+            }
+
+            cell[axis] = uint(next_cell);
+            t_next[axis] += t_delta[axis];
+        }
+    }
+}
+
+// Distance to the closest hit, infinity if nothing was hit. hit_sphere is no_hit_sphere when the closest hit
+// is a surface or a procedural sphere, whose material index is already in the result.
+float raycast_scene(scene_info scene, ray r, out raycast_result result, out uint hit_sphere)
+{
+    float ray_tmax = infinity;
+    hit_sphere = no_hit_sphere;
+
+    raycast_surfaces(scene, r, ray_tmax, result);
+    raycast_sphere_fields(scene, r, ray_tmax, result);
+
+    if (scene.acceleration == lbvh_scene_acceleration && scene.spheres_count > 1)
+    {
+        BvhNodeArray bvh = BvhNodeArray(scene.bvh_nodes);
+        BvhLeafArray leaves = BvhLeafArray(scene.bvh_leaves);
+        vec3 inv_direction = 1.0 / r.direction;
+
+        // Deep enough for any hierarchy the build makes, see bvh_stack_size
+        uint stack[bvh_stack_size];
+        uint stack_size = 1;
+        stack[0] = 0;
+
+        while (stack_size > 0)
+        {
+            uint node_idx = stack[--stack_size];
+            if ((node_idx & bvh_leaf_flag) != 0)
+            {
+                raycast_candidate(scene, r, leaves.spheres[node_idx & ~bvh_leaf_flag], ray_tmax, result, hit_sphere);
+                continue;
+            }
+
+            bvh_node node = bvh.nodes[node_idx];
+            vec3 bounds_min = node.bounds_min;
+            vec3 bounds_max = node.bounds_max;
+            if (scene.has_sphere_motion != 0)
+            {
+                // Linear motion box, tight at both ends of the shutter interval
+                motion_bounds end_bounds = MotionBoundsArray(scene.bvh_motion_bounds).bounds[node_idx];
+                bounds_min = mix(bounds_min, end_bounds.bounds_min, r.time);
+                bounds_max = mix(bounds_max, end_bounds.bounds_max, r.time);
+            }
+
+            vec2 t = raycast_box(r.origin, inv_direction, bounds_min, bounds_max);
+            if (t.x > t.y || t.y < 0.0 || t.x > ray_tmax)
+            {
+                continue;
+            }
+
+            stack[stack_size++] = node.right_child;
+            stack[stack_size++] = node.left_child;
+        }
+
+        return ray_tmax;
+    }
+
+    if (scene.acceleration == wide_bvh_scene_acceleration && scene.spheres_count > 0)
+    {
+        WideBvhNodeArray bvh = WideBvhNodeArray(scene.wide_bvh_nodes);
+        vec3 inv_direction = 1.0 / r.direction;
+        // The builder put the nearest child for rays of octant o in slot o
+        uint octant = (r.direction.x < 0.0 ? 1 : 0) | (r.direction.y < 0.0 ? 2 : 0) | (r.direction.z < 0.0 ? 4 : 0);
+
+        // Entries are nodes, their children are only pushed when their boxes are hit
+        uint stack[wide_bvh_stack_size];
+        float stack_t[wide_bvh_stack_size];
+        uint stack_size = 1;
+        stack[0] = 0;
+        stack_t[0] = 0.0;
+
+        while (stack_size > 0)
+        {
+            --stack_size;
+            if (stack_t[stack_size] > ray_tmax)
+            {
+                continue;
+            }
+
+            wide_bvh_node node = bvh.nodes[stack[stack_size]];
+            vec3 cell_size = wide_bvh_cell_size(node.exponents);
+
+            // Leaves are tested right away, internal children pushed after the loop, farthest first
+            uint hit_children[wide_bvh_width];
+            float hit_children_t[wide_bvh_width];
+            uint hit_children_count = 0;
+
+            for (uint i = 0; i < wide_bvh_width; ++i)
+            {
+                uint slot = i ^ octant;
+                uint meta = wide_bvh_byte(node.meta, slot);
+                if (meta == 0)
+                {
+                    continue;
+                }
+
+                vec3 low = vec3(wide_bvh_byte(node.low_x, slot), wide_bvh_byte(node.low_y, slot), wide_bvh_byte(node.low_z, slot));
+                vec3 high = vec3(wide_bvh_byte(node.high_x, slot), wide_bvh_byte(node.high_y, slot), wide_bvh_byte(node.high_z, slot));
+                vec2 t = raycast_box(r.origin, inv_direction, node.origin + low * cell_size, node.origin + high * cell_size);
+                if (t.x > t.y || t.y < 0.0 || t.x > ray_tmax)
+                {
+                    continue;
+                }
+
+                uint offset = meta & wide_bvh_offset_mask;
+                uint leaf_spheres_count = (meta & ~wide_bvh_child_valid) >> wide_bvh_leaf_count_shift;
+                if (leaf_spheres_count == 0)
+                {
+                    hit_children[hit_children_count] = node.child_base + offset;
+                    hit_children_t[hit_children_count] = t.x;
+                    ++hit_children_count;
+                    continue;
+                }
+
+                for (uint s = node.sphere_base + offset; s < node.sphere_base + offset + leaf_spheres_count; ++s)
+                {
+                    raycast_candidate(scene, r, s, ray_tmax, result, hit_sphere);
+                }
+            }
+
+            // The nearest child ends up on top of the stack, the builder only makes trees that fit in it
+            while (hit_children_count > 0)
+            {
+                --hit_children_count;
+                stack[stack_size] = hit_children[hit_children_count];
+                stack_t[stack_size] = hit_children_t[hit_children_count];
+                ++stack_size;
+            }
+        }
+
+        return ray_tmax;
+    }
+
+    if (scene.acceleration == grid_scene_acceleration && scene.spheres_count > 0)
+    {
+        grid_info grid = GridInfoRef(scene.grid_info).grid;
+
+        IndexArray large_spheres = IndexArray(scene.grid_large_spheres);
+        for (uint i = 0; i < grid.large_spheres_count; ++i)
+        {
+            raycast_candidate(scene, r, large_spheres.indices[i], ray_tmax, result, hit_sphere);
+        }
+
+        vec3 inv_direction = 1.0 / r.direction;
+        vec2 t = raycast_box(r.origin, inv_direction, grid.bounds_min, grid.bounds_max);
+        t.x = max(t.x, 0.0);
+        if (t.x > t.y || t.x > ray_tmax)
+        {
+            return ray_tmax;
+        }
+
+        // 3D-DDA: steps from cell to cell along the ray, crossing the closest cell boundary first
+        uvec3 cell = grid_cell_coords(grid, ray_at(r, t.x));
+        ivec3 cell_step = ivec3(sign(r.direction));
+        vec3 next_boundary = grid.bounds_min + (vec3(cell) + max(vec3(cell_step), vec3(0.0))) * grid.cell_size;
+        vec3 t_next = mix((next_boundary - r.origin) * inv_direction, vec3(infinity), equal(cell_step, ivec3(0)));
+        vec3 t_delta = abs(grid.cell_size * inv_direction);
+
+        IndexArray cells = IndexArray(scene.grid_cells);
+        IndexArray references = IndexArray(scene.grid_references);
+
+        while (true)
+        {
+            // Cells store the end of their references, they start where the previous cell's end
+            uint cell_idx = grid_cell_idx(grid, cell);
+            uint references_begin = (cell_idx == 0) ? 0 : cells.indices[cell_idx - 1];
+            uint references_end = cells.indices[cell_idx];
+            for (uint i = references_begin; i < references_end; ++i)
+            {
+                raycast_candidate(scene, r, references.indices[i], ray_tmax, result, hit_sphere);
+            }
+
+            // A hit inside the cell can't be hidden by the spheres of the next cells
+            float t_exit = min(t_next.x, min(t_next.y, t_next.z));
+            if (ray_tmax <= t_exit || t_exit > t.y)
+            {
+                break;
+            }
+
+            uint axis = (t_next.x < t_next.y) ? ((t_next.x < t_next.z) ? 0 : 2) : ((t_next.y < t_next.z) ? 1 : 2);
+            int next_cell = int(cell[axis]) + cell_step[axis];
+            if (next_cell < 0 || next_cell >= int(grid.resolution[axis]))
+            {
+                break;
+            }
+
+            cell[axis] = uint(next_cell);
+            t_next[axis] += t_delta[axis];
+        }
+
+        return ray_tmax;
+    }
+
+    for (uint s = 0; s < scene.spheres_count; ++s)
+    {
+        raycast_candidate(scene, r, s, ray_tmax, result, hit_sphere);
+    }
+
+    return ray_tmax;
+}
@@ -0,0 +1,136 @@
+// Reservoirs of light samples resampled by the ReSTIR passes (Bitterli et al. 2020). Needs scene.glsl,
+// raycast.glsl, bsdf.glsl and lights.glsl.
+//
+// A reservoir keeps one point y of an emissive sphere out of a stream of candidates, each one replacing the kept
+// point with a probability proportional to its resampling weight. Its weight W makes f(y) * W an estimate of the
+// direct light of the shading point, whatever the densities the candidates came from. Densities and target
+// functions are per unit area of the sphere surfaces, so reservoirs of different points can be combined.
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer RestirReservoirArray
+{
+    restir_reservoir reservoirs[];
+};
+
+float luminance(vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Octahedral mapping of unit vectors to [-1, 1]^2 (Cigolle et al. 2014)
+vec2 octahedral_encode(vec3 v)
+{
+    vec2 p = v.xy / (abs(v.x) + abs(v.y) + abs(v.z));
+    if (v.z < 0.0)
+    {
+        p = (1.0 - abs(p.yx)) * vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+    }
+
+    return p;
+}
+
+vec3 octahedral_decode(vec2 p)
+{
+    vec3 v = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+restir_reservoir make_empty_reservoir()
+{
+    restir_reservoir r;
+    r.light = restir_no_light;
+    r.direction = 0;
+    r.weight = 0.0;
+    r.candidates_count = 0.0;
+    return r;
+}
+
+// Streaming resampling: until reservoir_finalize, the weight of the reservoir is the sum of the resampling
+// weights. True if the candidate, standing for candidates_count ones, replaced the kept sample.
+bool reservoir_update(inout restir_reservoir r, uint light, uint direction, float resampling_weight,
+    float candidates_count, inout uint state)
+{
+    r.weight += resampling_weight;
+    r.candidates_count += candidates_count;
+    if (resampling_weight <= 0.0 || random(state) * r.weight >= resampling_weight)
+    {
+        return false;
+    }
+
+    r.light = light;
+    r.direction = direction;
+    return true;
+}
+
+// target is the target function of the kept sample at the shading point of the reservoir
+void reservoir_finalize(inout restir_reservoir r, float target)
+{
+    r.weight = target > 0.0 && r.candidates_count > 0.0 ? r.weight / (r.candidates_count * target) : 0.0;
+}
+
+struct light_point
+{
+    vec3 position;
+    // Outward
+    vec3 normal;
+    vec3 radiance;
+};
+
+light_point load_light_point(scene_info scene, uint sphere, uint direction, float time)
+{
+    vec4 s = load_sphere_at(scene, sphere, time);
+
+    light_point y;
+    y.normal = octahedral_decode(unpackUnorm2x16(direction) * 2.0 - 1.0);
+    y.position = s.xyz + s.w * y.normal;
+    y.radiance = MaterialArray(scene.materials).materials[load_sphere_material_idx(scene, sphere)].albedo;
+    return y;
+}
+
+// Light of y reflected along -direction by the surface at p, without its visibility, per unit area of the
+// sphere: f * cos * Le * cos_y / d^2. Its luminance is the target function of the resampling.
+vec3 light_point_contribution(material m, vec3 p, vec3 normal, vec3 direction, light_point y)
+{
+    vec3 to_light = y.position - p;
+    float distance2 = dot(to_light, to_light);
+    vec3 wi = to_light * inversesqrt(distance2);
+    float cos_y = -dot(wi, y.normal);
+    if (cos_y <= 0.0)
+    {
+        return vec3(0.0);
+    }
+
+    return evaluate_bsdf(m, normal, direction, wi).value * y.radiance * cos_y / distance2;
+}
+
+// True if the first hit from p towards y is the outer side of the sphere of y
+bool light_point_visible(scene_info scene, vec3 p, uint sphere, light_point y, float time)
+{
+    vec3 direction = normalize(y.position - p);
+    raycast_result shadow_result;
+    uint shadow_sphere;
+    raycast_scene(scene, ray(p + direction * 0.0001f, direction, time), shadow_result, shadow_sphere);
+    return shadow_sphere == sphere && shadow_result.front_face;
+}
+
+// Direct light of the emissive spheres at a hit of the tracer from the reservoir of its pixel. The reservoir was
+// resampled for the hit of the pixel center, the sample is reused as is for the hits of the other camera rays
+// through the pixel.
+vec3 reservoir_direct_light(scene_info scene, ray r, raycast_result result, material m, restir_reservoir reservoir)
+{
+    if (reservoir.light == restir_no_light || reservoir.weight <= 0.0)
+    {
+        return vec3(0.0);
+    }
+
+    light_point y = load_light_point(scene, reservoir.light, reservoir.direction, r.time);
+    vec3 contribution = light_point_contribution(m, result.point, result.normal, r.direction, y);
+    if (contribution == vec3(0.0) || !light_point_visible(scene, result.point, reservoir.light, y, r.time))
+    {
+        return vec3(0.0);
+    }
+
+    return contribution * reservoir.weight;
+}
@@ -0,0 +1,155 @@
+// Shared by the ReSTIR passes (see ReservoirResampler). Every invocation is a pixel of the compute target, the
+// shading point of its reservoir is the first hit of the ray through the pixel center.
+
+#include "scene.glsl"
+#include "raycast.glsl"
+#include "bsdf.glsl"
+#include "lights.glsl"
+#include "reservoirs.glsl"
+
+layout(local_size_x = restir_workgroup_size, local_size_y = restir_workgroup_size) in;
+
+layout(push_constant, scalar) uniform PushConstants
+{
+    RESTIR_PUSH_CONSTANTS_MEMBERS
+} push_constants;
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer RestirSurfaceArray
+{
+    restir_surface surfaces[];
+};
+
+// Every pass of a frame gets its own random numbers
+uint restir_random_seed(uvec2 pixel, uint pass)
+{
+    return random_seed(pixel, push_constants.frame * 3 + pass);
+}
+
+bool restir_pixel_inside(ivec2 pixel)
+{
+    return pixel.x >= 0 && pixel.y >= 0 && pixel.x < int(push_constants.width) && pixel.y < int(push_constants.height);
+}
+
+uint restir_pixel_idx(ivec2 pixel)
+{
+    return uint(pixel.y) * push_constants.width + uint(pixel.x);
+}
+
+// Moving spheres are resampled in the middle of the shutter interval, the tracer reuses the samples at the time
+// of its rays
+float restir_time(scene_info scene)
+{
+    return scene.has_sphere_motion != 0 ? 0.5 : 0.0;
+}
+
+// Camera of raytracing.comp: vertical field of view of 90 degrees, the viewport is stretched to the aspect
+// ratio of the window. The vectors from the camera to the left edge, across the viewport and down it, for a
+// viewport at distance 1.
+void camera_viewport(vec3 camera_direction, out vec3 forward, out vec3 across, out vec3 down)
+{
+    float image_height = int(push_constants.width / push_constants.aspect_ratio);
+    float viewport_height = 2.0;
+    float viewport_width = viewport_height * float(push_constants.width) / image_height;
+
+    vec3 w = -camera_direction;
+    vec3 u = cross(vec3(0.0, 1.0, 0.0), w);
+    vec3 v = cross(w, u);
+
+    forward = -w;
+    across = viewport_width * u;
+    down = viewport_height * -v;
+}
+
+// Normalized direction of the ray through the center of a pixel, without defocus
+vec3 camera_ray_direction(vec3 camera_direction, ivec2 pixel)
+{
+    vec3 forward, across, down;
+    camera_viewport(camera_direction, forward, across, down);
+    vec2 f = (vec2(pixel) + 0.5) / vec2(push_constants.width, push_constants.height) - 0.5;
+    return normalize(forward + f.x * across + f.y * down);
+}
+
+// Pixel of a camera whose center ray is the closest to p, false if p is behind the camera. forward, across and
+// down are orthogonal.
+bool camera_project(vec3 camera_position, vec3 camera_direction, vec3 p, out ivec2 pixel)
+{
+    vec3 forward, across, down;
+    camera_viewport(camera_direction, forward, across, down);
+
+    vec3 d = p - camera_position;
+    float depth = dot(d, forward) / dot(forward, forward);
+    if (depth <= 0.0)
+    {
+        return false;
+    }
+
+    vec2 f = vec2(dot(d, across) / dot(across, across), dot(d, down) / dot(down, down)) / depth + 0.5;
+    pixel = ivec2(floor(f * vec2(push_constants.width, push_constants.height)));
+    return true;
+}
+
+restir_surface make_restir_surface(float camera_distance, vec3 normal, uint material_idx)
+{
+    restir_surface surface;
+    surface.distance = camera_distance;
+    surface.normal = packSnorm2x16(octahedral_encode(normal));
+    surface.material_idx = material_idx;
+    return surface;
+}
+
+vec3 restir_surface_normal(restir_surface surface)
+{
+    return octahedral_decode(unpackSnorm2x16(surface.normal));
+}
+
+// Neighbouring reservoirs are only reused across similar surfaces, their samples would be resampled for light
+// the shading point doesn't get: normals within 25 degrees, distances from the camera within 10%
+bool similar_surfaces(restir_surface surface, float camera_distance, restir_surface other)
+{
+    return other.distance > 0.0 && abs(other.distance - camera_distance) <= 0.1 * camera_distance &&
+        dot(restir_surface_normal(surface), restir_surface_normal(other)) >= 0.9;
+}
+
+struct shading_point
+{
+    vec3 position;
+    vec3 normal;
+    // Of the camera ray
+    vec3 direction;
+    material m;
+};
+
+shading_point load_shading_point(scene_info scene, restir_surface surface, vec3 direction)
+{
+    shading_point x;
+    x.direction = direction;
+    x.position = push_constants.camera_position + surface.distance * direction;
+    x.normal = restir_surface_normal(surface);
+    x.m = MaterialArray(scene.materials).materials[surface.material_idx];
+    return x;
+}
+
+// Luminance of the unshadowed light of the sample of a reservoir at x
+float reservoir_target(scene_info scene, restir_reservoir r, shading_point x, float time)
+{
+    if (r.light == restir_no_light)
+    {
+        return 0.0;
+    }
+
+    light_point y = load_light_point(scene, r.light, r.direction, time);
+    return luminance(light_point_contribution(x.m, x.position, x.normal, x.direction, y));
+}
+
+// Resamples the sample of a reservoir of another pixel or frame for x. The reservoirs weights are for their own
+// shading points, the combination is the biased one: 1 / M normalization, no visibility (Bitterli et al. 2020,
+// algorithm 4).
+void reservoir_combine(scene_info scene, inout restir_reservoir combined, inout float kept_target, restir_reservoir r,
+    shading_point x, float time, inout uint state)
+{
+    float target = reservoir_target(scene, r, x, time);
+    if (reservoir_update(combined, r.light, r.direction, target * r.weight * r.candidates_count, r.candidates_count, state))
+    {
+        kept_target = target;
+    }
+}
@@ -0,0 +1,195 @@
+// Scene access shared by the trace and the LBVH build passes.
+// Needs GL_EXT_buffer_reference, GL_EXT_buffer_reference_uvec2 and GL_EXT_scalar_block_layout.
+
+// Structs and constants shared with the host, generated from src/base/GpuLayout.h
+#include "gpu_layout.glsl"
+
+#include "random.glsl"
+
+// Scene arrays are reached through device addresses instead of descriptors, their layout depends on
+// the scene encoding (see GpuScene and SceneEncoding)
+layout(buffer_reference, scalar, buffer_reference_align = 16) readonly buffer SphereArray
+{
+    packed_sphere spheres[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 8) readonly buffer QuantizedSphereArray
+{
+    quantized_sphere spheres[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer SphereChunkArray
+{
+    sphere_chunk chunks[];
+};
+
+// 16 bit material indices, two per uint
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer SphereMaterialArray
+{
+    uint material_indices[];
+};
+
+// Unified material table, tagged with the material type
+layout(buffer_reference, scalar, buffer_reference_align = 16) readonly buffer MaterialArray
+{
+    material materials[];
+};
+
+// Center displacement of every sphere while the shutter is open
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer SphereMotionArray
+{
+    vec3 motions[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 16) readonly buffer BvhNodeArray
+{
+    bvh_node nodes[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer BvhLeafArray
+{
+    uint spheres[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer MotionBoundsArray
+{
+    motion_bounds bounds[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 16) readonly buffer WideBvhNodeArray
+{
+    wide_bvh_node nodes[];
+};
+
+// Surfaces kept out of the sphere acceleration structures
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer PlaneArray
+{
+    plane planes[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer QuadArray
+{
+    quad quads[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer BoxArray
+{
+    box boxes[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer SphereFieldArray
+{
+    sphere_field fields[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer GridInfoRef
+{
+    grid_info grid;
+};
+
+// Sphere indices, also used for the grid cells (end of the references of each cell) and the grid references
+layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer IndexArray
+{
+    uint indices[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 8) readonly buffer SceneHeader
+{
+    scene_info info;
+};
+
+// Center and radius of a sphere
+vec4 load_sphere(scene_info scene, uint idx)
+{
+    if (scene.encoding == quantized_scene_encoding)
+    {
+        quantized_sphere quantized = QuantizedSphereArray(scene.sphere_geometry).spheres[idx];
+        sphere_chunk chunk = SphereChunkArray(scene.sphere_chunks).chunks[idx / sphere_chunk_size];
+        vec2 xy = unpackUnorm2x16(quantized.xy);
+        vec2 zr = unpackUnorm2x16(quantized.zr);
+        return vec4(chunk.origin + vec3(xy, zr.x) * chunk.extent, zr.y * chunk.max_radius);
+    }
+
+    packed_sphere packed = SphereArray(scene.sphere_geometry).spheres[idx];
+    return vec4(packed.center, packed.radius);
+}
+
+// Sphere at a time between 0 (shutter opening) and 1 (shutter closing)
+vec4 load_sphere_at(scene_info scene, uint idx, float time)
+{
+    vec4 sphere = load_sphere(scene, idx);
+    if (scene.has_sphere_motion != 0)
+    {
+        sphere.xyz += SphereMotionArray(scene.sphere_motion).motions[idx] * time;
+    }
+
+    return sphere;
+}
+
+// Bounds of a sphere over the whole shutter interval
+void load_sphere_swept_bounds(scene_info scene, uint idx, out vec3 bounds_min, out vec3 bounds_max)
+{
+    vec4 sphere = load_sphere(scene, idx);
+    vec3 center_end = sphere.xyz;
+    if (scene.has_sphere_motion != 0)
+    {
+        center_end += SphereMotionArray(scene.sphere_motion).motions[idx];
+    }
+
+    bounds_min = min(sphere.xyz, center_end) - sphere.w;
+    bounds_max = max(sphere.xyz, center_end) + sphere.w;
+}
+
+// Sphere of a cell of a procedural field, a zero radius for empty cells. Only depends on the seed and the cell,
+// every frame and every ray sees the same spheres.
+vec4 sphere_field_sphere(sphere_field field, uvec3 cell)
+{
+    uint h = pcg_hash(field.seed ^ pcg_hash(cell.x ^ pcg_hash(cell.y ^ pcg_hash(cell.z))));
+    if (hash_to_unit_float(h) >= field.density)
+    {
+        return vec4(0.0);
+    }
+
+    h = pcg_hash(h);
+    float radius = mix(field.radius_min, field.radius_max, hash_to_unit_float(h));
+
+    vec3 offset;
+    for (uint axis = 0; axis < 3; ++axis)
+    {
+        h = pcg_hash(h);
+        offset[axis] = hash_to_unit_float(h);
+    }
+
+    // The whole sphere stays inside its cell
+    vec3 cell_min = field.bounds_min + vec3(cell) * field.cell_size;
+    return vec4(cell_min + radius + offset * (field.cell_size - 2.0 * radius), radius);
+}
+
+uint load_sphere_material_idx(scene_info scene, uint idx)
+{
+    uint pair = SphereMaterialArray(scene.sphere_materials).material_indices[idx / 2];
+    return (idx % 2 == 0) ? (pair & 0xFFFFu) : (pair >> 16);
+}
+
+// Cell of the grid containing p, clamped to the grid
+uvec3 grid_cell_coords(grid_info grid, vec3 p)
+{
+    return uvec3(clamp(ivec3(floor((p - grid.bounds_min) / grid.cell_size)), ivec3(0), ivec3(grid.resolution) - 1));
+}
+
+uint grid_cell_idx(grid_info grid, uvec3 coords)
+{
+    return coords.x + grid.resolution.x * (coords.y + grid.resolution.y * coords.z);
+}
+
+// Byte of a child slot in the per child fields of wide_bvh_node
+uint wide_bvh_byte(uvec2 bytes, uint slot)
+{
+    return (bytes[slot >> 2] >> ((slot & 3) * 8)) & 0xFFu;
+}
+
+// Power of two cell size of the quantized child bounds, built from the biased exponents
+vec3 wide_bvh_cell_size(uint exponents)
+{
+    return uintBitsToFloat(uvec3(exponents & 0xFFu, (exponents >> 8) & 0xFFu, (exponents >> 16) & 0xFFu) << 23);
+}
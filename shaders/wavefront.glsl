@@ -0,0 +1,119 @@
+// Shared by the wavefront passes (see WavefrontTracer). They have the bindings and the push constants of the
+// trace. Every invocation is a path of the batch, one per pixel of its tiles, or for the extend pass an entry of
+// the queue of the paths.
+
+#include "scene.glsl"
+#include "raycast.glsl"
+#include "bsdf.glsl"
+#include "environment.glsl"
+#include "lights.glsl"
+#include "hash_grid.glsl"
+#include "guiding.glsl"
+#include "direct_light.glsl"
+#include "reservoirs.glsl"
+
+layout(local_size_x = wavefront_workgroup_size) in;
+
+layout (binding = 0, rgba8) uniform writeonly image2D resultImage;
+
+layout (binding = 1, scalar) uniform UBO
+{
+    COMPUTE_UNIFORMS_MEMBERS
+} ubo;
+
+layout (binding = 2, rgba32f) uniform image2D accumulationImage;
+
+layout(push_constant, scalar) uniform PushConstants
+{
+    COMPUTE_PUSH_CONSTANTS_MEMBERS
+} push_constants;
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer WavefrontPathArray
+{
+    wavefront_path paths[];
+};
+
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer WavefrontUintArray
+{
+    uint values[];
+};
+
+// Pixel of a path of the batch. The batch is a range of tiles in row-major order, without the tile order of the
+// trace, and the paths of a tile are its pixels in row-major order. False past the image.
+bool wavefront_path_pixel(uint path_idx, ivec2 dim, out uvec2 pixel)
+{
+    uvec2 tile_size = uvec2(push_constants.wavefront_tile_width, push_constants.wavefront_tile_height);
+    uint tile = ubo.tile_offset + path_idx / (tile_size.x * tile_size.y);
+    uint idx_in_tile = path_idx % (tile_size.x * tile_size.y);
+    uint tiles_per_row = (uint(dim.x) + tile_size.x - 1) / tile_size.x;
+
+    pixel = uvec2(tile % tiles_per_row, tile / tiles_per_row) * tile_size + uvec2(idx_in_tile % tile_size.x, idx_in_tile / tile_size.x);
+    return pixel.x < uint(dim.x) && pixel.y < uint(dim.y);
+}
+
+uint wavefront_pack_pixel(uvec2 pixel)
+{
+    return pixel.x | (pixel.y << 16);
+}
+
+ivec2 wavefront_unpack_pixel(uint pixel)
+{
+    return ivec2(pixel & 0xFFFFu, pixel >> 16);
+}
+
+// Camera of raytracing.comp: a ray through a random point of the pixel from a random point of the lens, with the
+// random numbers drawn in the same order
+ray wavefront_camera_ray(scene_info scene, uvec2 pixel, ivec2 dim, inout uint state)
+{
+    float image_height = int(dim.x / ubo.aspect_ratio);
+    float viewport_height = 2.0 * ubo.focus_dist;
+    float viewport_width = viewport_height * float(dim.x) / image_height;
+
+    vec3 w = -ubo.camera_direction;
+    vec3 u = cross(vec3(0.0, 1.0, 0.0), w);
+    vec3 v = cross(w, u);
+
+    vec3 viewport_u = viewport_width * u;
+    vec3 viewport_v = viewport_height * -v;
+    vec3 pixel_delta_u = viewport_u / dim.x;
+    vec3 pixel_delta_v = viewport_v / dim.y;
+    vec3 viewport_upper_left = ubo.camera_position - ubo.focus_dist * w - viewport_u / 2.0 - viewport_v / 2.0;
+    vec3 pixel00_loc = viewport_upper_left + 0.5 * (pixel_delta_u + pixel_delta_v);
+
+    float xoffset = random(state) - 0.5;
+    float yoffset = random(state) - 0.5;
+    vec3 pixel_center = pixel00_loc + (pixel.x + xoffset) * pixel_delta_u + (pixel.y + yoffset) * pixel_delta_v;
+
+    vec3 origin = ubo.camera_position;
+    if (ubo.defocus_angle > 0)
+    {
+        float defocus_radius = ubo.focus_dist * tan(radians(ubo.defocus_angle / 2.0));
+        vec2 p = random_in_unit_disk(state);
+        origin += p.x * defocus_radius * u + p.y * defocus_radius * v;
+    }
+
+    float time = scene.has_sphere_motion != 0 ? random(state) : 0.0;
+    return ray(origin, normalize(pixel_center - origin), time);
+}
+
+// Sort key of a ray, see ray_sort_key_bits. Rays with close keys start close to each other in about the same
+// direction and go through the same nodes of the acceleration structure. Rays with the largest key end up with the
+// paths that ended, they are still traced.
+uint wavefront_sort_key(ray r)
+{
+    uvec2 direction = uvec2(clamp((octahedral_encode(r.direction) * 0.5 + 0.5) * 8.0, vec2(0.0), vec2(7.0)));
+
+    vec3 to_origin = r.origin - ubo.camera_position;
+    float distance = max(length(to_origin), 1e-6);
+    uvec2 seen = uvec2(clamp((octahedral_encode(to_origin / distance) * 0.5 + 0.5) * 64.0, vec2(0.0), vec2(63.0)));
+    uint half_octave = uint(clamp(floor(log2(distance) * 2.0) + 32.0, 0.0, 63.0));
+
+    uint origin = 0;
+    for (uint bit = 0; bit < 6; ++bit)
+    {
+        origin |= (((seen.x >> bit) & 1u) << (3 * bit + 2)) | (((seen.y >> bit) & 1u) << (3 * bit + 1)) |
+            (((half_octave >> bit) & 1u) << (3 * bit));
+    }
+
+    return (direction.x << 21) | (direction.y << 18) | origin;
+}
@@ -22,20 +22,22 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPSTR cmdLine, i
     SpherePrimitive sp1(glm::vec3(+0.0f, 0.0f, -1.0f), 0.5f);
     SpherePrimitive sp2(glm::vec3(-2.0f, 0.0f, -1.0f), 0.5f);
     SpherePrimitive sp3(glm::vec3(+2.0f, 0.0f, -1.0f), 0.5f);
-    SpherePrimitive sp4(glm::vec3(+0.0f, -100.5f, -1.0f), 100.0f);
     SpherePrimitive sp5(glm::vec3(+0.0f, 0.0f, +2.0f), 0.5f);
     SpherePrimitive sp6(glm::vec3(+0.75f, 0.0f, +0.5f), 0.5f);
     SpherePrimitive sp7(glm::vec3(-0.75f, 0.0f, +0.5f), 0.5f);
     SpherePrimitive sp8(glm::vec3(-0.75f, 0.0f, +0.5f), 0.4f);
 
+    PlanePrimitive pl1(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
     world.spheres.push_back({ sp1, mi1 });
     world.spheres.push_back({ sp2, mi2 });
     world.spheres.push_back({ sp3, mi3 });
-    world.spheres.push_back({ sp4, mi4 });
     world.spheres.push_back({ sp5, mi5 });
     world.spheres.push_back({ sp6, mi6 });
     world.spheres.push_back({ sp7, mi7 });
     world.spheres.push_back({ sp8, mi8 });
 
+    world.planes.push_back({ pl1, mi4 });
+
     return StartApp<VulkanAppBase>(world, hInstance, CommandLineArgs(__argc, __argv));
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+
+
+#include "VulkanApp.h"
+#include "World.h"
+
+// Showcase of the scene features app0 leaves out to stay a small, fast scene: a moving sphere for the motion
+// blur, a procedural gravel field on the ground and a string of emissive bulbs for the light hierarchy
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPSTR cmdLine, int showCmd)
+{
+    World world;
+
+    world.camera.position = glm::vec3(0.0f, 0.0f, -2.0f);
+    world.camera.direction = glm::vec3(0.0f, 0.0f, 1.0f);
+
+    MaterialInfo mi1 = world.materialManager.CreateMaterial(MetalMaterialProperties(glm::vec3(0.8f, 0.8f, 0.8f), 0.05f));
+    MaterialInfo mi2 = world.materialManager.CreateMaterial(LambertianMaterialProperties(glm::vec3(0.1f, 0.8f, 0.3f)));
+    MaterialInfo mi3 = world.materialManager.CreateMaterial(LambertianMaterialProperties(glm::vec3(0.2f, 0.1f, 0.5f)));
+    MaterialInfo mi4 = world.materialManager.CreateMaterial(LambertianMaterialProperties(glm::vec3(0.3f, 0.3f, 0.9f)));
+    MaterialInfo mi5 = world.materialManager.CreateMaterial(LambertianMaterialProperties(glm::vec3(0.8f, 0.4f, 0.3f)));
+    MaterialInfo mi6 = world.materialManager.CreateMaterial(DielectricMaterialProperties(1.0f / 1.33f));
+    MaterialInfo mi7 = world.materialManager.CreateMaterial(DielectricMaterialProperties(1.5f));
+    MaterialInfo mi8 = world.materialManager.CreateMaterial(DielectricMaterialProperties(1.0f / 1.5f));
+    MaterialInfo mi9 = world.materialManager.CreateMaterial(LambertianMaterialProperties(glm::vec3(0.5f, 0.45f, 0.4f)));
+    MaterialInfo mi10 = world.materialManager.CreateMaterial(EmissiveMaterialProperties(glm::vec3(1.0f, 0.7f, 0.4f), 40.0f));
+    MaterialInfo mi11 = world.materialManager.CreateMaterial(EmissiveMaterialProperties(glm::vec3(0.4f, 0.6f, 1.0f), 400.0f));
+
+    SpherePrimitive sp1(glm::vec3(+0.0f, 0.0f, -1.0f), 0.5f);
+    // Moves up while the shutter is open, blurred along its path
+    SpherePrimitive sp2(glm::vec3(-2.0f, 0.0f, -1.0f), glm::vec3(-2.0f, 0.25f, -1.0f), 0.5f);
+    SpherePrimitive sp3(glm::vec3(+2.0f, 0.0f, -1.0f), 0.5f);
+    SpherePrimitive sp5(glm::vec3(+0.0f, 0.0f, +2.0f), 0.5f);
+    SpherePrimitive sp6(glm::vec3(+0.75f, 0.0f, +0.5f), 0.5f);
+    SpherePrimitive sp7(glm::vec3(-0.75f, 0.0f, +0.5f), 0.5f);
+    SpherePrimitive sp8(glm::vec3(-0.75f, 0.0f, +0.5f), 0.4f);
+
+    PlanePrimitive pl1(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // Gravel on the ground, a single layer of cells
+    SphereFieldPrimitive sf1(glm::vec3(-4.0f, -0.5f, -3.0f), glm::vec3(4.0f, -0.45f, 6.0f), 0.05f, 1234, 0.6f, 0.008f, 0.02f);
+
+    world.spheres.push_back({ sp1, mi1 });
+    world.spheres.push_back({ sp2, mi2 });
+    world.spheres.push_back({ sp3, mi3 });
+    world.spheres.push_back({ sp5, mi5 });
+    world.spheres.push_back({ sp6, mi6 });
+    world.spheres.push_back({ sp7, mi7 });
+    world.spheres.push_back({ sp8, mi8 });
+
+    // String of small bulbs hanging over the spheres, every eighth one brighter
+    for (int i = 0; i < 64; ++i)
+    {
+        const float x = -4.0f + 8.0f * i / 63.0f;
+        world.spheres.push_back({ SpherePrimitive(glm::vec3(x, 1.2f + 0.05f * x * x, 1.0f), 0.02f), i % 8 == 0 ? mi11 : mi10 });
+    }
+
+    world.planes.push_back({ pl1, mi4 });
+
+    world.sphereFields.push_back({ sf1, mi9 });
+
+    return StartApp<VulkanAppBase>(world, hInstance, CommandLineArgs(__argc, __argv));
+}
\ No newline at end of file
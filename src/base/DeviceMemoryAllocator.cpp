@@ -0,0 +1,366 @@
+#include "DeviceMemoryAllocator.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <bit>
+
+void DeviceMemoryAllocator::Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, bool bufferDeviceAddress)
+{
+    m_device = logicalDevice;
+    m_bufferDeviceAddress = bufferDeviceAddress;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+    m_pools.resize(m_memoryProperties.memoryTypeCount * 2 * sizeClassesCount);
+    for (size_t i = 0; i < m_pools.size(); ++i)
+    {
+        m_pools[i].slotSize = VkDeviceSize(1) << (minSlotSizeLog2 + i % sizeClassesCount);
+        m_pools[i].slotsPerBlock = static_cast<uint32_t>(blockSize / m_pools[i].slotSize);
+    }
+}
+
+void DeviceMemoryAllocator::Deinit()
+{
+    if (m_allocationsCount != 0)
+    {
+        std::cerr << "DeviceMemoryAllocator: " << m_allocationsCount << " allocations are still alive on shutdown\n";
+    }
+
+    for (Pool& pool : m_pools)
+    {
+        for (Block& block : pool.blocks)
+        {
+            FreeDeviceMemory(block.memory, block.mapped);
+        }
+    }
+
+    m_pools.clear();
+}
+
+uint32_t DeviceMemoryAllocator::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+    {
+        if ((typeBits & (1u << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    VulkanUtils::FatalExit("Could not find a suitable memory type!", -1);
+    return UINT32_MAX;
+}
+
+VkDeviceMemory DeviceMemoryAllocator::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIdx, ResourceKind kind,
+    void*& mapped)
+{
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIdx;
+
+    // Any buffer sub-allocated from the memory may need its device address
+    VkMemoryAllocateFlagsInfo allocFlagsInfo{};
+    allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+    if (m_bufferDeviceAddress && kind == ResourceKind::Buffer)
+    {
+        allocInfo.pNext = &allocFlagsInfo;
+    }
+
+    VkDeviceMemory memory;
+    VK_CHECK_RESULT_MSG(vkAllocateMemory(m_device, &allocInfo, nullptr, &memory), "Failed to allocate device memory!");
+
+    mapped = nullptr;
+    if (m_memoryProperties.memoryTypes[memoryTypeIdx].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        VK_CHECK_RESULT(vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped));
+    }
+
+    return memory;
+}
+
+void DeviceMemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, void* mapped)
+{
+    if (memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    if (mapped)
+    {
+        vkUnmapMemory(m_device, memory);
+    }
+
+    vkFreeMemory(m_device, memory, nullptr);
+}
+
+DeviceAllocation DeviceMemoryAllocator::Allocate(const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags properties, ResourceKind kind)
+{
+    const uint32_t memoryTypeIdx = FindMemoryType(requirements.memoryTypeBits, properties);
+
+    DeviceAllocation allocation;
+    allocation.size = requirements.size;
+    allocation.requestedSize = requirements.size;
+
+    ++m_allocationsCount;
+    m_requestedBytes += requirements.size;
+
+    // Slots are aligned to their size, so the size class has to cover the alignment as well
+    const VkDeviceSize slotSize = std::bit_ceil(std::max({ requirements.size, requirements.alignment,
+        VkDeviceSize(1) << minSlotSizeLog2 }));
+
+    if (slotSize > (VkDeviceSize(1) << maxSlotSizeLog2))
+    {
+        allocation.memory = AllocateDeviceMemory(requirements.size, memoryTypeIdx, kind, allocation.mapped);
+
+        ++m_dedicatedAllocationsCount;
+        m_dedicatedBytes += requirements.size;
+        return allocation;
+    }
+
+    const uint32_t sizeClass = static_cast<uint32_t>(std::countr_zero(slotSize)) - minSlotSizeLog2;
+    allocation.poolIdx = (memoryTypeIdx * 2 + static_cast<uint32_t>(kind)) * sizeClassesCount + sizeClass;
+
+    Pool& pool = m_pools[allocation.poolIdx];
+
+    auto blockIt = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+        [](const Block& block) { return !block.freeSlots.empty(); });
+
+    if (blockIt == pool.blocks.end())
+    {
+        blockIt = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+            [](const Block& block) { return block.memory == VK_NULL_HANDLE; });
+
+        if (blockIt == pool.blocks.end())
+        {
+            blockIt = pool.blocks.emplace(pool.blocks.end());
+        }
+
+        blockIt->memory = AllocateDeviceMemory(blockSize, memoryTypeIdx, kind, blockIt->mapped);
+        blockIt->freeSlots.resize(pool.slotsPerBlock);
+        for (uint32_t i = 0; i < pool.slotsPerBlock; ++i)
+        {
+            // Popped from the back, so the lowest offsets are handed out first
+            blockIt->freeSlots[i] = pool.slotsPerBlock - 1 - i;
+        }
+    }
+
+    allocation.blockIdx = static_cast<uint32_t>(blockIt - pool.blocks.begin());
+    allocation.slotIdx = blockIt->freeSlots.back();
+    blockIt->freeSlots.pop_back();
+
+    allocation.memory = blockIt->memory;
+    allocation.offset = allocation.slotIdx * pool.slotSize;
+    if (blockIt->mapped)
+    {
+        allocation.mapped = static_cast<char*>(blockIt->mapped) + allocation.offset;
+    }
+
+    m_wastedBytes += pool.slotSize - requirements.size;
+
+    return allocation;
+}
+
+void DeviceMemoryAllocator::Free(DeviceAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    --m_allocationsCount;
+    m_requestedBytes -= allocation.requestedSize;
+
+    if (allocation.poolIdx == DeviceAllocation::dedicatedPoolIdx)
+    {
+        FreeDeviceMemory(allocation.memory, allocation.mapped);
+
+        --m_dedicatedAllocationsCount;
+        m_dedicatedBytes -= allocation.requestedSize;
+    }
+    else
+    {
+        Pool& pool = m_pools[allocation.poolIdx];
+        Block& block = pool.blocks[allocation.blockIdx];
+        block.freeSlots.push_back(allocation.slotIdx);
+
+        m_wastedBytes -= pool.slotSize - allocation.requestedSize;
+
+        // Give empty blocks back to the driver
+        if (block.freeSlots.size() == pool.slotsPerBlock)
+        {
+            FreeDeviceMemory(block.memory, block.mapped);
+            block = Block();
+        }
+    }
+
+    allocation = DeviceAllocation();
+}
+
+VkBuffer DeviceMemoryAllocator::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties, DeviceAllocation& allocation)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    VK_CHECK_RESULT_MSG(vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer), "Failed to create buffer!");
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
+
+    allocation = Allocate(memRequirements, properties, ResourceKind::Buffer);
+    VK_CHECK_RESULT(vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset));
+
+    return buffer;
+}
+
+void DeviceMemoryAllocator::DestroyBuffer(VkBuffer& buffer, DeviceAllocation& allocation)
+{
+    vkDestroyBuffer(m_device, buffer, nullptr);
+    buffer = VK_NULL_HANDLE;
+    Free(allocation);
+}
+
+VkImage DeviceMemoryAllocator::CreateImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties,
+    DeviceAllocation& allocation)
+{
+    VkImage image;
+    VK_CHECK_RESULT_MSG(vkCreateImage(m_device, &createInfo, nullptr, &image), "Failed to create image!");
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_device, image, &memRequirements);
+
+    const ResourceKind kind = createInfo.tiling == VK_IMAGE_TILING_LINEAR ? ResourceKind::Buffer : ResourceKind::Image;
+    allocation = Allocate(memRequirements, properties, kind);
+    VK_CHECK_RESULT(vkBindImageMemory(m_device, image, allocation.memory, allocation.offset));
+
+    return image;
+}
+
+void DeviceMemoryAllocator::DestroyImage(VkImage& image, DeviceAllocation& allocation)
+{
+    vkDestroyImage(m_device, image, nullptr);
+    image = VK_NULL_HANDLE;
+    Free(allocation);
+}
+
+DeviceMemoryAllocator::Stats DeviceMemoryAllocator::GetStats() const
+{
+    Stats stats;
+    stats.dedicatedAllocationsCount = m_dedicatedAllocationsCount;
+    stats.allocationsCount = m_allocationsCount;
+    stats.requestedBytes = m_requestedBytes;
+    stats.wastedBytes = m_wastedBytes;
+    stats.reservedBytes = m_dedicatedBytes;
+
+    for (const Pool& pool : m_pools)
+    {
+        for (const Block& block : pool.blocks)
+        {
+            if (block.memory != VK_NULL_HANDLE)
+            {
+                ++stats.blocksCount;
+                stats.reservedBytes += blockSize;
+                stats.freeBytes += block.freeSlots.size() * pool.slotSize;
+            }
+        }
+    }
+
+    return stats;
+}
+
+void DeviceMemoryAllocator::PrintStats(std::ostream& os) const
+{
+    const Stats stats = GetStats();
+    const double mb = 1024.0 * 1024.0;
+
+    os << "Device memory: " << stats.allocationsCount << " allocations in "
+        << stats.blocksCount << " blocks + " << stats.dedicatedAllocationsCount << " dedicated, "
+        << stats.reservedBytes / mb << " MiB reserved, "
+        << stats.requestedBytes / mb << " MiB requested, "
+        << stats.wastedBytes / mb << " MiB lost to size classes, "
+        << stats.freeBytes / mb << " MiB free in blocks\n";
+}
+
+void LinearArena::Init(DeviceMemoryAllocator& allocator, VkDeviceSize capacity, VkBufferUsageFlags usage)
+{
+    m_usage = usage;
+    m_capacity = capacity;
+    m_head = 0;
+    m_buffer = allocator.CreateBuffer(capacity, usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_allocation);
+}
+
+void LinearArena::Deinit(DeviceMemoryAllocator& allocator)
+{
+    allocator.DestroyBuffer(m_buffer, m_allocation);
+    m_capacity = 0;
+    m_head = 0;
+}
+
+void LinearArena::Reserve(DeviceMemoryAllocator& allocator, VkDeviceSize capacity)
+{
+    if (capacity > m_capacity)
+    {
+        const VkBufferUsageFlags usage = m_usage;
+        Deinit(allocator);
+        Init(allocator, capacity, usage);
+    }
+}
+
+LinearArena::Allocation LinearArena::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    const VkDeviceSize offset = (m_head + alignment - 1) / alignment * alignment;
+    if (offset + size > m_capacity)
+    {
+        return Allocation();
+    }
+
+    m_head = offset + size;
+
+    Allocation allocation;
+    allocation.buffer = m_buffer;
+    allocation.offset = offset;
+    allocation.mapped = static_cast<char*>(m_allocation.mapped) + offset;
+    return allocation;
+}
+
+void DeviceArray::Reserve(DeviceMemoryAllocator& allocator, VkDeviceSize size)
+{
+    if (size <= m_capacity)
+    {
+        return;
+    }
+
+    // Grow geometrically so an array growing a bit every upload doesn't reallocate every time
+    const VkDeviceSize capacity = std::max({ size, m_capacity + m_capacity / 2, minCapacity });
+
+    Release(allocator);
+
+    m_buffer = allocator.CreateBuffer(capacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_allocation);
+    m_capacity = capacity;
+
+    VkBufferDeviceAddressInfo addressInfo{};
+    addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    addressInfo.buffer = m_buffer;
+    m_address = vkGetBufferDeviceAddress(allocator.GetDevice(), &addressInfo);
+}
+
+void DeviceArray::Release(DeviceMemoryAllocator& allocator)
+{
+    if (m_buffer != VK_NULL_HANDLE)
+    {
+        allocator.DestroyBuffer(m_buffer, m_allocation);
+    }
+
+    m_capacity = 0;
+    m_address = 0;
+}
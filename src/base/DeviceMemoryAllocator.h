@@ -0,0 +1,170 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <ostream>
+#include <vector>
+
+// Range of device memory handed out by DeviceMemoryAllocator
+struct DeviceAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Persistently mapped address of the range, nullptr if the memory isn't host visible
+    void* mapped = nullptr;
+
+private:
+    friend class DeviceMemoryAllocator;
+
+    static constexpr uint32_t dedicatedPoolIdx = UINT32_MAX;
+
+    uint32_t poolIdx = dedicatedPoolIdx;
+    uint32_t blockIdx = 0;
+    uint32_t slotIdx = 0;
+    VkDeviceSize requestedSize = 0;
+};
+
+// Linear (buffers) and optimal tiling (images) resources never share a block,
+// so bufferImageGranularity never has to be taken into account
+enum class ResourceKind : uint32_t
+{
+    Buffer,
+    Image
+};
+
+// Sub-allocates device memory out of large blocks instead of calling vkAllocateMemory per resource.
+// Every (memory type, resource kind) pair has a pool per power of two size class, blocks of a pool are
+// split into equally sized slots, so an allocation is a free list pop. Requests above the largest size
+// class (render targets, big scene buffers) get a dedicated vkAllocateMemory.
+// Host visible blocks are mapped once at creation and stay mapped.
+class DeviceMemoryAllocator
+{
+public:
+    struct Stats
+    {
+        uint32_t blocksCount = 0;
+        uint32_t dedicatedAllocationsCount = 0;
+        uint32_t allocationsCount = 0;
+        // Device memory owned by blocks and dedicated allocations
+        VkDeviceSize reservedBytes = 0;
+        // Sum of the sizes resources asked for
+        VkDeviceSize requestedBytes = 0;
+        // Size class rounding of live allocations
+        VkDeviceSize wastedBytes = 0;
+        // Unused slots of live blocks
+        VkDeviceSize freeBytes = 0;
+    };
+
+    // With bufferDeviceAddress memory bound to buffers can be used with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+    void Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, bool bufferDeviceAddress);
+    void Deinit();
+
+    DeviceAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind);
+    void Free(DeviceAllocation& allocation);
+
+    VkBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, DeviceAllocation& allocation);
+    void DestroyBuffer(VkBuffer& buffer, DeviceAllocation& allocation);
+
+    VkImage CreateImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, DeviceAllocation& allocation);
+    void DestroyImage(VkImage& image, DeviceAllocation& allocation);
+
+    Stats GetStats() const;
+    void PrintStats(std::ostream& os) const;
+
+    VkDevice GetDevice() const { return m_device; }
+
+private:
+    static constexpr uint32_t minSlotSizeLog2 = 8;      // 256 B
+    static constexpr uint32_t maxSlotSizeLog2 = 22;     // 4 MiB
+    static constexpr uint32_t sizeClassesCount = maxSlotSizeLog2 - minSlotSizeLog2 + 1;
+    static constexpr VkDeviceSize blockSize = 16 * 1024 * 1024;
+
+    struct Block
+    {
+        // VK_NULL_HANDLE once the block has been released, the entry is reused by the next block of the pool
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        std::vector<uint32_t> freeSlots;
+    };
+
+    struct Pool
+    {
+        VkDeviceSize slotSize = 0;
+        uint32_t slotsPerBlock = 0;
+        std::vector<Block> blocks;
+    };
+
+    uint32_t FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+    VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIdx, ResourceKind kind, void*& mapped);
+    void FreeDeviceMemory(VkDeviceMemory memory, void* mapped);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    bool m_bufferDeviceAddress = false;
+
+    // Indexed by (memoryTypeIdx * 2 + kind) * sizeClassesCount + sizeClass
+    std::vector<Pool> m_pools;
+
+    uint32_t m_dedicatedAllocationsCount = 0;
+    uint32_t m_allocationsCount = 0;
+    VkDeviceSize m_dedicatedBytes = 0;
+    VkDeviceSize m_requestedBytes = 0;
+    VkDeviceSize m_wastedBytes = 0;
+};
+
+// Bump allocator over one persistently mapped buffer. Everything allocated from it is released at once
+// by Reset, which suits transient data like staging uploads and per frame constants.
+class LinearArena
+{
+public:
+    struct Allocation
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void* mapped = nullptr;
+    };
+
+    void Init(DeviceMemoryAllocator& allocator, VkDeviceSize capacity, VkBufferUsageFlags usage);
+    void Deinit(DeviceMemoryAllocator& allocator);
+
+    // Recreates the arena if it's smaller than capacity, nothing allocated from it may be in use
+    void Reserve(DeviceMemoryAllocator& allocator, VkDeviceSize capacity);
+
+    // Returns an allocation with a null buffer if the arena is exhausted
+    Allocation Allocate(VkDeviceSize size, VkDeviceSize alignment);
+    void Reset() { m_head = 0; }
+
+    VkBuffer GetBuffer() const { return m_buffer; }
+    VkDeviceSize GetCapacity() const { return m_capacity; }
+
+private:
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    DeviceAllocation m_allocation;
+    VkBufferUsageFlags m_usage = 0;
+    VkDeviceSize m_capacity = 0;
+    VkDeviceSize m_head = 0;
+};
+
+// Device local storage buffer used by shaders through its device address. It grows geometrically,
+// the content is lost when it's reallocated.
+class DeviceArray
+{
+public:
+    // Reallocates the buffer if it's smaller than size, the buffer must not be in use
+    void Reserve(DeviceMemoryAllocator& allocator, VkDeviceSize size);
+    void Release(DeviceMemoryAllocator& allocator);
+
+    VkBuffer GetBuffer() const { return m_buffer; }
+    VkDeviceAddress GetAddress() const { return m_address; }
+    VkDeviceSize GetCapacity() const { return m_capacity; }
+
+private:
+    // Zero sized buffers aren't allowed, empty arrays still get a valid address
+    static constexpr VkDeviceSize minCapacity = 256;
+
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    DeviceAllocation m_allocation;
+    VkDeviceSize m_capacity = 0;
+    VkDeviceAddress m_address = 0;
+};
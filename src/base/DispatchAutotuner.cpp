@@ -0,0 +1,252 @@
+#include "DispatchAutotuner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+namespace DispatchAutotuner
+{
+
+// Bump when the candidates set or the meaning of the cached values changes
+const uint32_t cacheVersion = 2;
+
+std::vector<ComputeDispatchConfig> GetCandidates(const VkPhysicalDeviceProperties& deviceProperties)
+{
+    const uint32_t shapes[][2] =
+    {
+        { 8, 8 }, { 16, 8 }, { 8, 16 }, { 16, 16 }, { 32, 4 }, { 32, 8 }, { 8, 32 }, { 32, 16 }, { 32, 32 }
+    };
+
+    // Strip widths and block sides, in tiles
+    const uint32_t swizzles[] = { 4, 8, 16 };
+
+    const VkPhysicalDeviceLimits& limits = deviceProperties.limits;
+
+    std::vector<ComputeDispatchConfig> candidates;
+    for (const auto& shape : shapes)
+    {
+        if (shape[0] > limits.maxComputeWorkGroupSize[0] || shape[1] > limits.maxComputeWorkGroupSize[1] ||
+            shape[0] * shape[1] > limits.maxComputeWorkGroupInvocations)
+        {
+            continue;
+        }
+
+        candidates.push_back({ .workgroupWidth = shape[0], .workgroupHeight = shape[1], .tileOrder = TileOrder::RowMajor });
+        for (TileOrder order : { TileOrder::Strips, TileOrder::Morton, TileOrder::Hilbert })
+        {
+            for (uint32_t swizzle : swizzles)
+            {
+                candidates.push_back({ .workgroupWidth = shape[0], .workgroupHeight = shape[1], .tileOrder = order, .tileSwizzle = swizzle });
+            }
+        }
+    }
+
+    return candidates;
+}
+
+static uint64_t HashFile(const std::string& fileName)
+{
+    std::ifstream is(fileName, std::ios::binary);
+    std::vector<char> content((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : content)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+std::string MakeCacheKey(const VkPhysicalDeviceProperties& deviceProperties, const std::string& shaderFileName)
+{
+    std::stringstream key;
+    key << std::hex << deviceProperties.vendorID << "-" << deviceProperties.deviceID << "-"
+        << deviceProperties.driverVersion << "-" << HashFile(shaderFileName) << "-v" << cacheVersion;
+    return key.str();
+}
+
+const char* GetTileOrderName(TileOrder order)
+{
+    switch (order)
+    {
+    case TileOrder::Strips:
+        return "strips";
+    case TileOrder::Morton:
+        return "morton";
+    case TileOrder::Hilbert:
+        return "hilbert";
+    default:
+        return "rowmajor";
+    }
+}
+
+// Even bits of a Morton code
+static uint32_t CompactBits(uint32_t v)
+{
+    v &= 0x55555555u;
+    v = (v | (v >> 1)) & 0x33333333u;
+    v = (v | (v >> 2)) & 0x0F0F0F0Fu;
+    v = (v | (v >> 4)) & 0x00FF00FFu;
+    v = (v | (v >> 8)) & 0x0000FFFFu;
+    return v;
+}
+
+static glm::uvec2 GetHilbertPoint(uint32_t side, uint32_t d)
+{
+    glm::uvec2 point(0);
+    for (uint32_t s = 1; s < side; s *= 2)
+    {
+        const uint32_t rx = 1 & (d / 2);
+        const uint32_t ry = 1 & (d ^ rx);
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                point = glm::uvec2(s - 1) - point;
+            }
+
+            point = glm::uvec2(point.y, point.x);
+        }
+
+        point += s * glm::uvec2(rx, ry);
+        d /= 4;
+    }
+
+    return point;
+}
+
+glm::uvec2 GetTileCoordinates(const ComputeDispatchConfig& config, uint32_t tile, glm::uvec2 groupCount)
+{
+    const uint32_t swizzle = config.tileSwizzle;
+    if (config.tileOrder == TileOrder::Strips)
+    {
+        const uint32_t stripSize = swizzle * groupCount.y;
+        const uint32_t strip = tile / stripSize;
+        const uint32_t idInStrip = tile % stripSize;
+        const uint32_t stripWidth = std::min(swizzle, groupCount.x - strip * swizzle);
+
+        return glm::uvec2(strip * swizzle + idInStrip % stripWidth, idInStrip / stripWidth);
+    }
+
+    if (config.tileOrder == TileOrder::Morton || config.tileOrder == TileOrder::Hilbert)
+    {
+        const uint32_t blockRow = tile / (swizzle * groupCount.x);
+        const uint32_t idInRow = tile % (swizzle * groupCount.x);
+        const uint32_t blockHeight = std::min(swizzle, groupCount.y - blockRow * swizzle);
+        const uint32_t block = idInRow / (swizzle * blockHeight);
+        const uint32_t idInBlock = idInRow % (swizzle * blockHeight);
+        const uint32_t blockWidth = std::min(swizzle, groupCount.x - block * swizzle);
+
+        const glm::uvec2 blockOrigin = glm::uvec2(block, blockRow) * swizzle;
+        if (blockWidth < swizzle || blockHeight < swizzle)
+        {
+            return blockOrigin + glm::uvec2(idInBlock % blockWidth, idInBlock / blockWidth);
+        }
+
+        if (config.tileOrder == TileOrder::Morton)
+        {
+            return blockOrigin + glm::uvec2(CompactBits(idInBlock), CompactBits(idInBlock >> 1));
+        }
+
+        return blockOrigin + GetHilbertPoint(swizzle, idInBlock);
+    }
+
+    return glm::uvec2(tile % groupCount.x, tile / groupCount.x);
+}
+
+float GetTileOrderFootprint(const ComputeDispatchConfig& config, glm::uvec2 groupCount, uint32_t windowTiles)
+{
+    const uint32_t tilesCount = groupCount.x * groupCount.y;
+    windowTiles = std::min(windowTiles, tilesCount);
+
+    std::vector<glm::uvec2> coordinates(tilesCount);
+    for (uint32_t tile = 0; tile < tilesCount; ++tile)
+    {
+        coordinates[tile] = GetTileCoordinates(config, tile, groupCount);
+    }
+
+    // Windows overlap, starting every quarter window: aligned windows would favour the orders of square blocks
+    const uint32_t windowStep = std::max(windowTiles / 4, 1u);
+    std::vector<uint32_t> tileWindows(tilesCount, UINT32_MAX);
+    float footprint = 0.0f;
+    uint32_t windowsCount = 0;
+    for (uint32_t windowStart = 0; windowStart + windowTiles <= tilesCount; windowStart += windowStep, ++windowsCount)
+    {
+        auto inWindow = [&](uint32_t x, uint32_t y)
+        {
+            return x < groupCount.x && y < groupCount.y && tileWindows[y * groupCount.x + x] == windowStart;
+        };
+
+        for (uint32_t tile = windowStart; tile < windowStart + windowTiles; ++tile)
+        {
+            tileWindows[coordinates[tile].y * groupCount.x + coordinates[tile].x] = windowStart;
+        }
+
+        // Edges of the tiles of the window not shared with another tile of the window
+        uint32_t outline = 0;
+        for (uint32_t tile = windowStart; tile < windowStart + windowTiles; ++tile)
+        {
+            const glm::uvec2 c = coordinates[tile];
+            outline += (inWindow(c.x - 1, c.y) ? 0 : 1) + (inWindow(c.x + 1, c.y) ? 0 : 1) +
+                (inWindow(c.x, c.y - 1) ? 0 : 1) + (inWindow(c.x, c.y + 1) ? 0 : 1);
+        }
+
+        footprint += outline / (4.0f * std::sqrt(static_cast<float>(windowTiles)));
+    }
+
+    return footprint / windowsCount;
+}
+
+std::optional<ComputeDispatchConfig> LoadFromCache(const std::string& cacheFileName, const std::string& key)
+{
+    std::ifstream is(cacheFileName);
+
+    std::string line;
+    while (std::getline(is, line))
+    {
+        std::istringstream entry(line);
+        std::string entryKey;
+        ComputeDispatchConfig config;
+        uint32_t tileOrder = 0;
+        if ((entry >> entryKey >> config.workgroupWidth >> config.workgroupHeight >> tileOrder >> config.tileSwizzle) && entryKey == key)
+        {
+            config.tileOrder = static_cast<TileOrder>(tileOrder);
+            return config;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void StoreToCache(const std::string& cacheFileName, const std::string& key, const ComputeDispatchConfig& config)
+{
+    // Keep results of the other devices, replace the one of this device
+    std::vector<std::string> lines;
+    {
+        std::ifstream is(cacheFileName);
+        std::string line;
+        while (std::getline(is, line))
+        {
+            if (!line.empty() && line.compare(0, key.size() + 1, key + " ") != 0)
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    std::ofstream os(cacheFileName, std::ios::trunc);
+    for (const std::string& line : lines)
+    {
+        os << line << "\n";
+    }
+
+    os << key << " " << config.workgroupWidth << " " << config.workgroupHeight << " "
+        << static_cast<uint32_t>(config.tileOrder) << " " << config.tileSwizzle << "\n";
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "GpuLayout.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// Order the workgroups of the trace take the tiles of the image in. Workgroups are scheduled roughly in the order of
+// their index, the order decides how far apart on screen the ones running at the same time are.
+enum class TileOrder : uint32_t
+{
+    // Rows of tiles as wide as the image
+    RowMajor = Gpu::tileOrderRowMajor,
+    // Column strips of tileSwizzle tiles, in rows inside the strips
+    Strips = Gpu::tileOrderStrips,
+    // Rows of blocks of tileSwizzle x tileSwizzle tiles, along a Z-order curve inside the blocks
+    Morton = Gpu::tileOrderMorton,
+    // Same blocks along a Hilbert curve, consecutive tiles are always neighbours
+    Hilbert = Gpu::tileOrderHilbert
+};
+
+// Workgroup shape and workgroup scheduling order of the raytracing compute shader.
+// Fed to the shader through specialization constants (see raytracing.comp).
+struct ComputeDispatchConfig
+{
+    uint32_t workgroupWidth = 16;
+    uint32_t workgroupHeight = 16;
+    TileOrder tileOrder = TileOrder::RowMajor;
+    // Width of the strips or side of the blocks of the tile order, in tiles. Blocks are a power of two.
+    uint32_t tileSwizzle = 0;
+
+    bool operator==(const ComputeDispatchConfig&) const = default;
+};
+
+namespace DispatchAutotuner
+{
+    // Configurations worth benchmarking on the device, filtered by its compute limits
+    std::vector<ComputeDispatchConfig> GetCandidates(const VkPhysicalDeviceProperties& deviceProperties);
+
+    // Identifies the device, driver and shader binary the tuning result is valid for
+    std::string MakeCacheKey(const VkPhysicalDeviceProperties& deviceProperties, const std::string& shaderFileName);
+
+    const char* GetTileOrderName(TileOrder order);
+
+    // Tile of the image the tile-th workgroup of a pass traces with the order of config, as raytracing.comp maps it
+    glm::uvec2 GetTileCoordinates(const ComputeDispatchConfig& config, uint32_t tile, glm::uvec2 groupCount);
+
+    // Screen footprint of the workgroups in flight, a proxy of how much of the scene their rays share in the caches:
+    // the outline of windows of windowTiles consecutive tiles of the order, over the outline of a square of as many
+    // tiles, averaged over the pass. 1 is as compact as it gets.
+    float GetTileOrderFootprint(const ComputeDispatchConfig& config, glm::uvec2 groupCount, uint32_t windowTiles);
+
+    std::optional<ComputeDispatchConfig> LoadFromCache(const std::string& cacheFileName, const std::string& key);
+    void StoreToCache(const std::string& cacheFileName, const std::string& key, const ComputeDispatchConfig& config);
+}
@@ -0,0 +1,265 @@
+#include "EnvironmentMap.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <numbers>
+
+namespace EnvironmentMap
+{
+
+static glm::vec3 DecodeRgbe(const uint8_t* rgbe)
+{
+    if (rgbe[3] == 0)
+    {
+        return glm::vec3(0.0f);
+    }
+
+    // Mantissas are in [0, 256), the exponent has a 128 bias
+    const float scale = std::ldexp(1.0f, static_cast<int>(rgbe[3]) - (128 + 8));
+    return glm::vec3(rgbe[0], rgbe[1], rgbe[2]) * scale;
+}
+
+// Scanline of width RGBE pixels, flat or in the run length encoding that stores the four components one after the other
+static bool ReadScanline(std::istream& is, uint32_t width, std::vector<uint8_t>& scanline)
+{
+    scanline.resize(width * 4);
+
+    uint8_t header[4];
+    if (!is.read(reinterpret_cast<char*>(header), 4))
+    {
+        return false;
+    }
+
+    const bool runLengthEncoded = width >= 8 && width < 0x8000 && header[0] == 2 && header[1] == 2 && (header[2] & 0x80) == 0;
+    if (!runLengthEncoded)
+    {
+        std::copy(header, header + 4, scanline.begin());
+        return static_cast<bool>(is.read(reinterpret_cast<char*>(scanline.data() + 4), (width - 1) * 4));
+    }
+
+    if (((uint32_t(header[2]) << 8) | header[3]) != width)
+    {
+        return false;
+    }
+
+    for (uint32_t component = 0; component < 4; ++component)
+    {
+        uint32_t x = 0;
+        while (x < width)
+        {
+            int count = is.get();
+            if (count == EOF)
+            {
+                return false;
+            }
+
+            // A run repeats the next byte, otherwise count bytes follow
+            const bool run = count > 128;
+            count = run ? count - 128 : count;
+            if (count == 0 || x + count > width)
+            {
+                return false;
+            }
+
+            if (run)
+            {
+                const int value = is.get();
+                if (value == EOF)
+                {
+                    return false;
+                }
+
+                for (int i = 0; i < count; ++i)
+                {
+                    scanline[(x++) * 4 + component] = static_cast<uint8_t>(value);
+                }
+            }
+            else
+            {
+                for (int i = 0; i < count; ++i)
+                {
+                    const int value = is.get();
+                    if (value == EOF)
+                    {
+                        return false;
+                    }
+
+                    scanline[(x++) * 4 + component] = static_cast<uint8_t>(value);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool LoadHdr(const std::string& fileName, Image& image)
+{
+    std::ifstream is(fileName, std::ios::binary);
+    if (!is)
+    {
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(is, line) || line.rfind("#?", 0) != 0)
+    {
+        return false;
+    }
+
+    // Header variables until an empty line, then the resolution
+    while (std::getline(is, line) && !line.empty())
+    {
+        if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe")
+        {
+            return false;
+        }
+    }
+
+    char yAxis[3] = {};
+    char xAxis[3] = {};
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (!std::getline(is, line) || std::sscanf(line.c_str(), "%2s %u %2s %u", yAxis, &height, xAxis, &width) != 4 ||
+        std::string(yAxis) != "-Y" || std::string(xAxis) != "+X" || width == 0 || height == 0)
+    {
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height);
+
+    std::vector<uint8_t> scanline;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        if (!ReadScanline(is, width, scanline))
+        {
+            return false;
+        }
+
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            image.pixels[size_t(y) * width + x] = DecodeRgbe(&scanline[x * 4]);
+        }
+    }
+
+    return true;
+}
+
+// Vose's alias method: every entry keeps its own pixel with probability threshold and gives the rest to its alias
+static void BuildAliasTable(const std::vector<double>& weights, std::vector<Gpu::EnvironmentAliasEntry>& table)
+{
+    const size_t count = weights.size();
+    table.resize(count);
+
+    double sum = 0.0;
+    for (double weight : weights)
+    {
+        sum += weight;
+    }
+
+    // A black map is sampled uniformly
+    std::vector<double> scaled(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        scaled[i] = sum > 0.0 ? weights[i] * count / sum : 1.0;
+        table[i].pdf = static_cast<float>(sum > 0.0 ? weights[i] / sum : 1.0 / count);
+        table[i].alias = static_cast<uint32_t>(i);
+        table[i].threshold = 1.0f;
+    }
+
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < count; ++i)
+    {
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        const uint32_t s = small.back();
+        small.pop_back();
+        const uint32_t l = large.back();
+
+        table[s].threshold = static_cast<float>(scaled[s]);
+        table[s].alias = l;
+
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // Whatever is left is 1 up to rounding errors
+}
+
+// Largest finite half float
+static constexpr float maxHalf = 65504.0f;
+
+Encoded Encode(const Image& image, float intensity)
+{
+    Encoded encoded;
+    encoded.width = image.width;
+    encoded.height = image.height;
+    encoded.pixels.resize(image.pixels.size());
+
+    std::vector<double> weights(image.pixels.size());
+    for (uint32_t y = 0; y < image.height; ++y)
+    {
+        // Solid angle of the pixels of the row, up to a constant
+        const double sinTheta = std::sin(std::numbers::pi * (y + 0.5) / image.height);
+        for (uint32_t x = 0; x < image.width; ++x)
+        {
+            const size_t idx = size_t(y) * image.width + x;
+            // Brighter values would turn into infinities, the sun of a map can be far above
+            const glm::vec3 clamped = glm::clamp(image.pixels[idx] * intensity, glm::vec3(0.0f), glm::vec3(maxHalf));
+            encoded.pixels[idx] = glm::uvec2(glm::packHalf2x16(glm::vec2(clamped.r, clamped.g)), glm::packHalf2x16(glm::vec2(clamped.b, 0.0f)));
+
+            // The probabilities follow what the shader reads back, rounding included
+            const glm::vec2 rg = glm::unpackHalf2x16(encoded.pixels[idx].x);
+            const glm::vec3 radiance(rg.r, rg.g, glm::unpackHalf2x16(encoded.pixels[idx].y).x);
+            const double luminance = 0.2126 * radiance.r + 0.7152 * radiance.g + 0.0722 * radiance.b;
+            weights[idx] = luminance * sinTheta;
+        }
+    }
+
+    BuildAliasTable(weights, encoded.aliasTable);
+    return encoded;
+}
+
+void PrintStats(std::ostream& os, const Encoded& environment)
+{
+    if (environment.pixels.empty())
+    {
+        return;
+    }
+
+    // Share of the samples going to the brightest 1% of the pixels
+    std::vector<float> pdfs(environment.aliasTable.size());
+    std::transform(environment.aliasTable.begin(), environment.aliasTable.end(), pdfs.begin(),
+        [](const Gpu::EnvironmentAliasEntry& entry) { return entry.pdf; });
+    const size_t topCount = std::max<size_t>(pdfs.size() / 100, 1);
+    std::nth_element(pdfs.begin(), pdfs.begin() + topCount, pdfs.end(), std::greater<float>());
+    float topShare = 0.0f;
+    for (size_t i = 0; i < topCount; ++i)
+    {
+        topShare += pdfs[i];
+    }
+
+    const size_t size = environment.pixels.size() * sizeof(glm::uvec2) + environment.aliasTable.size() * sizeof(Gpu::EnvironmentAliasEntry);
+    os << std::fixed << std::setprecision(1);
+    os << "Environment map: " << environment.width << "x" << environment.height << ", " << size / 1024 << " KiB, " <<
+        100.0f * topShare << "% of the light samples on the brightest 1% of the pixels\n";
+    os << std::defaultfloat;
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "GpuLayout.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Equirectangular HDR image lighting the rays that leave the scene. The tracer samples it directly at every
+// diffuse or glossy bounce, picking pixels from an alias table built over their luminance times the solid angle
+// they cover, so bright small sources like the sun are found without waiting for a bounce to hit them.
+namespace EnvironmentMap
+{
+    struct Image
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Linear RGB, row 0 at the top
+        std::vector<glm::vec3> pixels;
+    };
+
+    // Radiance .hdr file (RGBE pixels, flat or run length encoded scanlines, -Y H +X W orientation only)
+    bool LoadHdr(const std::string& fileName, Image& image);
+
+    // Device arrays of the map, empty when there's no map
+    struct Encoded
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Half float RGB, see Gpu::SceneInfo::environmentPixels
+        std::vector<glm::uvec2> pixels;
+        std::vector<Gpu::EnvironmentAliasEntry> aliasTable;
+    };
+
+    Encoded Encode(const Image& image, float intensity);
+
+    void PrintStats(std::ostream& os, const Encoded& environment);
+}
@@ -2,10 +2,65 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
+
 struct SpherePrimitive
 {
-    SpherePrimitive(const glm::vec3& inCenter, float inRadius) : center(inCenter), radius(inRadius) {}
+    SpherePrimitive(const glm::vec3& inCenter, float inRadius) : center(inCenter), centerEnd(inCenter), radius(inRadius) {}
+    // Moving sphere, its center goes linearly from inCenter to inCenterEnd while the shutter is open
+    SpherePrimitive(const glm::vec3& inCenter, const glm::vec3& inCenterEnd, float inRadius) : center(inCenter), centerEnd(inCenterEnd), radius(inRadius) {}
+
+    bool IsMoving() const { return centerEnd != center; }
 
+    // Center when the shutter opens
     glm::vec3 center;
+    // Center when the shutter closes
+    glm::vec3 centerEnd;
     float radius;
+};
+
+// Infinite plane through point, facing normal
+struct PlanePrimitive
+{
+    PlanePrimitive(const glm::vec3& point, const glm::vec3& inNormal) : normal(glm::normalize(inNormal)), distance(glm::dot(normal, point)) {}
+
+    glm::vec3 normal;
+    float distance;
+};
+
+// Parallelogram spanned by the two edges from origin, facing cross(edgeU, edgeV)
+struct QuadPrimitive
+{
+    QuadPrimitive(const glm::vec3& inOrigin, const glm::vec3& inEdgeU, const glm::vec3& inEdgeV) : origin(inOrigin), edgeU(inEdgeU), edgeV(inEdgeV) {}
+
+    glm::vec3 origin;
+    glm::vec3 edgeU;
+    glm::vec3 edgeV;
+};
+
+// Spheres generated by the tracer instead of being stored, for repetitive content like gravel, foam or stars.
+// The region is cut into cells of cellSize, a cell holds a sphere with probability density. Radii are uniformly
+// distributed between radiusMin and radiusMax, clamped to half the cell size so spheres stay inside their cell.
+// The same seed always gives the same spheres.
+struct SphereFieldPrimitive
+{
+    SphereFieldPrimitive(const glm::vec3& a, const glm::vec3& b, float inCellSize, uint32_t inSeed, float inDensity, float inRadiusMin, float inRadiusMax) :
+        boundsMin(glm::min(a, b)), boundsMax(glm::max(a, b)), cellSize(inCellSize), seed(inSeed), density(inDensity), radiusMin(inRadiusMin), radiusMax(inRadiusMax) {}
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    float cellSize;
+    uint32_t seed;
+    float density;
+    float radiusMin;
+    float radiusMax;
+};
+
+// Axis aligned box between two opposite corners
+struct BoxPrimitive
+{
+    BoxPrimitive(const glm::vec3& a, const glm::vec3& b) : boundsMin(glm::min(a, b)), boundsMax(glm::max(a, b)) {}
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
 };
\ No newline at end of file
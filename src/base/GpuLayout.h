@@ -0,0 +1,581 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Single source of the data layouts shared with the shaders.
+//
+// GPU_LAYOUT_STRUCTS expands to the C++ structs of the Gpu namespace below and, through the gpulayoutgen
+// tool (src/tools/gpulayoutgen), to shaders/gpu_layout.glsl, which is regenerated by the build.
+// Shaders access these structs with the scalar block layout (GL_EXT_scalar_block_layout): fields are only
+// aligned to their component size, which is also how the C++ compiler lays out 32 bit scalars and glm
+// vectors, so no padding is needed. Every struct is checked at compile time against the scalar rules.
+//
+// Field names are camelCase here and snake_case in GLSL (struct PackedSphere -> packed_sphere).
+// Comments inside the lists must use the /* */ form.
+
+#define GPU_LAYOUT_CONSTANTS(CONSTANT) \
+    CONSTANT(packedSceneEncoding, 0) \
+    CONSTANT(quantizedSceneEncoding, 1) \
+    /* Quantized spheres share the bounds of a chunk of consecutive spheres */ \
+    CONSTANT(sphereChunkSize, 256) \
+    /* Material type above the half float parameter in Material::typeParameter */ \
+    CONSTANT(materialTypeShift, 16) \
+    CONSTANT(lambertianMaterialType, 0) \
+    CONSTANT(metalMaterialType, 1) \
+    CONSTANT(dielectricMaterialType, 2) \
+    /* Material::albedo is the emitted radiance */ \
+    CONSTANT(emissiveMaterialType, 3) \
+    /* Acceleration structure walked by the trace */ \
+    CONSTANT(linearSceneAcceleration, 0) \
+    CONSTANT(lbvhSceneAcceleration, 1) \
+    CONSTANT(gridSceneAcceleration, 2) \
+    CONSTANT(wideBvhSceneAcceleration, 3) \
+    /* Set on BvhNode children that are leaves, the low bits are then a position in SceneInfo::bvhLeaves */ \
+    CONSTANT(bvhLeafFlag, 0x80000000u) \
+    /* Entries of the LBVH traversal stack. The prefix shared by the 32 bit keys of a node (extended by the sphere */ \
+    /* index where they're equal) grows at every level from at least 2 bits, so the nodes are at most 62 levels */ \
+    /* deep and the stack of the siblings left to visit never holds more than 63 of them. */ \
+    CONSTANT(bvhStackSize, 64) \
+    /* Keys sorted by a workgroup of the LBVH radix sort, also the workgroup size of the other build passes */ \
+    CONSTANT(lbvhBlockSize, 256) \
+    /* Bits of the Morton codes sorted by each radix sort pass */ \
+    CONSTANT(lbvhRadixBits, 4) \
+    /* Workgroup size of the grid build passes */ \
+    CONSTANT(gridWorkgroupSize, 256) \
+    /* Cells counted per workgroup of the first pass of the cell counts prefix sum, 4 per invocation */ \
+    CONSTANT(gridScanBlockSize, 1024) \
+    /* Spheres overlapping more cells are kept out of the grid and tested by every ray */ \
+    CONSTANT(gridMaxCellsPerSphere, 8) \
+    /* Children of a WideBvhNode */ \
+    CONSTANT(wideBvhWidth, 8) \
+    /* WideBvhNode::meta byte of a child: valid bit, spheres count of a leaf (0 for an internal node) and offset */ \
+    /* from WideBvhNode::childBase or WideBvhNode::sphereBase */ \
+    CONSTANT(wideBvhChildValid, 0x80) \
+    CONSTANT(wideBvhLeafCountShift, 5) \
+    CONSTANT(wideBvhOffsetMask, 0x1F) \
+    CONSTANT(wideBvhMaxLeafSpheres, 3) \
+    /* Entries of the wide BVH traversal stack, WideBvh::Build rejects the trees it can't hold */ \
+    CONSTANT(wideBvhStackSize, 64) \
+    /* Set on LightBvhNode::child of the leaves, the low bits are then a position in SceneInfo::lights */ \
+    CONSTANT(lightBvhLeafFlag, 0x80000000u) \
+    /* Side of the square workgroups of the ReSTIR passes */ \
+    CONSTANT(restirWorkgroupSize, 8) \
+    /* Light samples drawn per pixel by the initial ReSTIR pass */ \
+    CONSTANT(restirCandidatesCount, 8) \
+    /* Neighbours resampled by the spatial ReSTIR pass, picked within the radius in pixels */ \
+    CONSTANT(restirSpatialNeighbours, 5) \
+    CONSTANT(restirSpatialRadius, 30) \
+    /* The reservoir of the previous frame counts for at most this many times the candidates of the current one */ \
+    CONSTANT(restirMaxHistory, 20) \
+    /* RestirReservoir::light of the empty reservoirs */ \
+    CONSTANT(restirNoLight, 0xFFFFFFFFu) \
+    /* Entries of the radiance cache hash grid, searched by buckets */ \
+    CONSTANT(radianceCacheCapacity, 1u << 20) \
+    CONSTANT(radianceCacheBucketSize, 8) \
+    /* Workgroup size of the radiance cache resolve pass */ \
+    CONSTANT(radianceCacheWorkgroupSize, 256) \
+    /* Radiance of the paths is summed in fixed point, with 8 fractional bits */ \
+    CONSTANT(radianceCacheFixedPointScale, 256) \
+    /* Samples an entry needs before paths end on it, and at most averaged into it. The cap makes the older */ \
+    /* samples fade out, the cache follows changes of the lighting and of the scene. */ \
+    CONSTANT(radianceCacheMinSamples, 8) \
+    CONSTANT(radianceCacheMaxSamples, 128) \
+    /* Frames without samples an entry is kept for */ \
+    CONSTANT(radianceCacheMaxAge, 64) \
+    /* One path in this many never ends on the cache, they keep teaching it the light of the longer paths */ \
+    CONSTANT(radianceCacheTrainingRatio, 8) \
+    /* Rough vertices of a path added to the cache */ \
+    CONSTANT(radianceCachePathVertices, 4) \
+    /* Cells of the path guiding hash grid, searched by buckets */ \
+    CONSTANT(guidingCapacity, 1u << 16) \
+    CONSTANT(guidingBucketSize, 8) \
+    /* The incident light distribution of a cell is a guidingResolution x guidingResolution histogram over the */ \
+    /* sphere of directions, equal area bins in cos theta and phi around the vertical axis */ \
+    CONSTANT(guidingResolution, 8) \
+    CONSTANT(guidingBins, 64) \
+    /* Workgroup size of the path guiding build pass */ \
+    CONSTANT(guidingWorkgroupSize, 256) \
+    /* Training samples a cell needs for a new distribution, fewer carry over to the next iteration */ \
+    CONSTANT(guidingMinSamples, 32) \
+    /* Training samples are summed in fixed point, with 6 fractional bits */ \
+    CONSTANT(guidingFixedPointScale, 64) \
+    /* Guided vertices of a path that train the distributions */ \
+    CONSTANT(guidingPathVertices, 4) \
+    /* Light transport of the trace, specialization constant 3 of raytracing.comp */ \
+    CONSTANT(pathIntegrator, 0) \
+    CONSTANT(bidirectionalIntegrator, 1) \
+    /* Order of the tiles of the trace, specialization constant 5 of raytracing.comp */ \
+    CONSTANT(tileOrderRowMajor, 0) \
+    CONSTANT(tileOrderStrips, 1) \
+    CONSTANT(tileOrderMorton, 2) \
+    CONSTANT(tileOrderHilbert, 3) \
+    /* Vertices of the camera and of the light subpaths of the bidirectional integrator, endpoints included */ \
+    CONSTANT(bdptMaxVertices, 8) \
+    /* Light tracing splats are summed in fixed point, with 10 fractional bits. A splat is clamped to */ \
+    /* bdptMaxSplat units so that a pass can't overflow the sums of a pixel. */ \
+    CONSTANT(bdptFixedPointScale, 1024) \
+    CONSTANT(bdptMaxSplat, 1u << 20) \
+    /* Side of the square workgroups of the splat resolve pass */ \
+    CONSTANT(bdptWorkgroupSize, 8) \
+    /* Workgroup size of the wavefront passes, one path or queue entry per invocation */ \
+    CONSTANT(wavefrontWorkgroupSize, 256) \
+    /* WavefrontPath::flags */ \
+    CONSTANT(wavefrontPathActive, 1) \
+    CONSTANT(wavefrontPathBsdfDelta, 2) \
+    /* WavefrontPath::pixel of the paths past the image */ \
+    CONSTANT(wavefrontNoPixel, 0xFFFFFFFFu) \
+    /* Bits of the ray sort keys: 3 bits per coordinate of the octahedral ray direction, above 6 bits per */ \
+    /* coordinate of the position of the ray origin seen from the camera (octahedral direction and half octaves */ \
+    /* of distance), interleaved. The paths that ended get the largest key and are sorted behind the others. */ \
+    CONSTANT(raySortKeyBits, 24) \
+    CONSTANT(raySortEndedKey, 0xFFFFFFu)
+
+#define GPU_LAYOUT_STRUCTS(STRUCT, FIELD, END) \
+    /* Packed encoding sphere */ \
+    STRUCT(PackedSphere) \
+        FIELD(glm::vec3, center, {}) \
+        FIELD(float, radius, 0.0f) \
+    END(PackedSphere) \
+    /* Quantized encoding sphere: unorm16 position and radius relative to the chunk */ \
+    STRUCT(QuantizedSphere) \
+        FIELD(uint32_t, xy, 0) \
+        FIELD(uint32_t, zr, 0) \
+    END(QuantizedSphere) \
+    STRUCT(SphereChunk) \
+        FIELD(glm::vec3, origin, {}) \
+        FIELD(glm::vec3, extent, {}) \
+        FIELD(float, maxRadius, 0.0f) \
+    END(SphereChunk) \
+    /* Entry of the material table, spheres refer to it with 16 bit indices packed by two in a uint */ \
+    STRUCT(Material) \
+        FIELD(glm::vec3, albedo, {}) \
+        /* Type in the high bits, half float roughness (metal) or refraction index (dielectric) in the low 16 bits */ \
+        FIELD(uint32_t, typeParameter, 0) \
+    END(Material) \
+    /* Unbounded plane, the points p with dot(normal, p) == distance */ \
+    STRUCT(Plane) \
+        FIELD(glm::vec3, normal, {}) \
+        FIELD(float, distance, 0.0f) \
+        FIELD(uint32_t, materialIdx, 0) \
+    END(Plane) \
+    /* Parallelogram, the points origin + s * edgeU + t * edgeV with s and t in [0, 1] */ \
+    STRUCT(Quad) \
+        FIELD(glm::vec3, origin, {}) \
+        FIELD(uint32_t, materialIdx, 0) \
+        FIELD(glm::vec3, edgeU, {}) \
+        FIELD(glm::vec3, edgeV, {}) \
+    END(Quad) \
+    /* Axis aligned box */ \
+    STRUCT(Box) \
+        FIELD(glm::vec3, boundsMin, {}) \
+        FIELD(uint32_t, materialIdx, 0) \
+        FIELD(glm::vec3, boundsMax, {}) \
+    END(Box) \
+    /* Procedural spheres, at most one per cell of a grid, generated from a hash of the seed and the cell */ \
+    /* coordinates by the traversal. Spheres stay inside their cell. */ \
+    STRUCT(SphereField) \
+        FIELD(glm::vec3, boundsMin, {}) \
+        FIELD(float, cellSize, 0.0f) \
+        FIELD(glm::uvec3, resolution, {}) \
+        FIELD(uint32_t, seed, 0) \
+        /* Probability that a cell holds a sphere */ \
+        FIELD(float, density, 0.0f) \
+        FIELD(float, radiusMin, 0.0f) \
+        FIELD(float, radiusMax, 0.0f) \
+        FIELD(uint32_t, materialIdx, 0) \
+    END(SphereField) \
+    /* Alias table entry of an environment map pixel: the pixel is picked if a uniform number is below threshold, */ \
+    /* alias otherwise. pdf is the probability of the pixel itself. */ \
+    STRUCT(EnvironmentAliasEntry) \
+        FIELD(float, threshold, 0.0f) \
+        FIELD(uint32_t, alias, 0) \
+        FIELD(float, pdf, 0.0f) \
+    END(EnvironmentAliasEntry) \
+    /* Node of the light hierarchy, built on the host over the emissive spheres. Bounds the positions of the lights */ \
+    /* below it, their total power and the cone of their emission directions: the axis, the spread of the light normals */ \
+    /* around it (cosThetaO) and how far from their normal they emit (cosThetaE). Node 0 is the root. */ \
+    STRUCT(LightBvhNode) \
+        FIELD(glm::vec3, boundsMin, {}) \
+        FIELD(float, power, 0.0f) \
+        FIELD(glm::vec3, boundsMax, {}) \
+        FIELD(float, cosThetaO, 0.0f) \
+        FIELD(glm::vec3, axis, {}) \
+        FIELD(float, cosThetaE, 0.0f) \
+        /* Internal nodes: the second child, the first one is the next node. Leaves: lightBvhLeafFlag and the light. */ \
+        FIELD(uint32_t, child, 0) \
+    END(LightBvhNode) \
+    /* Emissive sphere, lights are sorted by sphere so the one hit by a ray can be found by a binary search */ \
+    STRUCT(Light) \
+        /* Path from the root to the leaf of the light, bit d set if the second child is taken at depth d */ \
+        FIELD(glm::uvec2, bitTrail, {}) \
+        FIELD(uint32_t, sphere, 0) \
+    END(Light) \
+    /* Internal node of the LBVH, node 0 is the root */ \
+    STRUCT(BvhNode) \
+        FIELD(glm::vec3, boundsMin, {}) \
+        FIELD(uint32_t, leftChild, 0) \
+        FIELD(glm::vec3, boundsMax, {}) \
+        FIELD(uint32_t, rightChild, 0) \
+    END(BvhNode) \
+    /* Bounds of an LBVH node when the shutter closes, the BvhNode ones are at the shutter opening. Moving spheres */ \
+    /* are bounded by the box interpolated at the ray time. */ \
+    STRUCT(MotionBounds) \
+        FIELD(glm::vec3, boundsMin, {}) \
+        FIELD(glm::vec3, boundsMax, {}) \
+    END(MotionBounds) \
+    /* Wide BVH node, built on the host. The bounds of the children are quantized to 8 bits on a grid with a power */ \
+    /* of two cell size per axis, one byte per child slot in every uvec2 */ \
+    STRUCT(WideBvhNode) \
+        FIELD(glm::vec3, origin, {}) \
+        /* Biased float exponents of the cell size, x, y and z in the low three bytes */ \
+        FIELD(uint32_t, exponents, 0) \
+        /* Internal children are consecutive nodes, leaf children consecutive spheres */ \
+        FIELD(uint32_t, childBase, 0) \
+        FIELD(uint32_t, sphereBase, 0) \
+        FIELD(glm::uvec2, meta, {}) \
+        FIELD(glm::uvec2, lowX, {}) \
+        FIELD(glm::uvec2, lowY, {}) \
+        FIELD(glm::uvec2, lowZ, {}) \
+        FIELD(glm::uvec2, highX, {}) \
+        FIELD(glm::uvec2, highY, {}) \
+        FIELD(glm::uvec2, highZ, {}) \
+    END(WideBvhNode) \
+    /* Uniform grid over the sphere bounds, written by the grid build */ \
+    STRUCT(GridInfo) \
+        FIELD(glm::vec3, boundsMin, {}) \
+        FIELD(uint32_t, largeSpheresCount, 0) \
+        FIELD(glm::vec3, boundsMax, {}) \
+        FIELD(glm::vec3, cellSize, {}) \
+        FIELD(glm::uvec3, resolution, {}) \
+    END(GridInfo) \
+    /* Scene arrays addresses, fetched by the shader through the address in the push constants */ \
+    STRUCT(SceneInfo) \
+        FIELD(uint64_t, sphereGeometry, 0) \
+        FIELD(uint64_t, sphereMaterials, 0) \
+        FIELD(uint64_t, sphereChunks, 0) \
+        FIELD(uint64_t, materials, 0) \
+        /* Scenes with moving spheres only: displacement of every sphere center while the shutter is open */ \
+        FIELD(uint64_t, sphereMotion, 0) \
+        /* LBVH only: spheresCount - 1 nodes, and the sphere indices in Morton order */ \
+        FIELD(uint64_t, bvhNodes, 0) \
+        FIELD(uint64_t, bvhLeaves, 0) \
+        /* LBVH of a scene with moving spheres only: MotionBounds of every node */ \
+        FIELD(uint64_t, bvhMotionBounds, 0) \
+        /* Grid only: GridInfo, end of the references of every cell, sphere references sorted by cell, */ \
+        /* and the spheres too large for the grid */ \
+        FIELD(uint64_t, gridInfo, 0) \
+        FIELD(uint64_t, gridCells, 0) \
+        FIELD(uint64_t, gridReferences, 0) \
+        FIELD(uint64_t, gridLargeSpheres, 0) \
+        /* Wide BVH only: nodes, node 0 is the root. The spheres are stored in the order of the leaves */ \
+        FIELD(uint64_t, wideBvhNodes, 0) \
+        /* Few large primitives, tested by every ray before the spheres and kept out of the acceleration structures */ \
+        FIELD(uint64_t, planes, 0) \
+        FIELD(uint64_t, quads, 0) \
+        FIELD(uint64_t, boxes, 0) \
+        FIELD(uint64_t, sphereFields, 0) \
+        /* Equirectangular environment map as half float RGB (packHalf2x16(r, g), packHalf2x16(b, 0)) per pixel, */ \
+        /* row 0 at the top (+Y), and its EnvironmentAliasEntry table. No map if environmentWidth is 0. */ \
+        FIELD(uint64_t, environmentPixels, 0) \
+        FIELD(uint64_t, environmentAliasTable, 0) \
+        /* Light hierarchy over the emissive spheres and its lights, no light if lightsCount is 0 */ \
+        FIELD(uint64_t, lightBvhNodes, 0) \
+        FIELD(uint64_t, lights, 0) \
+        FIELD(uint32_t, spheresCount, 0) \
+        FIELD(uint32_t, encoding, 0) \
+        FIELD(uint32_t, acceleration, 0) \
+        FIELD(uint32_t, planesCount, 0) \
+        FIELD(uint32_t, quadsCount, 0) \
+        FIELD(uint32_t, boxesCount, 0) \
+        FIELD(uint32_t, sphereFieldsCount, 0) \
+        /* Non zero if sphereMotion is set */ \
+        FIELD(uint32_t, hasSphereMotion, 0) \
+        FIELD(uint32_t, environmentWidth, 0) \
+        FIELD(uint32_t, environmentHeight, 0) \
+        FIELD(uint32_t, lightsCount, 0) \
+        FIELD(uint32_t, padding, 0) \
+    END(SceneInfo) \
+    STRUCT(ComputeUniforms) \
+        FIELD(glm::vec3, cameraPosition, {}) \
+        FIELD(float, aspectRatio, 1.0f) \
+        FIELD(glm::vec3, cameraDirection, {}) \
+        /* Variation angle of rays through each pixel */ \
+        FIELD(float, defocusAngle, 1.0f) \
+        /* Distance from camera lookfrom point to plane of perfect focus */ \
+        FIELD(float, focusDist, 3.0f) \
+        FIELD(uint32_t, samplesPerPixel, 5) \
+        FIELD(uint32_t, maxDepth, 15) \
+        /* Range of workgroup tiles traced by the dispatch */ \
+        FIELD(uint32_t, tileOffset, 0) \
+        FIELD(uint32_t, tilesCount, 0) \
+        /* Passes already summed in the accumulation image, 0 restarts the accumulation */ \
+        FIELD(uint32_t, accumulatedPasses, 0) \
+        /* Non-zero when the passes are summed in the accumulation image, without it only the result image is written */ \
+        FIELD(uint32_t, accumulate, 0) \
+    END(ComputeUniforms) \
+    STRUCT(ComputePushConstants) \
+        /* Address of the SceneInfo */ \
+        FIELD(uint64_t, scene, 0) \
+        /* RestirReservoir of every pixel for the direct light of the camera ray hits, 0 without ReSTIR */ \
+        FIELD(uint64_t, restirReservoirs, 0) \
+        /* RadianceCacheEntry array, 0 without the radiance cache */ \
+        FIELD(uint64_t, radianceCache, 0) \
+        /* GuidingInfo, 0 without path guiding */ \
+        FIELD(uint64_t, guiding, 0) \
+        /* Bidirectional integrator: fixed point RGB sums of the light tracing splats of the pass, 3 uints per */ \
+        /* pixel, and the vec3 sum of the splats of the completed passes of every pixel. 0 with the path integrator. */ \
+        FIELD(uint64_t, bdptSplats, 0) \
+        FIELD(uint64_t, bdptLight, 0) \
+        /* Wavefront passes only (see WavefrontTracer): WavefrontPath of every path of the batch, the paths in the */ \
+        /* order the invocations of the extend pass take them, and the sort key of the next ray of every entry of */ \
+        /* that queue, 0 when the next bounce isn't sorted */ \
+        FIELD(uint64_t, wavefrontPaths, 0) \
+        FIELD(uint64_t, wavefrontQueue, 0) \
+        FIELD(uint64_t, wavefrontSortKeys, 0) \
+        /* Paths of the batch, a path per pixel of its tiles of wavefrontTileWidth x wavefrontTileHeight pixels */ \
+        FIELD(uint32_t, wavefrontPathsCount, 0) \
+        FIELD(uint32_t, wavefrontTileWidth, 0) \
+        FIELD(uint32_t, wavefrontTileHeight, 0) \
+        /* Sample of the pixels started by the generate pass */ \
+        FIELD(uint32_t, wavefrontSample, 0) \
+        /* TraceCounters of the persistent threads trace, and of the lane statistics */ \
+        FIELD(uint64_t, traceCounters, 0) \
+        /* Non zero to count the busy lanes of every bounce in the trace counters */ \
+        FIELD(uint32_t, laneStatistics, 0) \
+        FIELD(uint32_t, padding, 0) \
+    END(ComputePushConstants) \
+    /* Counters of the trace, reset before every dispatch that uses them */ \
+    STRUCT(TraceCounters) \
+        /* Persistent threads: next pixel of the batch, in tiles order */ \
+        FIELD(uint32_t, nextWork, 0) \
+        /* Lane statistics: lanes tracing a bounce, out of the lanes of their subgroups */ \
+        FIELD(uint32_t, busyLanes, 0) \
+        FIELD(uint32_t, lanes, 0) \
+    END(TraceCounters) \
+    /* Path of the path integrator traced by the wavefront passes, between two bounces */ \
+    STRUCT(WavefrontPath) \
+        /* Next ray */ \
+        FIELD(glm::vec3, origin, {}) \
+        FIELD(float, time, 0.0f) \
+        FIELD(glm::vec3, direction, {}) \
+        /* Solid angle pdf of the BSDF sample of the ray, for MIS against the light samples */ \
+        FIELD(float, bsdfPdf, 0.0f) \
+        FIELD(glm::vec3, throughput, {}) \
+        /* Random generator state, carried over from one pass to the next */ \
+        FIELD(uint32_t, state, 0) \
+        /* Sum of the radiance of the samples of the pixel */ \
+        FIELD(glm::vec3, radiance, {}) \
+        /* x in the low 16 bits, y in the high ones, wavefrontNoPixel past the image */ \
+        FIELD(uint32_t, pixel, 0) \
+        /* Surface the ray left */ \
+        FIELD(glm::vec3, bsdfPoint, {}) \
+        FIELD(uint32_t, flags, 0) \
+        FIELD(glm::vec3, bsdfNormal, {}) \
+    END(WavefrontPath) \
+    /* Shared by the LBVH build passes, each one only uses some of the arrays */ \
+    STRUCT(LbvhPushConstants) \
+        FIELD(uint64_t, scene, 0) \
+        /* Scene bounds of the sphere centers, as order preserving uints */ \
+        FIELD(uint64_t, bounds, 0) \
+        /* Radix sort pass input and output */ \
+        FIELD(uint64_t, keysIn, 0) \
+        FIELD(uint64_t, valuesIn, 0) \
+        FIELD(uint64_t, keysOut, 0) \
+        FIELD(uint64_t, valuesOut, 0) \
+        /* Digit counts per workgroup, digit major */ \
+        FIELD(uint64_t, histogram, 0) \
+        /* Parent of every node, internal ones first, then leaves */ \
+        FIELD(uint64_t, parents, 0) \
+        /* Children of each internal node whose bounds are known */ \
+        FIELD(uint64_t, visits, 0) \
+        FIELD(uint32_t, count, 0) \
+        /* Lowest bit of the digit sorted by the radix sort pass */ \
+        FIELD(uint32_t, shift, 0) \
+    END(LbvhPushConstants) \
+    /* Shared by the grid build passes */ \
+    STRUCT(GridPushConstants) \
+        FIELD(uint64_t, scene, 0) \
+        /* Scene bounds of the spheres, as order preserving uints */ \
+        FIELD(uint64_t, bounds, 0) \
+        /* Sums of the blocks of cell counts */ \
+        FIELD(uint64_t, blockSums, 0) \
+        FIELD(uint32_t, count, 0) \
+        /* Size of the cells array, the grid has at most as many cells */ \
+        FIELD(uint32_t, cellsCapacity, 0) \
+    END(GridPushConstants) \
+    /* Dynamic scenes: spheres orbit around the vertical axis */ \
+    STRUCT(AnimationPushConstants) \
+        FIELD(uint64_t, scene, 0) \
+        FIELD(float, deltaTime, 0.0f) \
+        FIELD(float, angularSpeed, 0.0f) \
+    END(AnimationPushConstants) \
+    /* Light sample kept by a pixel: a point of an emissive sphere, stored as its direction from the center so it */ \
+    /* follows the sphere when it moves */ \
+    STRUCT(RestirReservoir) \
+        /* Index of the sphere in the encoded arrays, restirNoLight if empty */ \
+        FIELD(uint32_t, light, 0xFFFFFFFFu) \
+        /* Octahedral unit vector, two 16 bit unorms */ \
+        FIELD(uint32_t, direction, 0) \
+        /* Unbiased contribution weight W: the sum of the resampling weights over the target function of the sample */ \
+        /* and the candidates count */ \
+        FIELD(float, weight, 0.0f) \
+        /* Candidates the reservoir stands for (M) */ \
+        FIELD(float, candidatesCount, 0.0f) \
+    END(RestirReservoir) \
+    /* Hit of the ray through the center of a pixel, the shading point of its reservoir */ \
+    STRUCT(RestirSurface) \
+        /* Along the normalized ray direction, 0 if the ray left the scene */ \
+        FIELD(float, distance, 0.0f) \
+        /* Octahedral unit vector facing the ray, two 16 bit snorms */ \
+        FIELD(uint32_t, normal, 0) \
+        FIELD(uint32_t, materialIdx, 0) \
+    END(RestirSurface) \
+    /* Shared by the ReSTIR passes, each one only uses some of the arrays */ \
+    STRUCT(RestirPushConstants) \
+        FIELD(uint64_t, scene, 0) \
+        FIELD(uint64_t, surfaces, 0) \
+        FIELD(uint64_t, previousSurfaces, 0) \
+        /* Written by the initial pass, combined in place with the previous frame by the temporal pass */ \
+        FIELD(uint64_t, reservoirs, 0) \
+        /* Output of the spatial pass of the previous frame */ \
+        FIELD(uint64_t, previousReservoirs, 0) \
+        /* Output of the spatial pass, used by the tracer */ \
+        FIELD(uint64_t, finalReservoirs, 0) \
+        FIELD(glm::vec3, cameraPosition, {}) \
+        FIELD(float, aspectRatio, 1.0f) \
+        FIELD(glm::vec3, cameraDirection, {}) \
+        FIELD(uint32_t, width, 0) \
+        FIELD(glm::vec3, previousCameraPosition, {}) \
+        FIELD(uint32_t, height, 0) \
+        FIELD(glm::vec3, previousCameraDirection, {}) \
+        /* Seeds the random numbers of the frame */ \
+        FIELD(uint32_t, frame, 0) \
+        /* 0 when the previous surfaces and reservoirs can't be reused */ \
+        FIELD(uint32_t, historyValid, 0) \
+        FIELD(uint32_t, padding, 0) \
+    END(RestirPushConstants) \
+    /* Light leaving the rough surfaces of a cell of the radiance cache */ \
+    STRUCT(RadianceCacheEntry) \
+        /* Hash of the cell, 0 if the entry is free */ \
+        FIELD(uint32_t, key, 0) \
+        /* Frames since the last samples */ \
+        FIELD(uint32_t, age, 0) \
+        /* Samples of the frame being traced, in fixed point */ \
+        FIELD(uint32_t, frameRed, 0) \
+        FIELD(uint32_t, frameGreen, 0) \
+        FIELD(uint32_t, frameBlue, 0) \
+        FIELD(uint32_t, frameSamples, 0) \
+        /* Average of the resolved frames, read by the paths */ \
+        FIELD(glm::vec3, radiance, {}) \
+        FIELD(uint32_t, samples, 0) \
+    END(RadianceCacheEntry) \
+    STRUCT(RadianceCachePushConstants) \
+        FIELD(uint64_t, entries, 0) \
+    END(RadianceCachePushConstants) \
+    /* Cell of the path guiding hash grid */ \
+    STRUCT(GuidingCell) \
+        /* Hash of the cell, 0 if the entry is free */ \
+        FIELD(uint32_t, key, 0) \
+        /* Training samples of the iteration */ \
+        FIELD(uint32_t, samples, 0) \
+    END(GuidingCell) \
+    /* Arrays of the path guiding, guidingBins values per cell */ \
+    STRUCT(GuidingInfo) \
+        FIELD(uint64_t, cells, 0) \
+        /* Training iteration: sums of the incident light estimates of the bins, in fixed point */ \
+        FIELD(uint64_t, histograms, 0) \
+        /* Sampled distributions built from the previous iterations: float cumulative probabilities of the bins, */ \
+        /* the last one is 0 if the cell has none */ \
+        FIELD(uint64_t, distributions, 0) \
+    END(GuidingInfo) \
+    STRUCT(GuidingPushConstants) \
+        FIELD(uint64_t, info, 0) \
+    END(GuidingPushConstants)
+
+namespace Gpu
+{
+    // GLSL type and scalar block layout alignment of the C++ types the layouts can use
+    template<typename T>
+    struct TypeInfo;
+
+#define GPU_LAYOUT_TYPE(CppType, glslType, glslAlignment)                   \
+    template<>                                                              \
+    struct TypeInfo<CppType>                                                \
+    {                                                                       \
+        static constexpr const char* glsl = glslType;                       \
+        static constexpr size_t alignment = glslAlignment;                  \
+    };
+
+    GPU_LAYOUT_TYPE(float, "float", 4)
+    GPU_LAYOUT_TYPE(int32_t, "int", 4)
+    GPU_LAYOUT_TYPE(uint32_t, "uint", 4)
+    GPU_LAYOUT_TYPE(glm::vec2, "vec2", 4)
+    GPU_LAYOUT_TYPE(glm::vec3, "vec3", 4)
+    GPU_LAYOUT_TYPE(glm::vec4, "vec4", 4)
+    GPU_LAYOUT_TYPE(glm::ivec2, "ivec2", 4)
+    GPU_LAYOUT_TYPE(glm::ivec3, "ivec3", 4)
+    GPU_LAYOUT_TYPE(glm::ivec4, "ivec4", 4)
+    GPU_LAYOUT_TYPE(glm::uvec2, "uvec2", 4)
+    GPU_LAYOUT_TYPE(glm::uvec3, "uvec3", 4)
+    GPU_LAYOUT_TYPE(glm::uvec4, "uvec4", 4)
+    // Device addresses, read as uvec2 and cast to buffer references (GL_EXT_buffer_reference_uvec2)
+    GPU_LAYOUT_TYPE(uint64_t, "uvec2", 4)
+
+#undef GPU_LAYOUT_TYPE
+
+#define GPU_LAYOUT_DECLARE_CONSTANT(name, value) constexpr uint32_t name = value;
+#define GPU_LAYOUT_DECLARE_STRUCT(Name) struct Name {
+#define GPU_LAYOUT_DECLARE_FIELD(Type, name, init) Type name = init;
+#define GPU_LAYOUT_DECLARE_END(Name) };
+
+    GPU_LAYOUT_CONSTANTS(GPU_LAYOUT_DECLARE_CONSTANT)
+    GPU_LAYOUT_STRUCTS(GPU_LAYOUT_DECLARE_STRUCT, GPU_LAYOUT_DECLARE_FIELD, GPU_LAYOUT_DECLARE_END)
+
+#undef GPU_LAYOUT_DECLARE_CONSTANT
+#undef GPU_LAYOUT_DECLARE_STRUCT
+#undef GPU_LAYOUT_DECLARE_FIELD
+#undef GPU_LAYOUT_DECLARE_END
+
+    struct FieldLayout
+    {
+        size_t offset;
+        size_t size;
+        size_t alignment;
+    };
+
+    // Walks the fields with the scalar block layout rules: true if the compiler put every field at the offset
+    // the shader reads it from, and if the struct size is the array stride the shader uses
+    template<size_t N>
+    constexpr bool MatchesScalarLayout(const FieldLayout (&fields)[N], size_t structSize)
+    {
+        size_t offset = 0;
+        size_t structAlignment = 1;
+        for (const FieldLayout& field : fields)
+        {
+            offset = (offset + field.alignment - 1) / field.alignment * field.alignment;
+            if (field.offset != offset)
+            {
+                return false;
+            }
+
+            offset += field.size;
+            structAlignment = field.alignment > structAlignment ? field.alignment : structAlignment;
+        }
+
+        return structSize == (offset + structAlignment - 1) / structAlignment * structAlignment;
+    }
+
+#define GPU_LAYOUT_CHECK_STRUCT(Name) namespace Name##LayoutCheck { using S = Name; constexpr FieldLayout fields[] = {
+#define GPU_LAYOUT_CHECK_FIELD(Type, name, init) { offsetof(S, name), sizeof(Type), TypeInfo<Type>::alignment },
+#define GPU_LAYOUT_CHECK_END(Name) }; \
+    static_assert(MatchesScalarLayout(fields, sizeof(S)), "Gpu::" #Name " doesn't match its scalar block layout"); }
+
+    GPU_LAYOUT_STRUCTS(GPU_LAYOUT_CHECK_STRUCT, GPU_LAYOUT_CHECK_FIELD, GPU_LAYOUT_CHECK_END)
+
+#undef GPU_LAYOUT_CHECK_STRUCT
+#undef GPU_LAYOUT_CHECK_FIELD
+#undef GPU_LAYOUT_CHECK_END
+}
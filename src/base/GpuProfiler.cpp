@@ -0,0 +1,115 @@
+#include "GpuProfiler.h"
+#include "VulkanUtils.h"
+
+void GpuProfiler::Init(VkDevice logicalDevice, const VkPhysicalDeviceProperties& deviceProperties,
+    uint32_t framesCount, uint32_t maxScopesPerFrame)
+{
+    if (!deviceProperties.limits.timestampComputeAndGraphics)
+    {
+        std::cerr << "Timestamp queries are not supported, GPU timings are disabled\n";
+        return;
+    }
+
+    m_timestampPeriod = deviceProperties.limits.timestampPeriod;
+    m_maxScopesPerFrame = maxScopesPerFrame;
+    m_frameScopes.resize(framesCount);
+
+    // Two timestamps (begin, end) per scope
+    VkQueryPoolCreateInfo queryPoolCreateInfo{};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = framesCount * maxScopesPerFrame * 2;
+
+    VK_CHECK_RESULT_MSG(vkCreateQueryPool(logicalDevice, &queryPoolCreateInfo, nullptr, &m_queryPool),
+        "Failed to create timestamp query pool!");
+}
+
+void GpuProfiler::Deinit(VkDevice logicalDevice)
+{
+    vkDestroyQueryPool(logicalDevice, m_queryPool, nullptr);
+    m_queryPool = VK_NULL_HANDLE;
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIdx)
+{
+    if (!IsSupported())
+    {
+        return;
+    }
+
+    m_recordingFrameIdx = frameIdx;
+    m_frameScopes[frameIdx].clear();
+
+    vkCmdResetQueryPool(commandBuffer, m_queryPool, frameIdx * m_maxScopesPerFrame * 2, m_maxScopesPerFrame * 2);
+}
+
+uint32_t GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const std::string& name)
+{
+    if (!IsSupported() || m_frameScopes[m_recordingFrameIdx].size() >= m_maxScopesPerFrame)
+    {
+        return UINT32_MAX;
+    }
+
+    std::vector<Scope>& scopes = m_frameScopes[m_recordingFrameIdx];
+
+    const uint32_t scopeIdx = static_cast<uint32_t>(scopes.size());
+    scopes.push_back({ name });
+
+    const uint32_t query = (m_recordingFrameIdx * m_maxScopesPerFrame + scopeIdx) * 2;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, query);
+
+    return scopeIdx;
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer commandBuffer, uint32_t scopeIdx)
+{
+    if (!IsSupported() || scopeIdx == UINT32_MAX)
+    {
+        return;
+    }
+
+    const uint32_t query = (m_recordingFrameIdx * m_maxScopesPerFrame + scopeIdx) * 2 + 1;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, query);
+}
+
+bool GpuProfiler::Resolve(VkDevice logicalDevice, uint32_t frameIdx)
+{
+    if (!IsSupported() || m_frameScopes[frameIdx].empty())
+    {
+        return false;
+    }
+
+    std::vector<Scope>& scopes = m_frameScopes[frameIdx];
+    std::vector<uint64_t> timestamps(scopes.size() * 2);
+
+    VkResult result = vkGetQueryPoolResults(logicalDevice, m_queryPool,
+        frameIdx * m_maxScopesPerFrame * 2, static_cast<uint32_t>(timestamps.size()),
+        timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < scopes.size(); ++i)
+    {
+        const uint64_t ticks = timestamps[i * 2 + 1] - timestamps[i * 2];
+        scopes[i].milliseconds = static_cast<float>(ticks * m_timestampPeriod / 1000000.0);
+    }
+
+    m_resolvedScopes = scopes;
+    return true;
+}
+
+float GpuProfiler::GetScopeMilliseconds(const std::string& name) const
+{
+    for (const Scope& scope : m_resolvedScopes)
+    {
+        if (scope.name == name)
+        {
+            return scope.milliseconds;
+        }
+    }
+
+    return -1.0f;
+}
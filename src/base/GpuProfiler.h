@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+// Measures GPU execution time of command buffer regions with timestamp queries.
+// Every frame in flight owns its own range of queries, so results are read back
+// once the frame fence has been waited on.
+class GpuProfiler
+{
+public:
+    void Init(VkDevice logicalDevice, const VkPhysicalDeviceProperties& deviceProperties,
+        uint32_t framesCount, uint32_t maxScopesPerFrame = 32);
+    void Deinit(VkDevice logicalDevice);
+
+    bool IsSupported() const { return m_queryPool != VK_NULL_HANDLE; }
+
+    // Resets the queries of the frame, must be recorded outside of a render pass
+    void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIdx);
+
+    uint32_t BeginScope(VkCommandBuffer commandBuffer, const std::string& name);
+    void EndScope(VkCommandBuffer commandBuffer, uint32_t scopeIdx);
+
+    // Fetches timings of a completed frame, returns false if they are not available
+    bool Resolve(VkDevice logicalDevice, uint32_t frameIdx);
+
+    // Duration of the scope in the last resolved frame, negative if it wasn't recorded
+    float GetScopeMilliseconds(const std::string& name) const;
+
+private:
+    struct Scope
+    {
+        std::string name;
+        float milliseconds = 0.0f;
+    };
+
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    float m_timestampPeriod = 1.0f;
+    uint32_t m_maxScopesPerFrame = 0;
+
+    uint32_t m_recordingFrameIdx = 0;
+    std::vector<std::vector<Scope>> m_frameScopes;
+    std::vector<Scope> m_resolvedScopes;
+};
@@ -0,0 +1,159 @@
+#include "GpuScene.h"
+
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <cstring>
+
+void GpuScene::Upload(DeviceMemoryAllocator& allocator, LinearArena& stagingArena, VkQueue queue, VkCommandPool commandPool,
+    const SceneEncoder::EncodedSceneView& scene, const EnvironmentMap::Encoded& environment)
+{
+    struct Source
+    {
+        const void* data;
+        VkDeviceSize size;
+    };
+
+    // A binary tree over n spheres has n - 1 internal nodes
+    const bool lbvh = scene.acceleration == SceneAcceleration::Lbvh;
+    const VkDeviceSize bvhNodesCount = lbvh ? std::max(scene.spheresCount, 1u) - 1 : 0;
+    const VkDeviceSize bvhLeavesCount = lbvh ? scene.spheresCount : 0;
+    const bool motion = !scene.sphereMotion.empty();
+    const VkDeviceSize bvhMotionBoundsCount = motion ? bvhNodesCount : 0;
+
+    // Spheres overlapping more than gridMaxCellsPerSphere cells are only referenced by the large spheres list
+    const bool grid = scene.acceleration == SceneAcceleration::Grid;
+    const VkDeviceSize gridCellsCount = grid ? GetGridCellsCapacity(scene.spheresCount) : 0;
+    const VkDeviceSize gridReferencesCount = grid ? VkDeviceSize(scene.spheresCount) * Gpu::gridMaxCellsPerSphere : 0;
+    const VkDeviceSize gridLargeSpheresCount = grid ? scene.spheresCount : 0;
+
+    const std::array<Source, ArraysCount> sources =
+    {{
+        { scene.sphereGeometry.data(), scene.sphereGeometry.size() },
+        { scene.sphereMaterials.data(), scene.sphereMaterials.size() * sizeof(uint16_t) },
+        { scene.sphereChunks.data(), scene.sphereChunks.size() * sizeof(Gpu::SphereChunk) },
+        { scene.materials.data(), scene.materials.size() * sizeof(Gpu::Material) },
+        { scene.sphereMotion.data(), scene.sphereMotion.size() * sizeof(glm::vec3) },
+        { nullptr, bvhNodesCount * sizeof(Gpu::BvhNode) },
+        { nullptr, bvhLeavesCount * sizeof(uint32_t) },
+        { nullptr, bvhMotionBoundsCount * sizeof(Gpu::MotionBounds) },
+        { nullptr, grid ? sizeof(Gpu::GridInfo) : 0 },
+        { nullptr, gridCellsCount * sizeof(uint32_t) },
+        { nullptr, gridReferencesCount * sizeof(uint32_t) },
+        { nullptr, gridLargeSpheresCount * sizeof(uint32_t) },
+        { scene.wideBvhNodes.data(), scene.wideBvhNodes.size() * sizeof(Gpu::WideBvhNode) },
+        { scene.planes.data(), scene.planes.size() * sizeof(Gpu::Plane) },
+        { scene.quads.data(), scene.quads.size() * sizeof(Gpu::Quad) },
+        { scene.boxes.data(), scene.boxes.size() * sizeof(Gpu::Box) },
+        { scene.sphereFields.data(), scene.sphereFields.size() * sizeof(Gpu::SphereField) },
+        { scene.lightBvhNodes.data(), scene.lightBvhNodes.size() * sizeof(Gpu::LightBvhNode) },
+        { scene.lights.data(), scene.lights.size() * sizeof(Gpu::Light) },
+        { environment.pixels.data(), environment.pixels.size() * sizeof(glm::uvec2) },
+        { environment.aliasTable.data(), environment.aliasTable.size() * sizeof(Gpu::EnvironmentAliasEntry) }
+    }};
+
+    const VkDeviceSize stagingAlignment = 16;
+    VkDeviceSize stagingSize = sizeof(Gpu::SceneInfo);
+    for (const Source& source : sources)
+    {
+        stagingSize += (source.size + stagingAlignment - 1) & ~(stagingAlignment - 1);
+    }
+
+    stagingArena.Reserve(allocator, stagingSize);
+
+    for (uint32_t i = 0; i < ArraysCount; ++i)
+    {
+        m_arrays[i].Reserve(allocator, sources[i].size);
+    }
+
+    m_header.Reserve(allocator, sizeof(Gpu::SceneInfo));
+
+    m_headerData.sphereGeometry = m_arrays[SphereGeometry].GetAddress();
+    m_headerData.sphereMaterials = m_arrays[SphereMaterials].GetAddress();
+    m_headerData.sphereChunks = m_arrays[SphereChunks].GetAddress();
+    m_headerData.materials = m_arrays[Materials].GetAddress();
+    m_headerData.sphereMotion = m_arrays[SphereMotion].GetAddress();
+    m_headerData.bvhNodes = m_arrays[BvhNodes].GetAddress();
+    m_headerData.bvhLeaves = m_arrays[BvhLeaves].GetAddress();
+    m_headerData.bvhMotionBounds = m_arrays[BvhMotionBounds].GetAddress();
+    m_headerData.gridInfo = m_arrays[GridHeader].GetAddress();
+    m_headerData.gridCells = m_arrays[GridCells].GetAddress();
+    m_headerData.gridReferences = m_arrays[GridReferences].GetAddress();
+    m_headerData.gridLargeSpheres = m_arrays[GridLargeSpheres].GetAddress();
+    m_headerData.wideBvhNodes = m_arrays[WideBvhNodes].GetAddress();
+    m_headerData.planes = m_arrays[Planes].GetAddress();
+    m_headerData.quads = m_arrays[Quads].GetAddress();
+    m_headerData.boxes = m_arrays[Boxes].GetAddress();
+    m_headerData.sphereFields = m_arrays[SphereFields].GetAddress();
+    m_headerData.lightBvhNodes = m_arrays[LightBvhNodes].GetAddress();
+    m_headerData.lights = m_arrays[Lights].GetAddress();
+    m_headerData.environmentPixels = m_arrays[EnvironmentPixels].GetAddress();
+    m_headerData.environmentAliasTable = m_arrays[EnvironmentAliasTable].GetAddress();
+    m_headerData.spheresCount = scene.spheresCount;
+    m_headerData.encoding = static_cast<uint32_t>(scene.encoding);
+    m_headerData.acceleration = static_cast<uint32_t>(scene.acceleration);
+    m_headerData.planesCount = static_cast<uint32_t>(scene.planes.size());
+    m_headerData.quadsCount = static_cast<uint32_t>(scene.quads.size());
+    m_headerData.boxesCount = static_cast<uint32_t>(scene.boxes.size());
+    m_headerData.sphereFieldsCount = static_cast<uint32_t>(scene.sphereFields.size());
+    m_headerData.hasSphereMotion = motion ? 1 : 0;
+    m_headerData.environmentWidth = environment.width;
+    m_headerData.environmentHeight = environment.height;
+    m_headerData.lightsCount = static_cast<uint32_t>(scene.lights.size());
+
+    VkDevice device = allocator.GetDevice();
+    VkCommandBuffer commandBuffer = VulkanUtils::CreateCommandeBuffer(device, commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+    auto stageAndCopy = [&](const void* data, VkDeviceSize size, VkBuffer dstBuffer)
+    {
+        if (data == nullptr || size == 0)
+        {
+            return;
+        }
+
+        LinearArena::Allocation staging = stagingArena.Allocate(size, stagingAlignment);
+        memcpy(staging.mapped, data, size);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = staging.offset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, staging.buffer, dstBuffer, 1, &copyRegion);
+    };
+
+    for (uint32_t i = 0; i < ArraysCount; ++i)
+    {
+        stageAndCopy(sources[i].data, sources[i].size, m_arrays[i].GetBuffer());
+    }
+
+    stageAndCopy(&m_headerData, sizeof(Gpu::SceneInfo), m_header.GetBuffer());
+
+    VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+    VK_CHECK_RESULT(vkQueueWaitIdle(queue));
+
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+
+    // The queue is idle, the staging memory can be reused right away
+    stagingArena.Reset();
+}
+
+void GpuScene::Deinit(DeviceMemoryAllocator& allocator)
+{
+    for (DeviceArray& array : m_arrays)
+    {
+        array.Release(allocator);
+    }
+
+    m_header.Release(allocator);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "DeviceMemoryAllocator.h"
+#include "EnvironmentMap.h"
+#include "SceneEncoding.h"
+
+#include <algorithm>
+#include <array>
+
+// Device copy of the World. Every scene array lives in its own buffer, the compute shader reaches them
+// through the device addresses stored in a header buffer (Gpu::SceneInfo) whose own address is passed as a push constant.
+// Arrays can grow or be moved to a new buffer without rewriting any descriptor set.
+class GpuScene
+{
+public:
+    // Copies the encoded scene and its environment map to the device, reallocating the arrays that outgrew their buffer.
+    // Waits for the queue, the GPU must not be using the scene when it's called.
+    void Upload(DeviceMemoryAllocator& allocator, LinearArena& stagingArena, VkQueue queue, VkCommandPool commandPool,
+        const SceneEncoder::EncodedSceneView& scene, const EnvironmentMap::Encoded& environment);
+    void Deinit(DeviceMemoryAllocator& allocator);
+
+    VkDeviceAddress GetHeaderAddress() const { return m_header.GetAddress(); }
+    const Gpu::SceneInfo& GetHeader() const { return m_headerData; }
+
+    SceneAcceleration GetAcceleration() const { return static_cast<SceneAcceleration>(m_headerData.acceleration); }
+
+    // Cleared by the grid build before the cells are counted
+    VkBuffer GetGridCellsBuffer() const { return m_arrays[GridCells].GetBuffer(); }
+
+    // Size of the grid cells array, the grid build picks a resolution with at most as many cells
+    static uint32_t GetGridCellsCapacity(uint32_t spheresCount) { return std::max(spheresCount, 1u); }
+
+private:
+    enum ArrayIdx : uint32_t
+    {
+        SphereGeometry,
+        SphereMaterials,
+        SphereChunks,
+        Materials,
+        SphereMotion,
+        // Written on the device by LbvhBuilder
+        BvhNodes,
+        BvhLeaves,
+        BvhMotionBounds,
+        // Written on the device by GridBuilder
+        GridHeader,
+        GridCells,
+        GridReferences,
+        GridLargeSpheres,
+        // Built on the host
+        WideBvhNodes,
+        Planes,
+        Quads,
+        Boxes,
+        SphereFields,
+        LightBvhNodes,
+        Lights,
+        // Loaded separately from the scene, not part of the scene cache
+        EnvironmentPixels,
+        EnvironmentAliasTable,
+        ArraysCount
+    };
+
+    std::array<DeviceArray, ArraysCount> m_arrays;
+    DeviceArray m_header;
+    Gpu::SceneInfo m_headerData;
+};
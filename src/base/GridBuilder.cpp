@@ -0,0 +1,148 @@
+#include "GridBuilder.h"
+
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <string>
+
+static constexpr std::array<const char*, 7> passShaders =
+{
+    "grid_bounds.comp.spv",
+    "grid_setup.comp.spv",
+    "grid_count.comp.spv",
+    "grid_scan_blocks.comp.spv",
+    "grid_scan_block_sums.comp.spv",
+    "grid_scan_add.comp.spv",
+    "grid_fill.comp.spv"
+};
+
+static uint32_t DivideRoundUp(uint32_t count, uint32_t groupSize)
+{
+    return (count + groupSize - 1) / groupSize;
+}
+
+// Makes the writes of the previous commands visible to the next compute dispatch
+static void ComputeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = srcAccessMask;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStageMask, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GridBuilder::Init(VkDevice logicalDevice)
+{
+    static_assert(passShaders.size() == PassesCount);
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.size = sizeof(Gpu::GridPushConstants);
+
+    // Everything is reached through the addresses in the push constants, no descriptor sets
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));
+
+    for (uint32_t i = 0; i < PassesCount; ++i)
+    {
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.layout = m_pipelineLayout;
+        computePipelineCreateInfo.stage =
+            VulkanUtils::CreateShaderStage(logicalDevice, VulkanUtils::GetShadersPath() + passShaders[i], VK_SHADER_STAGE_COMPUTE_BIT);
+
+        VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &m_pipelines[i]));
+
+        VulkanUtils::DestroyShaderStage(logicalDevice, computePipelineCreateInfo.stage);
+    }
+}
+
+void GridBuilder::Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice)
+{
+    for (VkPipeline& pipeline : m_pipelines)
+    {
+        vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    vkDestroyPipelineLayout(logicalDevice, m_pipelineLayout, nullptr);
+    m_pipelineLayout = VK_NULL_HANDLE;
+
+    for (DeviceArray& array : m_scratch)
+    {
+        array.Release(allocator);
+    }
+}
+
+void GridBuilder::Reserve(DeviceMemoryAllocator& allocator, uint32_t spheresCount)
+{
+    const uint32_t cellsCapacity = GpuScene::GetGridCellsCapacity(spheresCount);
+
+    // Min and max of the sphere bounds
+    m_scratch[Bounds].Reserve(allocator, 6 * sizeof(uint32_t));
+    m_scratch[BlockSums].Reserve(allocator, DivideRoundUp(cellsCapacity, Gpu::gridScanBlockSize) * sizeof(uint32_t));
+}
+
+void GridBuilder::Dispatch(VkCommandBuffer commandBuffer, PassIdx pass, const Gpu::GridPushConstants& pushConstants,
+    uint32_t groupCount) const
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[pass]);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+        0, sizeof(Gpu::GridPushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+}
+
+void GridBuilder::Record(VkCommandBuffer commandBuffer, const GpuScene& scene) const
+{
+    const Gpu::SceneInfo& sceneInfo = scene.GetHeader();
+    const uint32_t count = sceneInfo.spheresCount;
+
+    if (scene.GetAcceleration() != SceneAcceleration::Grid || count == 0)
+    {
+        return;
+    }
+
+    const uint32_t cellsCapacity = GpuScene::GetGridCellsCapacity(count);
+    const uint32_t spheresGroupCount = DivideRoundUp(count, Gpu::gridWorkgroupSize);
+    const uint32_t scanGroupCount = DivideRoundUp(cellsCapacity, Gpu::gridScanBlockSize);
+
+    // Previous compute work may still trace the old grid or be writing the spheres
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    // Empty bounds (max ordered uint min, 0 max) and empty cells
+    vkCmdFillBuffer(commandBuffer, m_scratch[Bounds].GetBuffer(), 0, 3 * sizeof(uint32_t), UINT32_MAX);
+    vkCmdFillBuffer(commandBuffer, m_scratch[Bounds].GetBuffer(), 3 * sizeof(uint32_t), 3 * sizeof(uint32_t), 0);
+    vkCmdFillBuffer(commandBuffer, scene.GetGridCellsBuffer(), 0, cellsCapacity * sizeof(uint32_t), 0);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    Gpu::GridPushConstants pushConstants;
+    pushConstants.scene = scene.GetHeaderAddress();
+    pushConstants.bounds = m_scratch[Bounds].GetAddress();
+    pushConstants.blockSums = m_scratch[BlockSums].GetAddress();
+    pushConstants.count = count;
+    pushConstants.cellsCapacity = cellsCapacity;
+
+    Dispatch(commandBuffer, BoundsPass, pushConstants, spheresGroupCount);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    Dispatch(commandBuffer, SetupPass, pushConstants, 1);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    Dispatch(commandBuffer, CountPass, pushConstants, spheresGroupCount);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    Dispatch(commandBuffer, ScanBlocksPass, pushConstants, scanGroupCount);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    Dispatch(commandBuffer, ScanBlockSumsPass, pushConstants, 1);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    Dispatch(commandBuffer, ScanAddPass, pushConstants, scanGroupCount);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    Dispatch(commandBuffer, FillPass, pushConstants, spheresGroupCount);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "DeviceMemoryAllocator.h"
+#include "GpuScene.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+
+// Builds the uniform grid of a GpuScene on the GPU from the device sphere array: bounds of the spheres,
+// grid resolution, then a counting sort of the sphere references into the cells (count per cell, prefix sum,
+// fill). Like LbvhBuilder it never reads the scene back, so it can be recorded every frame.
+class GridBuilder
+{
+public:
+    void Init(VkDevice logicalDevice);
+    void Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice);
+
+    // Grows the scratch arrays to build scenes of up to spheresCount spheres, they must not be in use
+    void Reserve(DeviceMemoryAllocator& allocator, uint32_t spheresCount);
+
+    // Records the build of the scene grid, followed by a barrier making it visible to compute shaders.
+    // Waits for the compute work recorded or submitted before it, the sphere geometry can be written by it.
+    void Record(VkCommandBuffer commandBuffer, const GpuScene& scene) const;
+
+private:
+    enum PassIdx : uint32_t
+    {
+        BoundsPass,
+        SetupPass,
+        CountPass,
+        ScanBlocksPass,
+        ScanBlockSumsPass,
+        ScanAddPass,
+        FillPass,
+        PassesCount
+    };
+
+    enum ScratchIdx : uint32_t
+    {
+        Bounds,
+        BlockSums,
+        ScratchCount
+    };
+
+    void Dispatch(VkCommandBuffer commandBuffer, PassIdx pass, const Gpu::GridPushConstants& pushConstants,
+        uint32_t groupCount) const;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    std::array<VkPipeline, PassesCount> m_pipelines{};
+
+    std::array<DeviceArray, ScratchCount> m_scratch;
+};
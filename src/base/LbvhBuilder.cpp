@@ -0,0 +1,181 @@
+#include "LbvhBuilder.h"
+
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <string>
+
+// 30 bit Morton codes, an even number of passes leaves the sorted arrays where the first one started
+static constexpr uint32_t sortPassesCount = (30 + Gpu::lbvhRadixBits - 1) / Gpu::lbvhRadixBits;
+static_assert(sortPassesCount % 2 == 0, "The sorted sphere indices must end up in the scene leaves array");
+
+// 62 levels of internal nodes at most, see Gpu::bvhStackSize
+static_assert(Gpu::bvhStackSize >= 63, "The trace must be able to traverse the deepest hierarchy");
+
+static constexpr std::array<const char*, 7> passShaders =
+{
+    "lbvh_bounds.comp.spv",
+    "lbvh_morton.comp.spv",
+    "lbvh_sort_histogram.comp.spv",
+    "lbvh_sort_scan.comp.spv",
+    "lbvh_sort_scatter.comp.spv",
+    "lbvh_hierarchy.comp.spv",
+    "lbvh_refit.comp.spv"
+};
+
+static uint32_t GetBlocksCount(uint32_t count)
+{
+    return (count + Gpu::lbvhBlockSize - 1) / Gpu::lbvhBlockSize;
+}
+
+// Makes the writes of the previous commands visible to the next compute dispatch
+static void ComputeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = srcAccessMask;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStageMask, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void LbvhBuilder::Init(VkDevice logicalDevice)
+{
+    static_assert(passShaders.size() == PassesCount);
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.size = sizeof(Gpu::LbvhPushConstants);
+
+    // Everything is reached through the addresses in the push constants, no descriptor sets
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));
+
+    for (uint32_t i = 0; i < PassesCount; ++i)
+    {
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.layout = m_pipelineLayout;
+        computePipelineCreateInfo.stage =
+            VulkanUtils::CreateShaderStage(logicalDevice, VulkanUtils::GetShadersPath() + passShaders[i], VK_SHADER_STAGE_COMPUTE_BIT);
+
+        VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &m_pipelines[i]));
+
+        VulkanUtils::DestroyShaderStage(logicalDevice, computePipelineCreateInfo.stage);
+    }
+}
+
+void LbvhBuilder::Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice)
+{
+    for (VkPipeline& pipeline : m_pipelines)
+    {
+        vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    vkDestroyPipelineLayout(logicalDevice, m_pipelineLayout, nullptr);
+    m_pipelineLayout = VK_NULL_HANDLE;
+
+    for (DeviceArray& array : m_scratch)
+    {
+        array.Release(allocator);
+    }
+}
+
+void LbvhBuilder::Reserve(DeviceMemoryAllocator& allocator, uint32_t spheresCount)
+{
+    const VkDeviceSize count = std::max(spheresCount, 1u);
+    const VkDeviceSize digitsCount = VkDeviceSize(1) << Gpu::lbvhRadixBits;
+
+    // Min and max of the centers
+    m_scratch[Bounds].Reserve(allocator, 6 * sizeof(uint32_t));
+    m_scratch[SortKeys].Reserve(allocator, count * sizeof(uint32_t));
+    m_scratch[SortKeysAlt].Reserve(allocator, count * sizeof(uint32_t));
+    m_scratch[SortValuesAlt].Reserve(allocator, count * sizeof(uint32_t));
+    m_scratch[Histogram].Reserve(allocator, digitsCount * GetBlocksCount(spheresCount) * sizeof(uint32_t));
+    // Internal nodes and leaves
+    m_scratch[Parents].Reserve(allocator, (2 * count - 1) * sizeof(uint32_t));
+    m_scratch[Visits].Reserve(allocator, count * sizeof(uint32_t));
+}
+
+void LbvhBuilder::Dispatch(VkCommandBuffer commandBuffer, PassIdx pass, const Gpu::LbvhPushConstants& pushConstants,
+    uint32_t groupCount) const
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[pass]);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+        0, sizeof(Gpu::LbvhPushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+}
+
+void LbvhBuilder::Record(VkCommandBuffer commandBuffer, const GpuScene& scene) const
+{
+    const Gpu::SceneInfo& sceneInfo = scene.GetHeader();
+    const uint32_t count = sceneInfo.spheresCount;
+
+    // The trace tests a single sphere directly
+    if (scene.GetAcceleration() != SceneAcceleration::Lbvh || count < 2)
+    {
+        return;
+    }
+
+    const uint32_t blocksCount = GetBlocksCount(count);
+
+    // Previous compute work may still trace the old BVH or be writing the spheres
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    // Empty bounds (max ordered uint min, 0 max) and no child visited yet
+    vkCmdFillBuffer(commandBuffer, m_scratch[Bounds].GetBuffer(), 0, 3 * sizeof(uint32_t), UINT32_MAX);
+    vkCmdFillBuffer(commandBuffer, m_scratch[Bounds].GetBuffer(), 3 * sizeof(uint32_t), 3 * sizeof(uint32_t), 0);
+    vkCmdFillBuffer(commandBuffer, m_scratch[Visits].GetBuffer(), 0, (count - 1) * sizeof(uint32_t), 0);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    Gpu::LbvhPushConstants pushConstants;
+    pushConstants.scene = scene.GetHeaderAddress();
+    pushConstants.bounds = m_scratch[Bounds].GetAddress();
+    pushConstants.histogram = m_scratch[Histogram].GetAddress();
+    pushConstants.parents = m_scratch[Parents].GetAddress();
+    pushConstants.visits = m_scratch[Visits].GetAddress();
+    pushConstants.count = count;
+
+    Dispatch(commandBuffer, BoundsPass, pushConstants, blocksCount);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+    const std::array<VkDeviceAddress, 2> keys = { m_scratch[SortKeys].GetAddress(), m_scratch[SortKeysAlt].GetAddress() };
+    const std::array<VkDeviceAddress, 2> values = { sceneInfo.bvhLeaves, m_scratch[SortValuesAlt].GetAddress() };
+
+    pushConstants.keysOut = keys[0];
+    pushConstants.valuesOut = values[0];
+    Dispatch(commandBuffer, MortonPass, pushConstants, blocksCount);
+
+    // Least significant digit first, every pass is a stable counting sort of one digit
+    for (uint32_t pass = 0; pass < sortPassesCount; ++pass)
+    {
+        pushConstants.keysIn = keys[pass % 2];
+        pushConstants.valuesIn = values[pass % 2];
+        pushConstants.keysOut = keys[(pass + 1) % 2];
+        pushConstants.valuesOut = values[(pass + 1) % 2];
+        pushConstants.shift = pass * Gpu::lbvhRadixBits;
+
+        ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        Dispatch(commandBuffer, SortHistogramPass, pushConstants, blocksCount);
+        ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        Dispatch(commandBuffer, SortScanPass, pushConstants, 1);
+        ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        Dispatch(commandBuffer, SortScatterPass, pushConstants, blocksCount);
+    }
+
+    pushConstants.keysIn = keys[0];
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    Dispatch(commandBuffer, HierarchyPass, pushConstants, GetBlocksCount(count - 1));
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    Dispatch(commandBuffer, RefitPass, pushConstants, blocksCount);
+    ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "DeviceMemoryAllocator.h"
+#include "GpuScene.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+
+// Builds the LBVH of a GpuScene on the GPU from the device sphere array: bounds of the sphere centers,
+// Morton codes, radix sort of the codes, hierarchy emission from the sorted codes and bounds propagated
+// from the leaves to the root (Karras 2012). The build only reads the scene on the device, so it can be
+// recorded every frame after the spheres moved without any host round trip.
+class LbvhBuilder
+{
+public:
+    void Init(VkDevice logicalDevice);
+    void Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice);
+
+    // Grows the scratch arrays to build scenes of up to spheresCount spheres, they must not be in use
+    void Reserve(DeviceMemoryAllocator& allocator, uint32_t spheresCount);
+
+    // Records the build of the scene BVH, followed by a barrier making it visible to compute shaders.
+    // Waits for the compute work recorded or submitted before it, the sphere geometry can be written by it.
+    void Record(VkCommandBuffer commandBuffer, const GpuScene& scene) const;
+
+private:
+    enum PassIdx : uint32_t
+    {
+        BoundsPass,
+        MortonPass,
+        SortHistogramPass,
+        SortScanPass,
+        SortScatterPass,
+        HierarchyPass,
+        RefitPass,
+        PassesCount
+    };
+
+    enum ScratchIdx : uint32_t
+    {
+        Bounds,
+        // Morton codes, ping-pong of the sort. The sphere indices are sorted along with the codes
+        // from the scene leaves array to SortValuesAlt and back.
+        SortKeys,
+        SortKeysAlt,
+        SortValuesAlt,
+        Histogram,
+        Parents,
+        Visits,
+        ScratchCount
+    };
+
+    void Dispatch(VkCommandBuffer commandBuffer, PassIdx pass, const Gpu::LbvhPushConstants& pushConstants,
+        uint32_t groupCount) const;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    std::array<VkPipeline, PassesCount> m_pipelines{};
+
+    std::array<DeviceArray, ScratchCount> m_scratch;
+};
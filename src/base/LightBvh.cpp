@@ -0,0 +1,412 @@
+#include "LightBvh.h"
+
+#include "World.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <numbers>
+
+namespace LightBvh
+{
+
+static constexpr float pi = std::numbers::pi_v<float>;
+
+// Positions, power and emission directions of a set of lights. The directions are the normals within thetaO of
+// axis, each one emitting up to thetaE away from itself.
+struct LightBounds
+{
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+    float power = 0.0f;
+    glm::vec3 axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float cosThetaO = 1.0f;
+    float cosThetaE = 1.0f;
+
+    bool IsEmpty() const { return min.x > max.x; }
+
+    // Half the surface area, the cost only compares ratios
+    float HalfArea() const
+    {
+        if (IsEmpty())
+        {
+            return 0.0f;
+        }
+
+        const glm::vec3 extent = max - min;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    glm::vec3 Center() const { return 0.5f * (min + max); }
+};
+
+// Smallest cone holding the cones around axisA and axisB
+static void UnionCones(glm::vec3 axisA, float cosA, glm::vec3 axisB, float cosB, glm::vec3& axis, float& cosTheta)
+{
+    if (cosB < cosA)
+    {
+        std::swap(axisA, axisB);
+        std::swap(cosA, cosB);
+    }
+
+    // A is the wider cone from here
+    const float thetaA = std::acos(std::clamp(cosA, -1.0f, 1.0f));
+    const float thetaB = std::acos(std::clamp(cosB, -1.0f, 1.0f));
+    const float thetaD = std::acos(std::clamp(glm::dot(axisA, axisB), -1.0f, 1.0f));
+    if (std::min(thetaD + thetaB, pi) <= thetaA)
+    {
+        axis = axisA;
+        cosTheta = cosA;
+        return;
+    }
+
+    const float thetaO = 0.5f * (thetaA + thetaD + thetaB);
+    const glm::vec3 rotationAxis = glm::cross(axisA, axisB);
+    if (thetaO >= pi || glm::dot(rotationAxis, rotationAxis) < 1e-12f)
+    {
+        axis = axisA;
+        cosTheta = -1.0f;
+        return;
+    }
+
+    // A's axis turned towards B's until the cone reaches the far side of B
+    const float thetaR = thetaO - thetaA;
+    axis = glm::normalize(axisA * std::cos(thetaR) + glm::cross(glm::normalize(rotationAxis), axisA) * std::sin(thetaR));
+    cosTheta = std::cos(thetaO);
+}
+
+static LightBounds Union(const LightBounds& a, const LightBounds& b)
+{
+    if (a.IsEmpty())
+    {
+        return b;
+    }
+
+    if (b.IsEmpty())
+    {
+        return a;
+    }
+
+    LightBounds bounds;
+    bounds.min = glm::min(a.min, b.min);
+    bounds.max = glm::max(a.max, b.max);
+    bounds.power = a.power + b.power;
+    bounds.cosThetaE = std::min(a.cosThetaE, b.cosThetaE);
+    UnionCones(a.axis, a.cosThetaO, b.axis, b.cosThetaO, bounds.axis, bounds.cosThetaO);
+    return bounds;
+}
+
+// Solid angle measure of the directions the lights emit in, the orientation part of the split cost
+static float OrientationCost(const LightBounds& bounds)
+{
+    const float thetaO = std::acos(std::clamp(bounds.cosThetaO, -1.0f, 1.0f));
+    const float thetaE = std::acos(std::clamp(bounds.cosThetaE, -1.0f, 1.0f));
+    const float thetaW = std::min(thetaO + thetaE, pi);
+    const float sinThetaO = std::sin(thetaO);
+    return 2.0f * pi * (1.0f - bounds.cosThetaO) +
+        0.5f * pi * (2.0f * thetaW * sinThetaO - std::cos(thetaO - 2.0f * thetaW) - 2.0f * thetaO * sinThetaO + bounds.cosThetaO);
+}
+
+static float Cost(const LightBounds& bounds)
+{
+    return bounds.power * OrientationCost(bounds) * bounds.HalfArea();
+}
+
+static Gpu::LightBvhNode EncodeNode(const LightBounds& bounds)
+{
+    Gpu::LightBvhNode node;
+    node.boundsMin = bounds.min;
+    node.power = bounds.power;
+    node.boundsMax = bounds.max;
+    node.cosThetaO = bounds.cosThetaO;
+    node.axis = bounds.axis;
+    node.cosThetaE = bounds.cosThetaE;
+    return node;
+}
+
+// Light being sorted into the hierarchy, the references are partitioned in place like the spheres of WideBvh
+struct LightReference
+{
+    LightBounds bounds;
+    glm::vec3 center;
+    uint32_t light;
+};
+
+static constexpr uint32_t binsCount = 12;
+// Bit trails are 64 bits, deeper subtrees are split in halves so 32 more levels hold any number of lights
+static constexpr uint32_t maxCostSplitDepth = 32;
+
+static uint32_t GetBin(float center, float boundsMin, float binScale)
+{
+    return std::min(static_cast<uint32_t>((center - boundsMin) * binScale), binsCount - 1);
+}
+
+// Depth first layout: the first child of an internal node is the next node. Returns the index of the node.
+static uint32_t BuildNode(std::vector<LightReference>& references, uint32_t begin, uint32_t end, uint64_t bitTrail, uint32_t depth,
+    Hierarchy& lightBvh)
+{
+    const uint32_t nodeIdx = static_cast<uint32_t>(lightBvh.nodes.size());
+    lightBvh.nodes.emplace_back();
+
+    if (end - begin == 1)
+    {
+        const LightReference& reference = references[begin];
+        lightBvh.nodes[nodeIdx] = EncodeNode(reference.bounds);
+        lightBvh.nodes[nodeIdx].child = Gpu::lightBvhLeafFlag | reference.light;
+        lightBvh.lights[reference.light].bitTrail = glm::uvec2(static_cast<uint32_t>(bitTrail), static_cast<uint32_t>(bitTrail >> 32));
+        return nodeIdx;
+    }
+
+    LightBounds bounds;
+    LightBounds centerBounds;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        bounds = Union(bounds, references[i].bounds);
+        centerBounds.min = glm::min(centerBounds.min, references[i].center);
+        centerBounds.max = glm::max(centerBounds.max, references[i].center);
+    }
+
+    // Power, emission directions and area of the children, stretched along the axes shorter than the longest one of
+    // the node so thin slices across it don't look cheap
+    float bestCost = std::numeric_limits<float>::max();
+    uint32_t bestAxis = 0;
+    uint32_t bestBin = 0;
+
+    const glm::vec3 extent = bounds.max - bounds.min;
+    const float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+    for (uint32_t axis = 0; axis < 3 && depth < maxCostSplitDepth; ++axis)
+    {
+        const float centerExtent = centerBounds.max[axis] - centerBounds.min[axis];
+        if (centerExtent <= 0.0f)
+        {
+            continue;
+        }
+
+        const float binScale = binsCount / centerExtent;
+        std::array<LightBounds, binsCount> bins;
+        std::array<uint32_t, binsCount> binCounts{};
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const uint32_t bin = GetBin(references[i].center[axis], centerBounds.min[axis], binScale);
+            bins[bin] = Union(bins[bin], references[i].bounds);
+            ++binCounts[bin];
+        }
+
+        std::array<float, binsCount> rightCosts{};
+        LightBounds right;
+        for (uint32_t bin = binsCount - 1; bin > 0; --bin)
+        {
+            right = Union(right, bins[bin]);
+            rightCosts[bin] = Cost(right);
+        }
+
+        const float stretch = maxExtent / std::max(extent[axis], std::numeric_limits<float>::min());
+        LightBounds left;
+        uint32_t leftCount = 0;
+        for (uint32_t bin = 1; bin < binsCount; ++bin)
+        {
+            left = Union(left, bins[bin - 1]);
+            leftCount += binCounts[bin - 1];
+            const float cost = stretch * (Cost(left) + rightCosts[bin]);
+            if (leftCount > 0 && leftCount < end - begin && cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+            }
+        }
+    }
+
+    uint32_t middle = begin + (end - begin) / 2;
+    if (bestCost != std::numeric_limits<float>::max())
+    {
+        const float binScale = binsCount / (centerBounds.max[bestAxis] - centerBounds.min[bestAxis]);
+        const auto secondHalf = std::partition(references.begin() + begin, references.begin() + end, [&](const LightReference& reference)
+        {
+            return GetBin(reference.center[bestAxis], centerBounds.min[bestAxis], binScale) < bestBin;
+        });
+        middle = static_cast<uint32_t>(secondHalf - references.begin());
+    }
+
+    // Lights at the same place or too deep: halves along the longest axis
+    if (middle == begin || middle == end)
+    {
+        const glm::vec3 centerExtent = centerBounds.max - centerBounds.min;
+        const uint32_t axis = centerExtent.x > centerExtent.y ? (centerExtent.x > centerExtent.z ? 0 : 2) : (centerExtent.y > centerExtent.z ? 1 : 2);
+        middle = begin + (end - begin) / 2;
+        std::nth_element(references.begin() + begin, references.begin() + middle, references.begin() + end,
+            [axis](const LightReference& a, const LightReference& b) { return a.center[axis] < b.center[axis]; });
+    }
+
+    BuildNode(references, begin, middle, bitTrail, depth + 1, lightBvh);
+    const uint32_t secondChild = BuildNode(references, middle, end, bitTrail | (uint64_t(1) << depth), depth + 1, lightBvh);
+
+    lightBvh.nodes[nodeIdx] = EncodeNode(bounds);
+    lightBvh.nodes[nodeIdx].child = secondChild;
+    return nodeIdx;
+}
+
+Hierarchy Build(const World& world, const std::vector<uint32_t>& sphereOrder, bool orbitingSpheres)
+{
+    Hierarchy lightBvh;
+    std::vector<LightReference> references;
+
+    for (uint32_t position = 0; position < sphereOrder.size(); ++position)
+    {
+        const Sphere& sphere = world.spheres[sphereOrder[position]];
+        const Material& material = world.materialManager.GetMaterial(sphere.material);
+        const SpherePrimitive& shape = sphere.shape;
+
+        // Radiance times pi is the emitted power per unit area
+        const float luminance = glm::dot(material.albedo, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+        const float power = luminance * pi * 4.0f * pi * shape.radius * shape.radius;
+        if (material.type != MaterialType::Emissive || !(power > 0.0f))
+        {
+            continue;
+        }
+
+        LightReference reference;
+        reference.light = static_cast<uint32_t>(lightBvh.lights.size());
+        reference.bounds.min = glm::min(shape.center, shape.centerEnd) - shape.radius;
+        reference.bounds.max = glm::max(shape.center, shape.centerEnd) + shape.radius;
+        if (orbitingSpheres)
+        {
+            const float orbitRadius = std::max(glm::length(glm::vec2(shape.center.x, shape.center.z)),
+                glm::length(glm::vec2(shape.centerEnd.x, shape.centerEnd.z))) + shape.radius;
+            reference.bounds.min.x = reference.bounds.min.z = -orbitRadius;
+            reference.bounds.max.x = reference.bounds.max.z = orbitRadius;
+        }
+
+        // The sphere has normals in every direction, each one emitting over its hemisphere
+        reference.bounds.power = power;
+        reference.bounds.cosThetaO = -1.0f;
+        reference.bounds.cosThetaE = 0.0f;
+        reference.center = reference.bounds.Center();
+        references.push_back(reference);
+
+        Gpu::Light light;
+        light.sphere = position;
+        lightBvh.lights.push_back(light);
+    }
+
+    if (!references.empty())
+    {
+        lightBvh.nodes.reserve(2 * references.size() - 1);
+        BuildNode(references, 0, static_cast<uint32_t>(references.size()), 0, 0, lightBvh);
+    }
+
+    return lightBvh;
+}
+
+// cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of the angles
+static float CosSubClamped(float sinA, float cosA, float sinB, float cosB)
+{
+    return cosA > cosB ? 1.0f : cosA * cosB + sinA * sinB;
+}
+
+static float SinSubClamped(float sinA, float cosA, float sinB, float cosB)
+{
+    return cosA > cosB ? 0.0f : sinA * cosB - cosA * sinB;
+}
+
+float Importance(const Gpu::LightBvhNode& node, const glm::vec3& p, const glm::vec3& n)
+{
+    const glm::vec3 center = 0.5f * (node.boundsMin + node.boundsMax);
+    const glm::vec3 halfDiagonal = 0.5f * (node.boundsMax - node.boundsMin);
+    const float radius2 = glm::dot(halfDiagonal, halfDiagonal);
+    const glm::vec3 d = p - center;
+    const float distance2 = glm::dot(d, d);
+
+    // Directions from the node to p, within theta b of wi. Points inside the bounding sphere see it everywhere.
+    const glm::vec3 wi = distance2 > 0.0f ? d / std::sqrt(distance2) : glm::vec3(0.0f, 0.0f, 1.0f);
+    float sinThetaB = 0.0f;
+    float cosThetaB = -1.0f;
+    if (distance2 > radius2)
+    {
+        sinThetaB = std::sqrt(radius2 / distance2);
+        cosThetaB = std::sqrt(std::max(0.0f, 1.0f - radius2 / distance2));
+    }
+
+    // Smallest angle between an emission direction and a direction to p
+    const float cosThetaW = glm::dot(node.axis, wi);
+    const float sinThetaW = std::sqrt(std::max(0.0f, 1.0f - cosThetaW * cosThetaW));
+    const float sinThetaO = std::sqrt(std::max(0.0f, 1.0f - node.cosThetaO * node.cosThetaO));
+    const float cosThetaX = CosSubClamped(sinThetaW, cosThetaW, sinThetaO, node.cosThetaO);
+    const float sinThetaX = SinSubClamped(sinThetaW, cosThetaW, sinThetaO, node.cosThetaO);
+    const float cosThetaP = CosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+    if (cosThetaP <= node.cosThetaE)
+    {
+        return 0.0f;
+    }
+
+    // Clamped to the bounding sphere so the nodes around p don't get all the samples
+    float importance = node.power * cosThetaP / std::max(distance2, radius2);
+    if (n != glm::vec3(0.0f))
+    {
+        // Smallest angle between n and a direction to the lights
+        const float cosThetaI = -glm::dot(wi, n);
+        const float sinThetaI = std::sqrt(std::max(0.0f, 1.0f - cosThetaI * cosThetaI));
+        importance *= std::max(CosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB), 0.0f);
+    }
+
+    return importance;
+}
+
+void PrintStats(std::ostream& os, const Hierarchy& lightBvh, const World& world)
+{
+    if (lightBvh.lights.empty())
+    {
+        return;
+    }
+
+    // Probability of every light for samples taken at the camera, and the depth of the leaves
+    std::vector<float> probabilities(lightBvh.lights.size(), 0.0f);
+    uint32_t maxDepth = 0;
+    uint64_t depthSum = 0;
+    const std::function<void(uint32_t, float, uint32_t)> visit = [&](uint32_t nodeIdx, float probability, uint32_t depth)
+    {
+        const Gpu::LightBvhNode& node = lightBvh.nodes[nodeIdx];
+        if ((node.child & Gpu::lightBvhLeafFlag) != 0)
+        {
+            probabilities[node.child & ~Gpu::lightBvhLeafFlag] = probability;
+            maxDepth = std::max(maxDepth, depth);
+            depthSum += depth;
+            return;
+        }
+
+        const float first = Importance(lightBvh.nodes[nodeIdx + 1], world.camera.position, glm::vec3(0.0f));
+        const float second = Importance(lightBvh.nodes[node.child], world.camera.position, glm::vec3(0.0f));
+        const float firstProbability = first + second > 0.0f ? first / (first + second) : 0.5f;
+        visit(nodeIdx + 1, probability * firstProbability, depth + 1);
+        visit(node.child, probability * (1.0f - firstProbability), depth + 1);
+    };
+    visit(0, 1.0f, 0);
+
+    // Samples spread like with that many equally likely lights
+    float sumSquares = 0.0f;
+    for (float probability : probabilities)
+    {
+        sumSquares += probability * probability;
+    }
+
+    const size_t topCount = std::max<size_t>(probabilities.size() / 100, 1);
+    std::nth_element(probabilities.begin(), probabilities.begin() + topCount, probabilities.end(), std::greater<float>());
+    float topShare = 0.0f;
+    for (size_t i = 0; i < topCount; ++i)
+    {
+        topShare += probabilities[i];
+    }
+
+    const size_t size = lightBvh.nodes.size() * sizeof(Gpu::LightBvhNode) + lightBvh.lights.size() * sizeof(Gpu::Light);
+    os << std::fixed << std::setprecision(1);
+    os << "Light BVH: " << lightBvh.lights.size() << " lights, " << lightBvh.nodes.size() << " nodes, " << size << " B, depth " <<
+        maxDepth << " (" << static_cast<float>(depthSum) / lightBvh.lights.size() << " on average)\n";
+    os << " from the camera: " << 100.0f * topShare << "% of the light samples on the top 1% of the lights, as spread as " <<
+        (sumSquares > 0.0f ? 1.0f / sumSquares : 0.0f) << " equally likely lights\n";
+    os << std::defaultfloat;
+}
+
+}
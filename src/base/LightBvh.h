@@ -0,0 +1,38 @@
+#pragma once
+
+#include "GpuLayout.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct World;
+
+// Light hierarchy over the emissive spheres (Conty Estevez and Kulla 2018). Every node bounds the positions, the total
+// power and the emission directions of the lights below it. For every light sample the tracer walks it from the root,
+// picking a child with a probability proportional to an estimate of the light it sends to the shaded point, so the
+// lights that matter get the samples whatever the number of the others.
+namespace LightBvh
+{
+    struct Hierarchy
+    {
+        // Node 0 is the root, empty without lights
+        std::vector<Gpu::LightBvhNode> nodes;
+        // Sorted by sphere
+        std::vector<Gpu::Light> lights;
+    };
+
+    // sphereOrder is the World index of the sphere at each position of the encoded sphere arrays, the lights refer
+    // to the latter. Orbiting spheres (dynamic scenes) are bounded over their whole orbit around the vertical axis,
+    // the hierarchy isn't rebuilt when they move.
+    Hierarchy Build(const World& world, const std::vector<uint32_t>& sphereOrder, bool orbitingSpheres);
+
+    // Host version of the importance of raytracing.comp: estimate of the light the lights of the node send to p,
+    // for a surface facing n. A null n ignores the orientation of the receiver.
+    float Importance(const Gpu::LightBvhNode& node, const glm::vec3& p, const glm::vec3& n);
+
+    // Size and depth, and how the light samples taken at the World camera are spread over the lights
+    void PrintStats(std::ostream& os, const Hierarchy& lightBvh, const World& world);
+}
@@ -0,0 +1,71 @@
+#include "LightSplats.h"
+
+#include "GpuLayout.h"
+#include "VulkanUtils.h"
+
+#include <string>
+
+void LightSplats::Init(VkDevice logicalDevice, VkPipelineLayout tracePipelineLayout)
+{
+    VkComputePipelineCreateInfo computePipelineCreateInfo{};
+    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    computePipelineCreateInfo.layout = tracePipelineLayout;
+    computePipelineCreateInfo.stage =
+        VulkanUtils::CreateShaderStage(logicalDevice, VulkanUtils::GetShadersPath() + "bdpt_resolve.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &m_resolvePipeline));
+
+    VulkanUtils::DestroyShaderStage(logicalDevice, computePipelineCreateInfo.stage);
+}
+
+void LightSplats::Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice)
+{
+    vkDestroyPipeline(logicalDevice, m_resolvePipeline, nullptr);
+    m_resolvePipeline = VK_NULL_HANDLE;
+
+    m_splats.Release(allocator);
+    m_light.Release(allocator);
+    m_cleared = false;
+}
+
+void LightSplats::Reserve(DeviceMemoryAllocator& allocator, uint32_t width, uint32_t height)
+{
+    const VkDeviceSize pixelsCount = static_cast<VkDeviceSize>(width) * height;
+    m_splats.Reserve(allocator, pixelsCount * 3 * sizeof(uint32_t));
+    m_light.Reserve(allocator, pixelsCount * sizeof(glm::vec3));
+    m_width = width;
+    m_height = height;
+    m_cleared = false;
+}
+
+void LightSplats::RecordPassBegin(VkCommandBuffer commandBuffer)
+{
+    vkCmdFillBuffer(commandBuffer, m_splats.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+    if (!m_cleared)
+    {
+        vkCmdFillBuffer(commandBuffer, m_light.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+        m_cleared = true;
+    }
+
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void LightSplats::RecordPassEnd(VkCommandBuffer commandBuffer)
+{
+    // The splats and the accumulation image written by the trace
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_resolvePipeline);
+    vkCmdDispatch(commandBuffer, (m_width + Gpu::bdptWorkgroupSize - 1) / Gpu::bdptWorkgroupSize,
+        (m_height + Gpu::bdptWorkgroupSize - 1) / Gpu::bdptWorkgroupSize, 1);
+}
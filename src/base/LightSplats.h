@@ -0,0 +1,43 @@
+#pragma once
+
+#include "DeviceMemoryAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// Light tracing splats of the bidirectional integrator (see bdpt.glsl). The light subpaths seen by the camera add
+// to the pixels they project to, anywhere in the image, so they are summed over a whole pass and only folded into
+// the image by a resolve pass once the last batch of tiles of the pass has been traced. The resolve shares the
+// bindings and the push constants of the trace.
+class LightSplats
+{
+public:
+    // tracePipelineLayout is the layout of raytracing.comp, it outlives the splats
+    void Init(VkDevice logicalDevice, VkPipelineLayout tracePipelineLayout);
+    void Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice);
+
+    // Allocates the sums for an image of width x height pixels, the next pass clears them
+    void Reserve(DeviceMemoryAllocator& allocator, uint32_t width, uint32_t height);
+
+    // Clears the splats before the first batch of a pass, followed by a barrier making them visible to compute
+    // shaders
+    void RecordPassBegin(VkCommandBuffer commandBuffer);
+
+    // Records the resolve pass after the batch completing a pass, the descriptor set and the push constants of the
+    // trace still bound. Waits for the trace.
+    void RecordPassEnd(VkCommandBuffer commandBuffer);
+
+    // For ComputePushConstants::bdptSplats and bdptLight, 0 until the first pass cleared the sums
+    VkDeviceAddress GetSplatsAddress() const { return m_cleared ? m_splats.GetAddress() : 0; }
+    VkDeviceAddress GetLightAddress() const { return m_cleared ? m_light.GetAddress() : 0; }
+
+private:
+    VkPipeline m_resolvePipeline = VK_NULL_HANDLE;
+
+    DeviceArray m_splats;
+    DeviceArray m_light;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    bool m_cleared = false;
+};
@@ -0,0 +1,21 @@
+#include "Materials.h"
+#include "VulkanUtils.h"
+
+MaterialInfo MaterialManager::Intern(const Material& material)
+{
+    auto it = m_materialIndices.find(material);
+    if (it != m_materialIndices.end())
+    {
+        return MaterialInfo(it->second);
+    }
+
+    if (materials.size() == maxMaterialsCount)
+    {
+        VulkanUtils::FatalExit("Too many distinct materials for 16 bit material indices!", -1);
+    }
+
+    const uint16_t index = static_cast<uint16_t>(materials.size());
+    materials.push_back(material);
+    m_materialIndices.emplace(material, index);
+    return MaterialInfo(index);
+}
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 
 #include <glm/glm.hpp>
 
@@ -8,65 +11,102 @@ enum class MaterialType : uint32_t
 {
     Lambertian,
     Metal,
-    Dielectric
+    Dielectric,
+    Emissive
 };
 
-struct LambertianMaterialProperties 
+// Host side descriptions, the GPU layouts are produced by SceneEncoding
+struct LambertianMaterialProperties
 {
     glm::vec3 albedo;
-    float dummy;
 };
 
-struct MetalMaterialProperties 
+struct MetalMaterialProperties
 {
     glm::vec3 albedo;
-    float fuzz = 0.5f;
+    // GGX roughness, 0 is a perfect mirror
+    float roughness = 0.5f;
 };
 
 struct DielectricMaterialProperties
 {
     float refractionIndex = 1.0f;
-    float _dummy1;
-    float _dummy2;
-    float _dummy3;
 };
 
+// Black body emitting the same radiance in every direction from its outer side
+struct EmissiveMaterialProperties
+{
+    glm::vec3 color;
+    float intensity = 1.0f;
+};
+
+// Entry of the material table, tagged with its type
+struct Material
+{
+    MaterialType type = MaterialType::Lambertian;
+    glm::vec3 albedo = glm::vec3(0.0f);   // Lambertian, Metal, Emissive: radiance
+    float parameter = 0.0f;               // Metal: roughness, Dielectric: refraction index
+
+    bool operator==(const Material&) const = default;
+};
+
+// Index of a material in MaterialManager::materials
 struct MaterialInfo
 {
-    MaterialType type;
-    uint32_t propertiesIdx;
-    uint32_t _dummy1;
-    uint32_t _dummy2;
+    uint16_t index;
 
 private:
-    MaterialInfo(MaterialType inType, uint32_t inPropertiesIdx) : type(inType), propertiesIdx(inPropertiesIdx) {}
+    explicit MaterialInfo(uint16_t inIndex) : index(inIndex) {}
     friend struct MaterialManager;
 };
 
+// One table for all material types. Identical materials are stored once, so scenes creating a material
+// per object only grow the table with the distinct ones, and indices fit in 16 bits.
 struct MaterialManager
 {
+    static constexpr size_t maxMaterialsCount = 1 << 16;
+
     MaterialInfo CreateMaterial(const LambertianMaterialProperties& propertis)
     {
-        MaterialInfo info(MaterialType::Lambertian, static_cast<uint32_t>(lambertianMaterials.size()));
-        lambertianMaterials.push_back(propertis);
-        return info;
+        return Intern({ .type = MaterialType::Lambertian, .albedo = propertis.albedo });
     }
 
     MaterialInfo CreateMaterial(const MetalMaterialProperties& propertis)
     {
-        MaterialInfo info(MaterialType::Metal, static_cast<uint32_t>(metalMaterials.size()));
-        metalMaterials.push_back(propertis);
-        return info;
+        return Intern({ .type = MaterialType::Metal, .albedo = propertis.albedo, .parameter = propertis.roughness });
     }
 
     MaterialInfo CreateMaterial(const DielectricMaterialProperties& propertis)
     {
-        MaterialInfo info(MaterialType::Dielectric, static_cast<uint32_t>(dielectricMaterials.size()));
-        dielectricMaterials.push_back(propertis);
-        return info;
+        return Intern({ .type = MaterialType::Dielectric, .parameter = propertis.refractionIndex });
     }
 
-    std::vector<LambertianMaterialProperties> lambertianMaterials;
-    std::vector<MetalMaterialProperties> metalMaterials;
-    std::vector<DielectricMaterialProperties> dielectricMaterials;
-};
\ No newline at end of file
+    MaterialInfo CreateMaterial(const EmissiveMaterialProperties& propertis)
+    {
+        return Intern({ .type = MaterialType::Emissive, .albedo = propertis.color * propertis.intensity });
+    }
+
+    const Material& GetMaterial(MaterialInfo info) const { return materials[info.index]; }
+
+    std::vector<Material> materials;
+
+private:
+    struct MaterialHash
+    {
+        size_t operator()(const Material& material) const
+        {
+            const std::hash<float> hashFloat;
+            size_t hash = static_cast<size_t>(material.type);
+            for (float value : { material.albedo.r, material.albedo.g, material.albedo.b, material.parameter })
+            {
+                hash ^= hashFloat(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            }
+
+            return hash;
+        }
+    };
+
+    MaterialInfo Intern(const Material& material);
+
+    std::unordered_map<Material, uint16_t, MaterialHash> m_materialIndices;
+};
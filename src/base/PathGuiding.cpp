@@ -0,0 +1,110 @@
+#include "PathGuiding.h"
+
+#include "GpuLayout.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <string>
+
+static_assert(Gpu::guidingBins == Gpu::guidingResolution * Gpu::guidingResolution);
+
+void PathGuiding::Init(VkDevice logicalDevice)
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.size = sizeof(Gpu::GuidingPushConstants);
+
+    // The arrays are reached through the GuidingInfo address in the push constants, no descriptor sets
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo{};
+    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    computePipelineCreateInfo.layout = m_pipelineLayout;
+    computePipelineCreateInfo.stage =
+        VulkanUtils::CreateShaderStage(logicalDevice, VulkanUtils::GetShadersPath() + "guiding_build.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &m_buildPipeline));
+
+    VulkanUtils::DestroyShaderStage(logicalDevice, computePipelineCreateInfo.stage);
+}
+
+void PathGuiding::Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice)
+{
+    vkDestroyPipeline(logicalDevice, m_buildPipeline, nullptr);
+    m_buildPipeline = VK_NULL_HANDLE;
+
+    vkDestroyPipelineLayout(logicalDevice, m_pipelineLayout, nullptr);
+    m_pipelineLayout = VK_NULL_HANDLE;
+
+    m_info.Release(allocator);
+    m_cells.Release(allocator);
+    m_histograms.Release(allocator);
+    m_distributions.Release(allocator);
+    m_cleared = false;
+}
+
+void PathGuiding::Reserve(DeviceMemoryAllocator& allocator)
+{
+    const VkDeviceSize binsCount = static_cast<VkDeviceSize>(Gpu::guidingCapacity) * Gpu::guidingBins;
+    m_info.Reserve(allocator, sizeof(Gpu::GuidingInfo));
+    m_cells.Reserve(allocator, Gpu::guidingCapacity * sizeof(Gpu::GuidingCell));
+    m_histograms.Reserve(allocator, binsCount * sizeof(uint32_t));
+    m_distributions.Reserve(allocator, binsCount * sizeof(float));
+
+    m_cleared = false;
+    m_iterationFrames = firstIterationFrames;
+    m_framesInIteration = 0;
+}
+
+void PathGuiding::Record(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+    if (!m_cleared)
+    {
+        Gpu::GuidingInfo info;
+        info.cells = m_cells.GetAddress();
+        info.histograms = m_histograms.GetAddress();
+        info.distributions = m_distributions.GetAddress();
+        vkCmdUpdateBuffer(commandBuffer, m_info.GetBuffer(), 0, sizeof(info), &info);
+
+        // Zero cumulative probabilities: no cell has a distribution before the first iteration ends
+        vkCmdFillBuffer(commandBuffer, m_cells.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(commandBuffer, m_histograms.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(commandBuffer, m_distributions.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+        memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+        m_cleared = true;
+        return;
+    }
+
+    // The frames recorded since the last build trained the histograms
+    if (++m_framesInIteration < m_iterationFrames)
+    {
+        return;
+    }
+
+    Gpu::GuidingPushConstants pushConstants;
+    pushConstants.info = m_info.GetAddress();
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_buildPipeline);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+        0, sizeof(Gpu::GuidingPushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, Gpu::guidingCapacity / Gpu::guidingWorkgroupSize, 1, 1);
+
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    m_iterationFrames = std::min(2 * m_iterationFrames, maxIterationFrames);
+    m_framesInIteration = 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "DeviceMemoryAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// Learned incident light distributions guiding the bounces off rough surfaces (see guiding.glsl). The tracer
+// trains the histograms of a hash grid of cells with every path, and samples the distributions built from the
+// previous training iterations. The iterations double in length, like the sample budgets of Muller et al. 2017:
+// the first distributions are coarse but come quickly, the later ones are built from more and more samples.
+class PathGuiding
+{
+public:
+    void Init(VkDevice logicalDevice);
+    void Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice);
+
+    // Allocates the cells, the next Record clears them
+    void Reserve(DeviceMemoryAllocator& allocator);
+
+    // Records what the frame needs before the trace: the clear of the cells the first time, the build pass at
+    // the end of a training iteration, each one followed by a barrier making its writes visible to compute
+    // shaders. The build waits for the compute work recorded or submitted before it.
+    void Record(VkCommandBuffer commandBuffer);
+
+    // GuidingInfo for ComputePushConstants::guiding, 0 until the cells have been cleared
+    VkDeviceAddress GetInfoAddress() const { return m_cleared ? m_info.GetAddress() : 0; }
+
+private:
+    static constexpr uint32_t firstIterationFrames = 4;
+    static constexpr uint32_t maxIterationFrames = 64;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_buildPipeline = VK_NULL_HANDLE;
+
+    DeviceArray m_info;
+    DeviceArray m_cells;
+    DeviceArray m_histograms;
+    DeviceArray m_distributions;
+    bool m_cleared = false;
+
+    uint32_t m_iterationFrames = firstIterationFrames;
+    uint32_t m_framesInIteration = 0;
+};
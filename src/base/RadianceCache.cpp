@@ -0,0 +1,79 @@
+#include "RadianceCache.h"
+
+#include "GpuLayout.h"
+#include "VulkanUtils.h"
+
+#include <string>
+
+void RadianceCache::Init(VkDevice logicalDevice)
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.size = sizeof(Gpu::RadianceCachePushConstants);
+
+    // The entries are reached through their address in the push constants, no descriptor sets
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo{};
+    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    computePipelineCreateInfo.layout = m_pipelineLayout;
+    computePipelineCreateInfo.stage =
+        VulkanUtils::CreateShaderStage(logicalDevice, VulkanUtils::GetShadersPath() + "radiance_cache_resolve.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &m_resolvePipeline));
+
+    VulkanUtils::DestroyShaderStage(logicalDevice, computePipelineCreateInfo.stage);
+}
+
+void RadianceCache::Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice)
+{
+    vkDestroyPipeline(logicalDevice, m_resolvePipeline, nullptr);
+    m_resolvePipeline = VK_NULL_HANDLE;
+
+    vkDestroyPipelineLayout(logicalDevice, m_pipelineLayout, nullptr);
+    m_pipelineLayout = VK_NULL_HANDLE;
+
+    m_entries.Release(allocator);
+    m_cleared = false;
+}
+
+void RadianceCache::Reserve(DeviceMemoryAllocator& allocator)
+{
+    m_entries.Reserve(allocator, static_cast<VkDeviceSize>(Gpu::radianceCacheCapacity) * sizeof(Gpu::RadianceCacheEntry));
+    m_cleared = false;
+}
+
+void RadianceCache::Record(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+    if (!m_cleared)
+    {
+        vkCmdFillBuffer(commandBuffer, m_entries.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+        memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+        m_cleared = true;
+    }
+
+    Gpu::RadianceCachePushConstants pushConstants;
+    pushConstants.entries = m_entries.GetAddress();
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_resolvePipeline);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+        0, sizeof(Gpu::RadianceCachePushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, Gpu::radianceCacheCapacity / Gpu::radianceCacheWorkgroupSize, 1, 1);
+
+    // The paths of the next trace read the averages and add their samples
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "DeviceMemoryAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+// World space hash grid of the light leaving the rough surfaces of the scene. The tracer adds the light its paths
+// find past their rough vertices, and ends most paths at their first rough hit after a rough bounce once the cache
+// knows its cell (see radiance_cache.glsl). The samples of a frame are folded into the averages of the entries by
+// a resolve pass recorded before the next trace, which also frees the entries no path went through for a while.
+class RadianceCache
+{
+public:
+    void Init(VkDevice logicalDevice);
+    void Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice);
+
+    // Allocates the entries, the next Record clears them
+    void Reserve(DeviceMemoryAllocator& allocator);
+
+    // Records the resolve pass, followed by a barrier making the entries visible to compute shaders. The first
+    // one clears the cache. Waits for the compute work recorded or submitted before it.
+    void Record(VkCommandBuffer commandBuffer);
+
+    // Entries for ComputePushConstants::radianceCache, 0 until the cache has been cleared
+    VkDeviceAddress GetEntriesAddress() const { return m_cleared ? m_entries.GetAddress() : 0; }
+
+private:
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_resolvePipeline = VK_NULL_HANDLE;
+
+    DeviceArray m_entries;
+    bool m_cleared = false;
+};
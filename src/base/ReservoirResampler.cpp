@@ -0,0 +1,158 @@
+#include "ReservoirResampler.h"
+
+#include "VulkanUtils.h"
+
+#include <string>
+
+static constexpr std::array<const char*, 3> passShaders =
+{
+    "restir_initial.comp.spv",
+    "restir_temporal.comp.spv",
+    "restir_spatial.comp.spv"
+};
+
+static uint32_t DivideRoundUp(uint32_t count, uint32_t groupSize)
+{
+    return (count + groupSize - 1) / groupSize;
+}
+
+// Makes the writes of the previous commands visible to the next compute dispatch
+static void ComputeBarrier(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void ReservoirResampler::Init(VkDevice logicalDevice)
+{
+    static_assert(passShaders.size() == PassesCount);
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.size = sizeof(Gpu::RestirPushConstants);
+
+    // Everything is reached through the addresses in the push constants, no descriptor sets
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));
+
+    for (uint32_t i = 0; i < PassesCount; ++i)
+    {
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.layout = m_pipelineLayout;
+        computePipelineCreateInfo.stage =
+            VulkanUtils::CreateShaderStage(logicalDevice, VulkanUtils::GetShadersPath() + passShaders[i], VK_SHADER_STAGE_COMPUTE_BIT);
+
+        VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &m_pipelines[i]));
+
+        VulkanUtils::DestroyShaderStage(logicalDevice, computePipelineCreateInfo.stage);
+    }
+}
+
+void ReservoirResampler::Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice)
+{
+    for (VkPipeline& pipeline : m_pipelines)
+    {
+        vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    vkDestroyPipelineLayout(logicalDevice, m_pipelineLayout, nullptr);
+    m_pipelineLayout = VK_NULL_HANDLE;
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        m_surfaces[i].Release(allocator);
+        m_finalReservoirs[i].Release(allocator);
+    }
+
+    m_reservoirs.Release(allocator);
+}
+
+void ReservoirResampler::Reserve(DeviceMemoryAllocator& allocator, uint32_t width, uint32_t height)
+{
+    const VkDeviceSize pixelsCount = static_cast<VkDeviceSize>(width) * height;
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        m_surfaces[i].Reserve(allocator, pixelsCount * sizeof(Gpu::RestirSurface));
+        m_finalReservoirs[i].Reserve(allocator, pixelsCount * sizeof(Gpu::RestirReservoir));
+    }
+
+    m_reservoirs.Reserve(allocator, pixelsCount * sizeof(Gpu::RestirReservoir));
+
+    // The arrays may have been reallocated
+    m_width = width;
+    m_height = height;
+    m_historyValid = false;
+    m_recorded = false;
+}
+
+void ReservoirResampler::Dispatch(VkCommandBuffer commandBuffer, PassIdx pass, const Gpu::RestirPushConstants& pushConstants) const
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[pass]);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+        0, sizeof(Gpu::RestirPushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, DivideRoundUp(m_width, Gpu::restirWorkgroupSize), DivideRoundUp(m_height, Gpu::restirWorkgroupSize), 1);
+}
+
+void ReservoirResampler::Record(VkCommandBuffer commandBuffer, const GpuScene& scene, const Gpu::ComputeUniforms& uniforms)
+{
+    m_recorded = scene.GetHeader().lightsCount != 0 && m_width != 0 && m_height != 0;
+    if (!m_recorded)
+    {
+        m_historyValid = false;
+        return;
+    }
+
+    // The previous surfaces are stored as distances along the rays of the previous camera, they can't be
+    // reprojected if the viewport changed
+    if (uniforms.aspectRatio != m_previousAspectRatio)
+    {
+        m_historyValid = false;
+    }
+
+    ++m_frame;
+    const uint32_t current = m_frame % 2;
+    const uint32_t previous = 1 - current;
+
+    Gpu::RestirPushConstants pushConstants;
+    pushConstants.scene = scene.GetHeaderAddress();
+    pushConstants.surfaces = m_surfaces[current].GetAddress();
+    pushConstants.previousSurfaces = m_surfaces[previous].GetAddress();
+    pushConstants.reservoirs = m_reservoirs.GetAddress();
+    pushConstants.previousReservoirs = m_finalReservoirs[previous].GetAddress();
+    pushConstants.finalReservoirs = m_finalReservoirs[current].GetAddress();
+    pushConstants.cameraPosition = uniforms.cameraPosition;
+    pushConstants.aspectRatio = uniforms.aspectRatio;
+    pushConstants.cameraDirection = uniforms.cameraDirection;
+    pushConstants.width = m_width;
+    pushConstants.previousCameraPosition = m_previousCameraPosition;
+    pushConstants.height = m_height;
+    pushConstants.previousCameraDirection = m_previousCameraDirection;
+    pushConstants.frame = m_frame;
+    pushConstants.historyValid = m_historyValid ? 1 : 0;
+
+    Dispatch(commandBuffer, InitialPass, pushConstants);
+    ComputeBarrier(commandBuffer);
+    Dispatch(commandBuffer, TemporalPass, pushConstants);
+    ComputeBarrier(commandBuffer);
+    Dispatch(commandBuffer, SpatialPass, pushConstants);
+    ComputeBarrier(commandBuffer);
+
+    m_historyValid = true;
+    m_previousCameraPosition = uniforms.cameraPosition;
+    m_previousCameraDirection = uniforms.cameraDirection;
+    m_previousAspectRatio = uniforms.aspectRatio;
+}
+
+VkDeviceAddress ReservoirResampler::GetReservoirsAddress() const
+{
+    return m_recorded ? m_finalReservoirs[m_frame % 2].GetAddress() : 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "DeviceMemoryAllocator.h"
+#include "GpuScene.h"
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+// ReSTIR direct lighting of the emissive spheres (Bitterli et al. 2020), recorded every frame before the tracer.
+// Every pixel resamples light hierarchy samples into a reservoir for the hit of its center ray, combines it with
+// the reservoir the previous frame ended with at the same surface point, then with the reservoirs of random
+// neighbours. The tracer shades its camera ray hits with the sample kept by their pixel.
+class ReservoirResampler
+{
+public:
+    void Init(VkDevice logicalDevice);
+    void Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice);
+
+    // Grows the surface and reservoir arrays to an image of width x height pixels, they must not be in use
+    void Reserve(DeviceMemoryAllocator& allocator, uint32_t width, uint32_t height);
+
+    // Records the passes of a frame for the camera of the uniforms, followed by a barrier making the reservoirs
+    // visible to compute shaders. Waits for the compute work recorded or submitted before it. Scenes without
+    // emissive spheres record nothing.
+    void Record(VkCommandBuffer commandBuffer, const GpuScene& scene, const Gpu::ComputeUniforms& uniforms);
+
+    // Reservoirs of the last recorded frame for ComputePushConstants::restirReservoirs, 0 if it recorded nothing
+    VkDeviceAddress GetReservoirsAddress() const;
+
+private:
+    enum PassIdx : uint32_t
+    {
+        InitialPass,
+        TemporalPass,
+        SpatialPass,
+        PassesCount
+    };
+
+    void Dispatch(VkCommandBuffer commandBuffer, PassIdx pass, const Gpu::RestirPushConstants& pushConstants) const;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    std::array<VkPipeline, PassesCount> m_pipelines{};
+
+    // Swapped every frame, the ones of the previous frame are reused by the temporal pass
+    std::array<DeviceArray, 2> m_surfaces;
+    std::array<DeviceArray, 2> m_finalReservoirs;
+    DeviceArray m_reservoirs;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_frame = 0;
+    bool m_recorded = false;
+
+    // Camera of the previous recorded frame, its reservoirs are only reused while this one is valid
+    bool m_historyValid = false;
+    glm::vec3 m_previousCameraPosition = glm::vec3(0.0f);
+    glm::vec3 m_previousCameraDirection = glm::vec3(0.0f);
+    float m_previousAspectRatio = 0.0f;
+};
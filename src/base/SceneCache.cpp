@@ -0,0 +1,362 @@
+#include "SceneCache.h"
+
+#include "World.h"
+
+#include <windows.h>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace SceneCache
+{
+
+// Bump when the encoding or the layout of the file changes
+const uint32_t cacheVersion = 5;
+
+const uint32_t cacheMagic = 0x43535452; // "RTSC"
+
+// Arrays of EncodedSceneView in the file
+enum ArrayIdx : uint32_t
+{
+    SphereGeometry,
+    SphereMaterials,
+    SphereChunks,
+    Materials,
+    SphereMotion,
+    WideBvhNodes,
+    Planes,
+    Quads,
+    Boxes,
+    SphereFields,
+    LightBvhNodes,
+    Lights,
+    ArraysCount
+};
+
+struct FileHeader
+{
+    uint32_t magic = cacheMagic;
+    uint32_t version = cacheVersion;
+    uint64_t sceneHash = 0;
+    uint32_t encoding = 0;
+    uint32_t acceleration = 0;
+    uint32_t spheresCount = 0;
+    uint32_t padding = 0;
+    // Byte offsets from the start of the file, aligned to arrayAlignment
+    std::array<uint64_t, ArraysCount> offsets{};
+    std::array<uint64_t, ArraysCount> sizes{};
+};
+
+// Enough for every array element type
+const uint64_t arrayAlignment = 16;
+
+// FNV-1a, fed field by field so struct padding never gets hashed
+class Hasher
+{
+public:
+    template<typename T>
+    void Add(const T& value)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            m_hash ^= bytes[i];
+            m_hash *= 1099511628211ull;
+        }
+    }
+
+    uint64_t Get() const { return m_hash; }
+
+private:
+    uint64_t m_hash = 14695981039346656037ull;
+};
+
+uint64_t HashScene(const World& world, SceneEncoding encoding, SceneAcceleration acceleration, bool dynamic)
+{
+    Hasher hasher;
+    hasher.Add(cacheVersion);
+    // Layouts and constants the encoding depends on
+    hasher.Add(sizeof(Gpu::PackedSphere));
+    hasher.Add(sizeof(Gpu::QuantizedSphere));
+    hasher.Add(sizeof(Gpu::SphereChunk));
+    hasher.Add(sizeof(Gpu::Material));
+    hasher.Add(sizeof(Gpu::WideBvhNode));
+    hasher.Add(sizeof(Gpu::Plane));
+    hasher.Add(sizeof(Gpu::Quad));
+    hasher.Add(sizeof(Gpu::Box));
+    hasher.Add(sizeof(Gpu::SphereField));
+    hasher.Add(sizeof(Gpu::LightBvhNode));
+    hasher.Add(sizeof(Gpu::Light));
+    hasher.Add(Gpu::sphereChunkSize);
+    hasher.Add(Gpu::materialTypeShift);
+    hasher.Add(Gpu::wideBvhWidth);
+    hasher.Add(Gpu::wideBvhMaxLeafSpheres);
+
+    hasher.Add(encoding);
+    hasher.Add(acceleration);
+    hasher.Add(dynamic);
+
+    hasher.Add(world.spheres.size());
+    for (const Sphere& sphere : world.spheres)
+    {
+        hasher.Add(sphere.shape.center.x);
+        hasher.Add(sphere.shape.center.y);
+        hasher.Add(sphere.shape.center.z);
+        hasher.Add(sphere.shape.centerEnd.x);
+        hasher.Add(sphere.shape.centerEnd.y);
+        hasher.Add(sphere.shape.centerEnd.z);
+        hasher.Add(sphere.shape.radius);
+        hasher.Add(sphere.material.index);
+    }
+
+    hasher.Add(world.planes.size());
+    for (const Plane& plane : world.planes)
+    {
+        hasher.Add(plane.shape.normal.x);
+        hasher.Add(plane.shape.normal.y);
+        hasher.Add(plane.shape.normal.z);
+        hasher.Add(plane.shape.distance);
+        hasher.Add(plane.material.index);
+    }
+
+    hasher.Add(world.quads.size());
+    for (const Quad& quad : world.quads)
+    {
+        for (const glm::vec3& v : { quad.shape.origin, quad.shape.edgeU, quad.shape.edgeV })
+        {
+            hasher.Add(v.x);
+            hasher.Add(v.y);
+            hasher.Add(v.z);
+        }
+        hasher.Add(quad.material.index);
+    }
+
+    hasher.Add(world.boxes.size());
+    for (const Box& box : world.boxes)
+    {
+        for (const glm::vec3& v : { box.shape.boundsMin, box.shape.boundsMax })
+        {
+            hasher.Add(v.x);
+            hasher.Add(v.y);
+            hasher.Add(v.z);
+        }
+        hasher.Add(box.material.index);
+    }
+
+    hasher.Add(world.sphereFields.size());
+    for (const SphereField& field : world.sphereFields)
+    {
+        for (const glm::vec3& v : { field.shape.boundsMin, field.shape.boundsMax })
+        {
+            hasher.Add(v.x);
+            hasher.Add(v.y);
+            hasher.Add(v.z);
+        }
+        hasher.Add(field.shape.cellSize);
+        hasher.Add(field.shape.seed);
+        hasher.Add(field.shape.density);
+        hasher.Add(field.shape.radiusMin);
+        hasher.Add(field.shape.radiusMax);
+        hasher.Add(field.material.index);
+    }
+
+    hasher.Add(world.materialManager.materials.size());
+    for (const Material& material : world.materialManager.materials)
+    {
+        hasher.Add(material.type);
+        hasher.Add(material.albedo.r);
+        hasher.Add(material.albedo.g);
+        hasher.Add(material.albedo.b);
+        hasher.Add(material.parameter);
+    }
+
+    return hasher.Get();
+}
+
+std::string GetFileName(uint64_t sceneHash)
+{
+    std::stringstream fileName;
+    fileName << "scene_" << std::hex << sceneHash << ".cache";
+    return fileName.str();
+}
+
+template<typename T>
+static std::span<const uint8_t> AsBytes(std::span<const T> span)
+{
+    return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(span.data()), span.size_bytes());
+}
+
+static std::array<std::span<const uint8_t>, ArraysCount> GetArrays(const SceneEncoder::EncodedSceneView& scene)
+{
+    return
+    {
+        AsBytes(scene.sphereGeometry),
+        AsBytes(scene.sphereMaterials),
+        AsBytes(scene.sphereChunks),
+        AsBytes(scene.materials),
+        AsBytes(scene.sphereMotion),
+        AsBytes(scene.wideBvhNodes),
+        AsBytes(scene.planes),
+        AsBytes(scene.quads),
+        AsBytes(scene.boxes),
+        AsBytes(scene.sphereFields),
+        AsBytes(scene.lightBvhNodes),
+        AsBytes(scene.lights)
+    };
+}
+
+bool Store(const std::string& fileName, uint64_t sceneHash, const SceneEncoder::EncodedSceneView& scene)
+{
+    const std::array<std::span<const uint8_t>, ArraysCount> arrays = GetArrays(scene);
+
+    FileHeader header;
+    header.sceneHash = sceneHash;
+    header.encoding = static_cast<uint32_t>(scene.encoding);
+    header.acceleration = static_cast<uint32_t>(scene.acceleration);
+    header.spheresCount = scene.spheresCount;
+
+    uint64_t offset = (sizeof(FileHeader) + arrayAlignment - 1) & ~(arrayAlignment - 1);
+    for (uint32_t i = 0; i < ArraysCount; ++i)
+    {
+        header.offsets[i] = offset;
+        header.sizes[i] = arrays[i].size();
+        offset = (offset + arrays[i].size() + arrayAlignment - 1) & ~(arrayAlignment - 1);
+    }
+
+    // Written aside and renamed, an interrupted write never leaves a file that looks valid
+    const std::string tempFileName = fileName + ".tmp";
+    bool written = false;
+    {
+        std::ofstream os(tempFileName, std::ios::binary | std::ios::trunc);
+        os.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        for (uint32_t i = 0; i < ArraysCount && os; ++i)
+        {
+            const std::array<char, arrayAlignment> zeros{};
+            os.write(zeros.data(), static_cast<std::streamsize>(header.offsets[i] - static_cast<uint64_t>(os.tellp())));
+            os.write(reinterpret_cast<const char*>(arrays[i].data()), static_cast<std::streamsize>(arrays[i].size()));
+        }
+
+        // Closed before checking, the last buffered bytes can still fail to be written (full disk)
+        os.close();
+        written = !os.fail();
+    }
+
+    // A partial file is removed as well, it would otherwise be left next to the cache forever
+    if (!written || !MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        std::remove(tempFileName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+MappedScene::~MappedScene()
+{
+    Close();
+}
+
+void MappedScene::Close()
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+
+    if (m_file != nullptr)
+    {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+
+    m_view = {};
+}
+
+template<typename T>
+static bool GetArray(const uint8_t* data, const FileHeader& header, uint64_t fileSize, ArrayIdx array, std::span<const T>& span)
+{
+    const uint64_t offset = header.offsets[array];
+    const uint64_t size = header.sizes[array];
+    if (offset % arrayAlignment != 0 || size % sizeof(T) != 0 || offset > fileSize || size > fileSize - offset)
+    {
+        return false;
+    }
+
+    span = std::span<const T>(reinterpret_cast<const T*>(data + offset), size / sizeof(T));
+    return true;
+}
+
+bool MappedScene::Open(const std::string& fileName, uint64_t sceneHash)
+{
+    Close();
+
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    m_file = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) < sizeof(FileHeader))
+    {
+        Close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    FileHeader header;
+    memcpy(&header, m_data, sizeof(FileHeader));
+
+    const uint64_t size = static_cast<uint64_t>(fileSize.QuadPart);
+    const bool valid = header.magic == cacheMagic && header.version == cacheVersion && header.sceneHash == sceneHash &&
+        GetArray(m_data, header, size, SphereGeometry, m_view.sphereGeometry) &&
+        GetArray(m_data, header, size, SphereMaterials, m_view.sphereMaterials) &&
+        GetArray(m_data, header, size, SphereChunks, m_view.sphereChunks) &&
+        GetArray(m_data, header, size, Materials, m_view.materials) &&
+        GetArray(m_data, header, size, SphereMotion, m_view.sphereMotion) &&
+        GetArray(m_data, header, size, WideBvhNodes, m_view.wideBvhNodes) &&
+        GetArray(m_data, header, size, Planes, m_view.planes) &&
+        GetArray(m_data, header, size, Quads, m_view.quads) &&
+        GetArray(m_data, header, size, Boxes, m_view.boxes) &&
+        GetArray(m_data, header, size, SphereFields, m_view.sphereFields) &&
+        GetArray(m_data, header, size, LightBvhNodes, m_view.lightBvhNodes) &&
+        GetArray(m_data, header, size, Lights, m_view.lights);
+    if (!valid)
+    {
+        Close();
+        return false;
+    }
+
+    m_view.encoding = static_cast<SceneEncoding>(header.encoding);
+    m_view.acceleration = static_cast<SceneAcceleration>(header.acceleration);
+    m_view.spheresCount = header.spheresCount;
+    return true;
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "SceneEncoding.h"
+
+#include <cstdint>
+#include <string>
+
+struct World;
+
+// Encoded scenes saved to disk, so large scenes skip the encoding and the host built acceleration structures on
+// the next launches. Files are named after a hash of everything the encoding depends on: the World spheres,
+// surfaces and materials, the encoding, the acceleration structure, whether the scene is dynamic and the cache layout version. A changed World gets a new file.
+namespace SceneCache
+{
+    uint64_t HashScene(const World& world, SceneEncoding encoding, SceneAcceleration acceleration, bool dynamic);
+
+    std::string GetFileName(uint64_t sceneHash);
+
+    // Writes the arrays of the scene, replacing any previous file
+    bool Store(const std::string& fileName, uint64_t sceneHash, const SceneEncoder::EncodedSceneView& scene);
+
+    // Read only file mapping of a cached scene, the arrays of the view point into the mapped file and stay valid
+    // until the MappedScene is destroyed
+    class MappedScene
+    {
+    public:
+        MappedScene() = default;
+        ~MappedScene();
+
+        MappedScene(const MappedScene&) = delete;
+        MappedScene& operator=(const MappedScene&) = delete;
+
+        // False if the file is missing, was written for another scene or cache version, or is truncated
+        bool Open(const std::string& fileName, uint64_t sceneHash);
+
+        const SceneEncoder::EncodedSceneView& GetView() const { return m_view; }
+
+    private:
+        void Close();
+
+        // Win32 file and file mapping handles
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+        const uint8_t* m_data = nullptr;
+
+        SceneEncoder::EncodedSceneView m_view;
+    };
+}
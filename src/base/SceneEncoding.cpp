@@ -0,0 +1,331 @@
+#include "SceneEncoding.h"
+
+#include "World.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+
+namespace SceneEncoder
+{
+
+template<typename T>
+static void AppendRecord(std::vector<uint8_t>& bytes, const T& record)
+{
+    const size_t offset = bytes.size();
+    bytes.resize(offset + sizeof(T));
+    memcpy(bytes.data() + offset, &record, sizeof(T));
+}
+
+// Spreads the 10 low bits of v so there are two zero bits between each of them
+static uint32_t ExpandBits(uint32_t v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// 30 bit Morton code of a point in [0, 1]^3
+static uint32_t MortonCode(const glm::vec3& p)
+{
+    const glm::uvec3 q = glm::uvec3(glm::clamp(p * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f)));
+    return (ExpandBits(q.x) << 2) | (ExpandBits(q.y) << 1) | ExpandBits(q.z);
+}
+
+// Sphere order of the quantized encoding, spatially close spheres end up in the same chunk
+static std::vector<uint32_t> SortSpheresByMortonCode(const std::vector<Sphere>& spheres)
+{
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+    for (const Sphere& sphere : spheres)
+    {
+        boundsMin = glm::min(boundsMin, sphere.shape.center);
+        boundsMax = glm::max(boundsMax, sphere.shape.center);
+    }
+
+    const glm::vec3 invExtent = 1.0f / glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+
+    std::vector<uint32_t> codes(spheres.size());
+    for (size_t i = 0; i < spheres.size(); ++i)
+    {
+        codes[i] = MortonCode((spheres[i].shape.center - boundsMin) * invExtent);
+    }
+
+    std::vector<uint32_t> order(spheres.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&codes](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+    return order;
+}
+
+static void EncodeQuantizedSpheres(const std::vector<Sphere>& spheres, const std::vector<uint32_t>& order, EncodedScene& scene)
+{
+    for (size_t chunkBegin = 0; chunkBegin < order.size(); chunkBegin += Gpu::sphereChunkSize)
+    {
+        const size_t chunkEnd = std::min<size_t>(chunkBegin + Gpu::sphereChunkSize, order.size());
+
+        glm::vec3 centerMin(std::numeric_limits<float>::max());
+        glm::vec3 centerMax(-std::numeric_limits<float>::max());
+        float maxRadius = 0.0f;
+        for (size_t i = chunkBegin; i < chunkEnd; ++i)
+        {
+            const SpherePrimitive& shape = spheres[order[i]].shape;
+            centerMin = glm::min(centerMin, shape.center);
+            centerMax = glm::max(centerMax, shape.center);
+            maxRadius = std::max(maxRadius, shape.radius);
+        }
+
+        Gpu::SphereChunk chunk;
+        chunk.origin = centerMin;
+        chunk.extent = centerMax - centerMin;
+        chunk.maxRadius = maxRadius;
+        scene.sphereChunks.push_back(chunk);
+
+        const glm::vec3 invExtent = 1.0f / glm::max(centerMax - centerMin, glm::vec3(1e-20f));
+        const float invMaxRadius = maxRadius > 0.0f ? 1.0f / maxRadius : 0.0f;
+
+        for (size_t i = chunkBegin; i < chunkEnd; ++i)
+        {
+            const Sphere& sphere = spheres[order[i]];
+            const glm::vec3 p = (sphere.shape.center - centerMin) * invExtent;
+
+            Gpu::QuantizedSphere quantized;
+            quantized.xy = glm::packUnorm2x16(glm::vec2(p.x, p.y));
+            quantized.zr = glm::packUnorm2x16(glm::vec2(p.z, sphere.shape.radius * invMaxRadius));
+            AppendRecord(scene.sphereGeometry, quantized);
+
+            scene.sphereMaterials.push_back(sphere.material.index);
+        }
+    }
+}
+
+static Gpu::Material EncodeMaterial(const Material& material)
+{
+    static_assert(MaterialManager::maxMaterialsCount <= (1 << 16), "Sphere material indices are 16 bit");
+
+    // Fuzz and refraction index don't need more than a half float
+    const uint32_t parameter = glm::packHalf2x16(glm::vec2(material.parameter, 0.0f)) & 0xFFFFu;
+
+    Gpu::Material encoded;
+    encoded.albedo = material.albedo;
+    encoded.typeParameter = (static_cast<uint32_t>(material.type) << Gpu::materialTypeShift) | parameter;
+    return encoded;
+}
+
+EncodedScene Encode(const World& world, SceneEncoding encoding, SceneAcceleration acceleration, bool dynamic)
+{
+    EncodedScene scene;
+    scene.encoding = encoding;
+    scene.acceleration = acceleration;
+    scene.spheresCount = static_cast<uint32_t>(world.spheres.size());
+
+    std::vector<uint32_t> order;
+    if (acceleration == SceneAcceleration::WideBvh)
+    {
+        // Leaves refer to ranges of consecutive spheres, quantized chunks stay as compact as in Morton order
+        scene.wideBvh = WideBvh::Build(world.spheres);
+        order = scene.wideBvh.sphereOrder;
+    }
+    else if (encoding == SceneEncoding::Quantized)
+    {
+        order = SortSpheresByMortonCode(world.spheres);
+    }
+    else
+    {
+        order.resize(world.spheres.size());
+        std::iota(order.begin(), order.end(), 0u);
+    }
+
+    if (encoding == SceneEncoding::Quantized)
+    {
+        EncodeQuantizedSpheres(world.spheres, order, scene);
+    }
+    else
+    {
+        for (uint32_t sphereIdx : order)
+        {
+            const Sphere& sphere = world.spheres[sphereIdx];
+            Gpu::PackedSphere packed;
+            packed.center = sphere.shape.center;
+            packed.radius = sphere.shape.radius;
+            AppendRecord(scene.sphereGeometry, packed);
+            scene.sphereMaterials.push_back(sphere.material.index);
+        }
+    }
+
+    const bool hasMotion = std::any_of(world.spheres.begin(), world.spheres.end(), [](const Sphere& sphere) { return sphere.shape.IsMoving(); });
+    if (hasMotion)
+    {
+        for (uint32_t sphereIdx : order)
+        {
+            const SpherePrimitive& shape = world.spheres[sphereIdx].shape;
+            scene.sphereMotion.push_back(shape.centerEnd - shape.center);
+        }
+    }
+
+    scene.lightBvh = LightBvh::Build(world, order, dynamic);
+
+    if (scene.sphereMaterials.size() % 2 != 0)
+    {
+        scene.sphereMaterials.push_back(0);
+    }
+
+    for (const Plane& plane : world.planes)
+    {
+        Gpu::Plane encoded;
+        encoded.normal = plane.shape.normal;
+        encoded.distance = plane.shape.distance;
+        encoded.materialIdx = plane.material.index;
+        scene.planes.push_back(encoded);
+    }
+
+    for (const Quad& quad : world.quads)
+    {
+        Gpu::Quad encoded;
+        encoded.origin = quad.shape.origin;
+        encoded.materialIdx = quad.material.index;
+        encoded.edgeU = quad.shape.edgeU;
+        encoded.edgeV = quad.shape.edgeV;
+        scene.quads.push_back(encoded);
+    }
+
+    for (const Box& box : world.boxes)
+    {
+        Gpu::Box encoded;
+        encoded.boundsMin = box.shape.boundsMin;
+        encoded.materialIdx = box.material.index;
+        encoded.boundsMax = box.shape.boundsMax;
+        scene.boxes.push_back(encoded);
+    }
+
+    for (const SphereField& field : world.sphereFields)
+    {
+        const SphereFieldPrimitive& shape = field.shape;
+        const float cellSize = std::max(shape.cellSize, 1e-6f);
+        const float maxRadius = 0.5f * cellSize;
+
+        Gpu::SphereField encoded;
+        encoded.boundsMin = shape.boundsMin;
+        encoded.cellSize = cellSize;
+        encoded.resolution = glm::max(glm::uvec3(glm::ceil((shape.boundsMax - shape.boundsMin) / cellSize)), glm::uvec3(1));
+        encoded.seed = shape.seed;
+        encoded.density = glm::clamp(shape.density, 0.0f, 1.0f);
+        encoded.radiusMin = glm::clamp(shape.radiusMin, 0.0f, maxRadius);
+        encoded.radiusMax = glm::clamp(shape.radiusMax, encoded.radiusMin, maxRadius);
+        encoded.materialIdx = field.material.index;
+        scene.sphereFields.push_back(encoded);
+    }
+
+    for (const Material& material : world.materialManager.materials)
+    {
+        scene.materials.push_back(EncodeMaterial(material));
+    }
+
+    return scene;
+}
+
+EncodedSceneView EncodedScene::GetView() const
+{
+    EncodedSceneView view;
+    view.encoding = encoding;
+    view.acceleration = acceleration;
+    view.spheresCount = spheresCount;
+    view.sphereGeometry = sphereGeometry;
+    view.sphereMaterials = sphereMaterials;
+    view.sphereChunks = sphereChunks;
+    view.materials = materials;
+    view.sphereMotion = sphereMotion;
+    view.wideBvhNodes = wideBvh.nodes;
+    view.planes = planes;
+    view.quads = quads;
+    view.boxes = boxes;
+    view.sphereFields = sphereFields;
+    view.lightBvhNodes = lightBvh.nodes;
+    view.lights = lightBvh.lights;
+    return view;
+}
+
+size_t EncodedSceneView::GetSize() const
+{
+    return sphereGeometry.size() + sphereMaterials.size() * sizeof(uint16_t) + sphereChunks.size() * sizeof(Gpu::SphereChunk) +
+        sphereMotion.size() * sizeof(glm::vec3) +
+        planes.size() * sizeof(Gpu::Plane) + quads.size() * sizeof(Gpu::Quad) + boxes.size() * sizeof(Gpu::Box) +
+        sphereFields.size() * sizeof(Gpu::SphereField) +
+        materials.size() * sizeof(Gpu::Material) +
+        wideBvhNodes.size() * sizeof(Gpu::WideBvhNode) +
+        lightBvhNodes.size() * sizeof(Gpu::LightBvhNode) + lights.size() * sizeof(Gpu::Light);
+}
+
+uint64_t GetExpectedSpheresCount(const Gpu::SphereField& field)
+{
+    const uint64_t cellsCount = uint64_t(field.resolution.x) * field.resolution.y * field.resolution.z;
+    return static_cast<uint64_t>(static_cast<double>(cellsCount) * field.density);
+}
+
+float GetBytesPerSphere(SceneEncoding encoding)
+{
+    if (encoding == SceneEncoding::Quantized)
+    {
+        return sizeof(Gpu::QuantizedSphere) + sizeof(uint16_t) + static_cast<float>(sizeof(Gpu::SphereChunk)) / Gpu::sphereChunkSize;
+    }
+
+    return sizeof(Gpu::PackedSphere) + sizeof(uint16_t);
+}
+
+void PrintStats(std::ostream& os, const EncodedSceneView& scene)
+{
+    // Previous layout: 32 byte spheres holding a 16 byte MaterialInfo, std140 padded 16 byte materials
+    const size_t legacySphereSize = 32;
+    const size_t legacyMaterialSize = 16;
+    const size_t legacySize = scene.spheresCount * legacySphereSize + scene.materials.size() * legacyMaterialSize;
+
+    // Bytes read per sphere by the intersection loop, materials are only fetched for the closest hit
+    const float traversalBytes = scene.encoding == SceneEncoding::Quantized ?
+        sizeof(Gpu::QuantizedSphere) + static_cast<float>(sizeof(Gpu::SphereChunk)) / Gpu::sphereChunkSize : sizeof(Gpu::PackedSphere);
+
+    const float mebibyte = 1024.0f * 1024.0f;
+    const float millionSpheres = 1000000.0f;
+
+    os << std::fixed << std::setprecision(2);
+    os << "Scene encoding: " << (scene.encoding == SceneEncoding::Quantized ? "quantized" : "packed") << "\n";
+    os << " spheres: " << scene.spheresCount << ", " << scene.GetSize() << " B (legacy layout " << legacySize << " B)\n";
+    os << " per sphere: " << GetBytesPerSphere(scene.encoding) << " B stored, " << traversalBytes <<
+        " B read per intersection test (legacy " << legacySphereSize << " B)\n";
+    os << " at 1M spheres: " << GetBytesPerSphere(scene.encoding) * millionSpheres / mebibyte << " MiB (legacy " <<
+        legacySphereSize * millionSpheres / mebibyte << " MiB)\n";
+    if (!scene.wideBvhNodes.empty())
+    {
+        os << " wide BVH: " << scene.wideBvhNodes.size() << " nodes, " << scene.wideBvhNodes.size() * sizeof(Gpu::WideBvhNode) << " B\n";
+    }
+    if (!scene.sphereMotion.empty())
+    {
+        os << " motion blur: " << scene.sphereMotion.size() * sizeof(glm::vec3) << " B of sphere motion vectors\n";
+    }
+    os << " surfaces: " << scene.planes.size() << " planes, " << scene.quads.size() << " quads, " << scene.boxes.size() << " boxes\n";
+    if (!scene.sphereFields.empty())
+    {
+        uint64_t fieldSpheresCount = 0;
+        for (const Gpu::SphereField& field : scene.sphereFields)
+        {
+            fieldSpheresCount += GetExpectedSpheresCount(field);
+        }
+
+        os << " sphere fields: " << scene.sphereFields.size() << ", ~" << fieldSpheresCount << " procedural spheres in " <<
+            scene.sphereFields.size() * sizeof(Gpu::SphereField) << " B (" <<
+            static_cast<float>(fieldSpheresCount) * GetBytesPerSphere(scene.encoding) / mebibyte << " MiB as stored spheres)\n";
+    }
+    os << " materials: " << scene.materials.size() << " distinct, " << scene.materials.size() * sizeof(Gpu::Material) << " B\n";
+    if (!scene.lights.empty())
+    {
+        os << " lights: " << scene.lights.size() << ", " <<
+            scene.lights.size() * sizeof(Gpu::Light) + scene.lightBvhNodes.size() * sizeof(Gpu::LightBvhNode) << " B with the light BVH\n";
+    }
+    os << std::defaultfloat;
+}
+
+}
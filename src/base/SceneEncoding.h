@@ -0,0 +1,126 @@
+#pragma once
+
+#include "GpuLayout.h"
+#include "LightBvh.h"
+#include "Materials.h"
+#include "WideBvh.h"
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <vector>
+
+struct World;
+
+// Layout of the scene arrays read by raytracing.comp
+enum class SceneEncoding : uint32_t
+{
+    // Gpu::PackedSphere spheres
+    Packed = Gpu::packedSceneEncoding,
+    // Gpu::QuantizedSphere spheres: position and radius as 16 bit values relative to the bounds of a chunk of
+    // spatially close spheres. For very large particle scenes where the precision loss doesn't show.
+    Quantized = Gpu::quantizedSceneEncoding
+};
+
+// Acceleration structure walked by raytracing.comp
+enum class SceneAcceleration : uint32_t
+{
+    // Every ray tests every sphere
+    Linear = Gpu::linearSceneAcceleration,
+    // BVH built on the GPU by LbvhBuilder from the device sphere array, so it can be rebuilt every frame
+    Lbvh = Gpu::lbvhSceneAcceleration,
+    // Uniform grid built on the GPU by GridBuilder with a counting sort of the spheres into the cells.
+    // For dense scenes of similarly sized spheres, builds faster and takes less memory than the LBVH.
+    Grid = Gpu::gridSceneAcceleration,
+    // 8-wide BVH with quantized child bounds built on the host by WideBvh, for static scenes. Fewer and smaller
+    // nodes to fetch per ray than the LBVH.
+    WideBvh = Gpu::wideBvhSceneAcceleration
+};
+
+// Light transport of raytracing.comp
+enum class Integrator : uint32_t
+{
+    // Paths from the camera, with light samples at their vertices
+    Path = Gpu::pathIntegrator,
+    // Camera and light subpaths connected in every way (see bdpt.glsl), for the caustics of the scenes lit through
+    // dielectrics. Slower per sample, with a pinhole camera.
+    Bidirectional = Gpu::bidirectionalIntegrator
+};
+
+static_assert(static_cast<uint32_t>(MaterialType::Lambertian) == Gpu::lambertianMaterialType &&
+    static_cast<uint32_t>(MaterialType::Metal) == Gpu::metalMaterialType &&
+    static_cast<uint32_t>(MaterialType::Dielectric) == Gpu::dielectricMaterialType &&
+    static_cast<uint32_t>(MaterialType::Emissive) == Gpu::emissiveMaterialType, "Material types differ from the GPU ones");
+
+namespace SceneEncoder
+{
+    // Byte images of the device arrays, uploaded as is by GpuScene. They are either held by an EncodedScene
+    // or mapped from a SceneCache file.
+    struct EncodedSceneView
+    {
+        SceneEncoding encoding = SceneEncoding::Packed;
+        SceneAcceleration acceleration = SceneAcceleration::Linear;
+        uint32_t spheresCount = 0;
+
+        std::span<const uint8_t> sphereGeometry;
+        std::span<const uint16_t> sphereMaterials;
+        std::span<const Gpu::SphereChunk> sphereChunks;
+        std::span<const Gpu::Material> materials;
+        std::span<const glm::vec3> sphereMotion;
+        std::span<const Gpu::WideBvhNode> wideBvhNodes;
+        std::span<const Gpu::Plane> planes;
+        std::span<const Gpu::Quad> quads;
+        std::span<const Gpu::Box> boxes;
+        std::span<const Gpu::SphereField> sphereFields;
+        std::span<const Gpu::LightBvhNode> lightBvhNodes;
+        std::span<const Gpu::Light> lights;
+
+        // Every array uploaded to the GPU: spheres, surfaces, materials, the wide BVH and the lights with their BVH
+        size_t GetSize() const;
+    };
+
+    struct EncodedScene
+    {
+        SceneEncoding encoding = SceneEncoding::Packed;
+        SceneAcceleration acceleration = SceneAcceleration::Linear;
+        uint32_t spheresCount = 0;
+
+        // Gpu::PackedSphere or Gpu::QuantizedSphere per sphere, the only array read by the intersection loop
+        std::vector<uint8_t> sphereGeometry;
+        // 16 bit material index per sphere, only fetched for the closest hit. Padded to an even count,
+        // the shader reads them two by two
+        std::vector<uint16_t> sphereMaterials;
+        // Quantized only, one per Gpu::sphereChunkSize spheres (in Morton order, or in the leaf order of the wide BVH)
+        std::vector<Gpu::SphereChunk> sphereChunks;
+        // Unified material table of all types
+        std::vector<Gpu::Material> materials;
+        // Center displacement over the shutter interval per sphere, in the order of sphereGeometry.
+        // Empty if no sphere moves, static scenes don't pay for motion blur.
+        std::vector<glm::vec3> sphereMotion;
+        // Wide BVH only, the sphere arrays above are in the order of its leaves
+        WideBvh::Hierarchy wideBvh;
+        // Outside of the sphere acceleration structures, every ray tests all of them
+        std::vector<Gpu::Plane> planes;
+        std::vector<Gpu::Quad> quads;
+        std::vector<Gpu::Box> boxes;
+        // Also tested by every ray, their spheres are generated by the traversal
+        std::vector<Gpu::SphereField> sphereFields;
+        // Light hierarchy over the emissive spheres, its lights refer to positions in sphereGeometry
+        LightBvh::Hierarchy lightBvh;
+
+        EncodedSceneView GetView() const;
+    };
+
+    // Device built acceleration structures only get their arrays reserved by the upload.
+    // The spheres of dynamic scenes orbit around the vertical axis, see LightBvh::Build.
+    EncodedScene Encode(const World& world, SceneEncoding encoding, SceneAcceleration acceleration, bool dynamic);
+
+    // Bytes per sphere of the geometry and material index arrays, including the chunk table share
+    float GetBytesPerSphere(SceneEncoding encoding);
+
+    // Spheres a field generates on average
+    uint64_t GetExpectedSpheresCount(const Gpu::SphereField& field);
+
+    // Memory the scene takes with the legacy 32 byte sphere records vs the chosen encoding, and projected to 1M spheres
+    void PrintStats(std::ostream& os, const EncodedSceneView& scene);
+}
@@ -13,7 +13,8 @@ struct PushConstBlock
 	glm::vec2 translate;
 };
 
-void UIOverlay::Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkCommandPool pool, VkQueue queue, VkRenderPass renderPass)
+void UIOverlay::Init(DeviceMemoryAllocator& allocator, LinearArena& stagingArena, VkDevice logicalDevice,
+    VkCommandPool pool, VkQueue queue, VkRenderPass renderPass)
 {
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -41,18 +42,7 @@ void UIOverlay::Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, Vk
     imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    VK_CHECK_RESULT(
-        vkCreateImage(logicalDevice, &imageCreateInfo, nullptr, &m_fontImage));
-    VkMemoryRequirements memReqs;
-    vkGetImageMemoryRequirements(logicalDevice, m_fontImage, &memReqs);
-    VkMemoryAllocateInfo memAllocInfo{};
-    memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memAllocInfo.allocationSize = memReqs.size;
-    memAllocInfo.memoryTypeIndex = VulkanUtils::GetDeviceMemoryTypeIndex(
-        physicalDevice, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memAllocInfo, nullptr, &m_fontMemory));
-    VK_CHECK_RESULT(vkBindImageMemory(logicalDevice, m_fontImage, m_fontMemory, 0));
+    m_fontImage = allocator.CreateImage(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_fontAllocation);
 
     // Image view
     VkImageViewCreateInfo viewInfo{};
@@ -68,15 +58,14 @@ void UIOverlay::Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, Vk
 
     VkDeviceSize uploadSize = texWidth * texHeight * 4 * sizeof(char); // 4 for rgba format
 
-	// Staging buffers for font data upload
-	VkDeviceMemory stagingBufferMemory;
-    VkBuffer stagingBuffer = VulkanUtils::CreateBuffer(physicalDevice, logicalDevice, uploadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBufferMemory);
+	// Font data is staged through the arena, 4 bytes alignment is enough for a buffer to image copy of rgba8
+	LinearArena::Allocation staging = stagingArena.Allocate(uploadSize, 4);
+	if (staging.buffer == VK_NULL_HANDLE)
+	{
+		VulkanUtils::FatalExit("Staging arena is too small for the UI font!", -1);
+	}
 
-	void* data;
-    vkMapMemory(logicalDevice, stagingBufferMemory, 0, uploadSize, 0, &data);
-    memcpy(data, fontData, uploadSize);
-	vkUnmapMemory(logicalDevice, stagingBufferMemory);
+    memcpy(staging.mapped, fontData, uploadSize);
 
 	// Copy buffer data to font image
 	VkCommandBuffer copyCommandBuffer = VulkanUtils::CreateCommandeBuffer(logicalDevice, pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
@@ -94,13 +83,14 @@ void UIOverlay::Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, Vk
 
 	// Copy
 	VkBufferImageCopy bufferCopyRegion{};
+	bufferCopyRegion.bufferOffset = staging.offset;
 	bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	bufferCopyRegion.imageSubresource.layerCount = 1;
 	bufferCopyRegion.imageExtent.width = texWidth;
 	bufferCopyRegion.imageExtent.height = texHeight;
 	bufferCopyRegion.imageExtent.depth = 1;
 
-	vkCmdCopyBufferToImage(copyCommandBuffer, stagingBuffer, m_fontImage,
+	vkCmdCopyBufferToImage(copyCommandBuffer, staging.buffer, m_fontImage,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
 
 	// Prepare for shader read
@@ -131,8 +121,7 @@ void UIOverlay::Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, Vk
 	
 	vkFreeCommandBuffers(logicalDevice, pool, 1, &copyCommandBuffer);
 
-	vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);	
-	vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+	stagingArena.Reset();
 
 	// Font texture Sampler
 	VkSamplerCreateInfo samplerInfo{};
@@ -353,32 +342,25 @@ void UIOverlay::Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, Vk
 
 }
 
-void UIOverlay::Deinit(VkDevice logicalDevice)
+void UIOverlay::Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice)
 {
 	vkDestroySampler(logicalDevice, m_sampler, nullptr);
 	vkDestroyDescriptorSetLayout(logicalDevice, m_descriptorSetLayout, nullptr);
 	vkDestroyDescriptorPool(logicalDevice, m_descriptorPool, nullptr);
 
 	vkDestroyImageView(logicalDevice, m_fontView, nullptr);
-	vkDestroyImage(logicalDevice, m_fontImage, nullptr);
-	vkFreeMemory(logicalDevice, m_fontMemory, nullptr);
+	allocator.DestroyImage(m_fontImage, m_fontAllocation);
 
 	vkDestroyPipelineLayout(logicalDevice, m_pipelineLayout, nullptr);
 	vkDestroyPipeline(logicalDevice, m_pipeline, nullptr);
 
-	vkFreeMemory(logicalDevice, m_vertexBufferMemory, nullptr);
-	vkDestroyBuffer(logicalDevice, m_vertexBuffer, nullptr);
-
-	vkFreeMemory(logicalDevice, m_indexBufferMemory, nullptr);
-	vkDestroyBuffer(logicalDevice, m_indexBuffer, nullptr);
-
     if (ImGui::GetCurrentContext())
     {
 	    ImGui::DestroyContext();
     }
 }
 
-void UIOverlay::Update(VkPhysicalDevice physicalDevice, VkDevice logicalDevice)
+void UIOverlay::Update(UploadRingBuffer& uploadRing)
 {
 	ImGuiIO& io = ImGui::GetIO();
 	io.DisplaySize = ImVec2(800.0f, 600.0f);
@@ -398,53 +380,22 @@ void UIOverlay::Update(VkPhysicalDevice physicalDevice, VkDevice logicalDevice)
 
 	if (!imDrawData) { return; };
 
-	// Note: Alignment is done inside buffer creation
 	VkDeviceSize vertexBufferSize = imDrawData->TotalVtxCount * sizeof(ImDrawVert);
 	VkDeviceSize indexBufferSize = imDrawData->TotalIdxCount * sizeof(ImDrawIdx);
 
-	// Update buffers only if vertex or index count has been changed compared to current buffer size
+	m_vertexData = UploadRingBuffer::Allocation();
+	m_indexData = UploadRingBuffer::Allocation();
+
 	if ((vertexBufferSize == 0) || (indexBufferSize == 0)) {
 		return;
 	}
 
-	// Vertex buffer
-	if ((m_vertexBuffer == VK_NULL_HANDLE) || (m_verticesCount != imDrawData->TotalVtxCount)) 
-	{
-		if (m_vertexBuffer != VK_NULL_HANDLE)
-		{
-			vkUnmapMemory(logicalDevice, m_vertexBufferMemory);
-			vkFreeMemory(logicalDevice, m_vertexBufferMemory, nullptr);
-			vkDestroyBuffer(logicalDevice, m_vertexBuffer, nullptr);
-		}
-	
-		m_vertexBuffer = VulkanUtils::CreateBuffer(physicalDevice, logicalDevice, vertexBufferSize,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_vertexBufferMemory);
-
-		m_verticesCount = imDrawData->TotalVtxCount;
-		
-		VK_CHECK_RESULT(vkMapMemory(logicalDevice, m_vertexBufferMemory, 0, VK_WHOLE_SIZE, 0, &m_mappedVertexData));
-	}
-
-	if ((m_indexBuffer == VK_NULL_HANDLE) || (m_indicesCount < imDrawData->TotalIdxCount))
-	{
-		if (m_indexBuffer != VK_NULL_HANDLE)
-		{
-			vkUnmapMemory(logicalDevice, m_indexBufferMemory);
-			vkFreeMemory(logicalDevice, m_indexBufferMemory, nullptr);
-			vkDestroyBuffer(logicalDevice, m_indexBuffer, nullptr);
-		}
-
-		m_indexBuffer = VulkanUtils::CreateBuffer(physicalDevice, logicalDevice, indexBufferSize,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_indexBufferMemory);
-
-		m_indicesCount = imDrawData->TotalIdxCount;
-
-		VK_CHECK_RESULT(vkMapMemory(logicalDevice, m_indexBufferMemory, 0, VK_WHOLE_SIZE, 0, &m_mappedIndexData));
-	}
+	// Geometry is rebuilt every frame, it lives in the frame's region of the upload ring
+	m_vertexData = uploadRing.Allocate(vertexBufferSize, sizeof(ImDrawVert));
+	m_indexData = uploadRing.Allocate(indexBufferSize, sizeof(ImDrawIdx));
 
-	// Upload data
-	ImDrawVert* vtxDst = (ImDrawVert*)m_mappedVertexData;
-	ImDrawIdx* idxDst = (ImDrawIdx*)m_mappedIndexData;
+	ImDrawVert* vtxDst = (ImDrawVert*)m_vertexData.mapped;
+	ImDrawIdx* idxDst = (ImDrawIdx*)m_indexData.mapped;
 
 	for (int n = 0; n < imDrawData->CmdListsCount; n++) 
 	{
@@ -454,25 +405,6 @@ void UIOverlay::Update(VkPhysicalDevice physicalDevice, VkDevice logicalDevice)
 		vtxDst += cmd_list->VtxBuffer.Size;
 		idxDst += cmd_list->IdxBuffer.Size;
 	}
-
-	// Flush to make writes visible to GPU
-	{
-		VkMappedMemoryRange mappedRange{};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = m_vertexBufferMemory;
-		mappedRange.offset = 0;
-		mappedRange.size = VK_WHOLE_SIZE;
-		VK_CHECK_RESULT(vkFlushMappedMemoryRanges(logicalDevice, 1, &mappedRange));
-	}
-
-	{
-		VkMappedMemoryRange mappedRange{};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = m_indexBufferMemory;
-		mappedRange.offset = 0;
-		mappedRange.size = VK_WHOLE_SIZE;
-		VK_CHECK_RESULT(vkFlushMappedMemoryRanges(logicalDevice, 1, &mappedRange));
-	}
 }
 
 void UIOverlay::Draw(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkCommandBuffer commandBuffer)
@@ -481,7 +413,7 @@ void UIOverlay::Draw(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, Vk
 	int32_t vertexOffset = 0;
 	int32_t indexOffset = 0;
 
-	if ((!imDrawData) || (imDrawData->CmdListsCount == 0)) {
+	if ((!imDrawData) || (imDrawData->CmdListsCount == 0) || (m_vertexData.buffer == VK_NULL_HANDLE)) {
 		return;
 	}
 
@@ -495,9 +427,8 @@ void UIOverlay::Draw(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, Vk
 	pushConstBlock.translate = glm::vec2(-1.0f);
 	vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstBlock), &pushConstBlock);
 
-	VkDeviceSize offsets[1] = { 0 };
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexData.buffer, &m_vertexData.offset);
+	vkCmdBindIndexBuffer(commandBuffer, m_indexData.buffer, m_indexData.offset, VK_INDEX_TYPE_UINT16);
 
 	for (int32_t i = 0; i < imDrawData->CmdListsCount; i++)
 	{
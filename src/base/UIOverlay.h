@@ -2,13 +2,18 @@
 
 #include <vulkan/vulkan.h>
 
+#include "DeviceMemoryAllocator.h"
+#include "UploadRingBuffer.h"
+
 class UIOverlay
 {
 public:
-    void Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkCommandPool pool, VkQueue queue, VkRenderPass renderPass);
-    void Deinit(VkDevice logicalDevice);
+    void Init(DeviceMemoryAllocator& allocator, LinearArena& stagingArena, VkDevice logicalDevice,
+        VkCommandPool pool, VkQueue queue, VkRenderPass renderPass);
+    void Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice);
 
-    void Update(VkPhysicalDevice physicalDevice, VkDevice logicalDevice);
+    // Geometry of the frame is written to the upload ring, BeginFrame must have been called on it
+    void Update(UploadRingBuffer& uploadRing);
     void Draw(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkCommandBuffer commandBuffer);
     
 private:
@@ -20,22 +25,12 @@ private:
 	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
 	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
 
-    VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_vertexBufferMemory = VK_NULL_HANDLE;
-
-    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_indexBufferMemory = VK_NULL_HANDLE;
+    UploadRingBuffer::Allocation m_vertexData;
+    UploadRingBuffer::Allocation m_indexData;
 
     VkImage m_fontImage = VK_NULL_HANDLE;
     VkImageView m_fontView = VK_NULL_HANDLE;
-    VkDeviceMemory m_fontMemory = VK_NULL_HANDLE;
+    DeviceAllocation m_fontAllocation;
 
     VkSampler m_sampler = VK_NULL_HANDLE;
-
-
-	void* m_mappedVertexData = nullptr;
-	void* m_mappedIndexData = nullptr;
-
-    int m_verticesCount = -1;
-    int m_indicesCount = -1;
 };
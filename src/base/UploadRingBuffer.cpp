@@ -0,0 +1,51 @@
+#include "UploadRingBuffer.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+
+void UploadRingBuffer::Init(DeviceMemoryAllocator& allocator, VkDeviceSize frameCapacity, uint32_t framesCount,
+    VkDeviceSize minAlignment)
+{
+    m_minAlignment = std::max<VkDeviceSize>(minAlignment, 1);
+    // Keeps the frame regions aligned as well
+    m_frameCapacity = (frameCapacity + m_minAlignment - 1) / m_minAlignment * m_minAlignment;
+
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+    m_buffer = allocator.CreateBuffer(m_frameCapacity * framesCount, usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_allocation);
+
+    m_frameBegin = 0;
+    m_head = 0;
+}
+
+void UploadRingBuffer::Deinit(DeviceMemoryAllocator& allocator)
+{
+    allocator.DestroyBuffer(m_buffer, m_allocation);
+}
+
+void UploadRingBuffer::BeginFrame(uint32_t frameIdx)
+{
+    m_frameBegin = frameIdx * m_frameCapacity;
+    m_head = m_frameBegin;
+}
+
+UploadRingBuffer::Allocation UploadRingBuffer::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    alignment = std::max(alignment, m_minAlignment);
+    const VkDeviceSize offset = (m_head + alignment - 1) / alignment * alignment;
+
+    if (offset + size > m_frameBegin + m_frameCapacity)
+    {
+        VulkanUtils::FatalExit("Upload ring buffer frame region is exhausted!", -1);
+    }
+
+    m_head = offset + size;
+
+    Allocation allocation;
+    allocation.buffer = m_buffer;
+    allocation.offset = offset;
+    allocation.mapped = static_cast<char*>(m_allocation.mapped) + offset;
+    return allocation;
+}
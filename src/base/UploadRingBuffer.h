@@ -0,0 +1,40 @@
+#pragma once
+
+#include "DeviceMemoryAllocator.h"
+
+#include <vector>
+
+// One persistently mapped buffer split into a region per frame in flight. Per frame data (constants,
+// UI geometry, ...) is bump allocated from the region of the current frame and bound with an offset
+// (dynamic offset for uniform buffers), so nothing is created, mapped or flushed on the hot path.
+class UploadRingBuffer
+{
+public:
+    struct Allocation
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void* mapped = nullptr;
+    };
+
+    // minAlignment is applied to every allocation, pass the device's uniform/storage buffer offset alignment
+    void Init(DeviceMemoryAllocator& allocator, VkDeviceSize frameCapacity, uint32_t framesCount, VkDeviceSize minAlignment);
+    void Deinit(DeviceMemoryAllocator& allocator);
+
+    // Rewinds the region of the frame, the GPU must be done with what was allocated from it the last time
+    void BeginFrame(uint32_t frameIdx);
+
+    Allocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+
+    VkBuffer GetBuffer() const { return m_buffer; }
+
+private:
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    DeviceAllocation m_allocation;
+
+    VkDeviceSize m_frameCapacity = 0;
+    VkDeviceSize m_minAlignment = 1;
+
+    VkDeviceSize m_frameBegin = 0;
+    VkDeviceSize m_head = 0;
+};
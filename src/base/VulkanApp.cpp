@@ -3,6 +3,7 @@
 #include "VulkanUtils.h"
 #include "VulkanDebugUtils.h"
 #include "World.h"
+#include "SceneCache.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/rotate_vector.hpp>
@@ -96,17 +97,31 @@ VulkanAppBase::VulkanAppBase(World& world, const std::string& appName)
 
 VulkanAppBase::~VulkanAppBase()
 {
-	m_uiOverlay.Deinit(m_vkDevice);
+	m_uiOverlay.Deinit(m_memoryAllocator, m_vkDevice);
+	m_gpuProfiler.Deinit(m_vkDevice);
 
 	CleanupSwapChain(m_swapChain);
 
-	vkDestroyBuffer(m_vkDevice, m_computeSSOBuffer, nullptr);
-	vkFreeMemory(m_vkDevice, m_computeSSOBufferMemory, nullptr);
+	m_lbvhBuilder.Deinit(m_memoryAllocator, m_vkDevice);
+	m_gridBuilder.Deinit(m_memoryAllocator, m_vkDevice);
+	m_restir.resampler.Deinit(m_memoryAllocator, m_vkDevice);
+	m_radianceCache.cache.Deinit(m_memoryAllocator, m_vkDevice);
+	m_pathGuiding.guiding.Deinit(m_memoryAllocator, m_vkDevice);
+	m_lightSplats.Deinit(m_memoryAllocator, m_vkDevice);
+	m_wavefront.tracer.Deinit(m_memoryAllocator, m_vkDevice);
+	m_persistentThreads.counters.Release(m_memoryAllocator);
+	m_gpuScene.Deinit(m_memoryAllocator);
+	m_stagingArena.Deinit(m_memoryAllocator);
+
+	vkDestroyPipelineLayout(m_vkDevice, m_dynamicScene.pipelineLayout, nullptr);
+	vkDestroyPipeline(m_vkDevice, m_dynamicScene.pipeline, nullptr);
 
 	vkDestroyImageView(m_vkDevice, m_computeTargetTexture.descriptor.imageView, nullptr);
 	vkDestroySampler(m_vkDevice, m_computeTargetTexture.descriptor.sampler, nullptr);
-	vkDestroyImage(m_vkDevice, m_computeTargetTexture.image, nullptr);
-	vkFreeMemory(m_vkDevice, m_computeTargetTexture.memory, nullptr);
+	m_memoryAllocator.DestroyImage(m_computeTargetTexture.image, m_computeTargetTexture.allocation);
+
+	vkDestroyImageView(m_vkDevice, m_accumulationTexture.descriptor.imageView, nullptr);
+	m_memoryAllocator.DestroyImage(m_accumulationTexture.image, m_accumulationTexture.allocation);
 
 	vkDestroyPipelineLayout(m_vkDevice, m_computePipelineLayout, nullptr);
 	vkDestroyPipeline(m_vkDevice, m_computePipeline, nullptr);
@@ -123,11 +138,11 @@ VulkanAppBase::~VulkanAppBase()
 		vkDestroySemaphore(m_vkDevice, m_computeFinishedSemaphores[i], nullptr);
 		vkDestroyFence(m_vkDevice, m_graphicsInFlightFences[i], nullptr);
 		vkDestroyFence(m_vkDevice, m_computeInFlightFences[i], nullptr);
-
-		vkDestroyBuffer(m_vkDevice, m_computeUBO.vkBuffers[i], nullptr);
-		vkFreeMemory(m_vkDevice, m_computeUBO.vkBuffersMemory[i], nullptr);
 	}
 
+	m_uploadRing.Deinit(m_memoryAllocator);
+	m_memoryAllocator.Deinit();
+
 	vkDestroyRenderPass(m_vkDevice, m_renderPass, nullptr);
 
 	vkDestroySurfaceKHR(m_vkInstance, m_surface, nullptr);
@@ -181,6 +196,25 @@ void VulkanAppBase::RegisterCommandLineOptions(CommandLineOptions& options) cons
     options.Add("height", { "-h", "--height" }, true, "Set window height");
 	options.Add("gpuidx", { "-g", "--gpu" }, 1, "Select GPU to run on");
 	options.Add("gpulist", { "-gl", "--listgpus" }, 0, "Display a list of available Vulkan devices");
+	options.Add("autotune", { "-at", "--autotune" }, false, "Benchmark compute dispatch configurations even if a cached result exists");
+	options.Add("tileorder", { "-to", "--tile-order" }, true, "Order of the tiles of the trace, the autotuner picks the strip width or block side: rowmajor, strips, morton or hilbert");
+	options.Add("progressive", { "-p", "--progressive" }, false, "Accumulate samples over frames, tracing the image in time-sliced tile batches");
+	options.Add("spp", { "-spp", "--spp" }, true, "Samples per pixel traced by a pass");
+	options.Add("depth", { "-d", "--depth" }, true, "Maximum ray depth");
+	options.Add("framebudget", { "-fb", "--frame-budget" }, true, "GPU time budget of a progressive frame in milliseconds");
+	options.Add("quantize", { "-q", "--quantize" }, false, "Store sphere positions as 16 bit values and materials as half floats, for very large scenes");
+	options.Add("scenecache", { "-sc", "--scene-cache" }, false, "Save the encoded scene and its acceleration structure to a file, and load it from there while the scene is unchanged");
+	options.Add("environment", { "-env", "--environment" }, true, "Equirectangular Radiance .hdr environment map lighting the scene, overrides the scene's");
+	options.Add("accel", { "-a", "--accel" }, true, "Acceleration structure, overrides the scene's: linear, lbvh or grid (built on the GPU), wbvh (built on the CPU)");
+	options.Add("integrator", { "-i", "--integrator" }, true, "Light transport, overrides the scene's: path, or bdpt (bidirectional, for caustics through dielectrics, pinhole camera)");
+	options.Add("dynamic", { "-dyn", "--dynamic" }, false, "Move every sphere each frame and rebuild the acceleration structure, packed scenes only, not with --progressive");
+	options.Add("restir", { "-rs", "--restir" }, false, "Resample the direct light of the emissive spheres over neighbouring pixels and frames (ReSTIR), not with --progressive");
+	options.Add("radiancecache", { "-rc", "--radiance-cache" }, false, "End paths on a world space cache of the light leaving rough surfaces, learned from the paths of the previous frames");
+	options.Add("guiding", { "-pg", "--path-guiding" }, false, "Sample the bounces off rough surfaces from distributions of their incident light, learned from the paths of the previous frames");
+	options.Add("wavefront", { "-wf", "--wavefront" }, false, "Trace the paths of the path integrator a bounce at a time for all the pixels, through a buffer of path states");
+	options.Add("wavefrontsort", { "-wfs", "--wavefront-sort" }, true, "Wavefront mode, sorting the rays by origin and direction before every bounce from the given one on (1: all but the camera rays)");
+	options.Add("persistent", { "-pt", "--persistent-threads" }, true, "Trace with the given number of persistent workgroups pulling pixels from a queue, starting a new path as soon as one ends (see --persistent-benchmark)");
+	RegisterBenchmarkOptions(options);
 }
 
 static void SetupDPIAwareness()
@@ -208,7 +242,7 @@ bool VulkanAppBase::CreateVulkanInstance(bool enableValidation)
 	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 	appInfo.pApplicationName = m_appName.c_str();
 	appInfo.pEngineName = "RT";
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = VK_API_VERSION_1_2;
 
 	std::vector<const char*> requiredExtensions = { VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_WIN32_SURFACE_EXTENSION_NAME };
 	std::vector<std::string> supportedExtensions;
@@ -349,11 +383,46 @@ static SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device, Vk
 	return details;
 }
 
+// The scene is reached through buffer device addresses and GPU structs use the scalar block layout,
+// both are core since Vulkan 1.2. The trace counts and feeds the lanes of its subgroups with ballots.
+static bool CheckDeviceFeatureSupport(VkPhysicalDevice device)
+{
+	VkPhysicalDeviceVulkan11Properties vulkan11Properties{};
+	vulkan11Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 deviceProperties{};
+	deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties.pNext = &vulkan11Properties;
+	vkGetPhysicalDeviceProperties2(device, &deviceProperties);
+	if (deviceProperties.properties.apiVersion < VK_API_VERSION_1_2)
+	{
+		return false;
+	}
+
+	const VkSubgroupFeatureFlags subgroupOperations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT;
+	if ((vulkan11Properties.subgroupSupportedStages & VK_SHADER_STAGE_COMPUTE_BIT) == 0 ||
+		(vulkan11Properties.subgroupSupportedOperations & subgroupOperations) != subgroupOperations)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 deviceFeatures{};
+	deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	deviceFeatures.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(device, &deviceFeatures);
+
+	return vulkan12Features.bufferDeviceAddress == VK_TRUE && vulkan12Features.scalarBlockLayout == VK_TRUE;
+}
+
 static bool IsDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
 {
 	QueueFamilyIndices indices = FindQueueFamilies(device, surface);
 
     bool extensionsSupported = CheckDeviceExtensionSupport(device);
+	bool featuresSupported = CheckDeviceFeatureSupport(device);
 
 	bool swapChainAdequate = false;
 	if (extensionsSupported)
@@ -362,7 +431,7 @@ static bool IsDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
 		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 	}
 
-	return indices.AreComplete() && extensionsSupported && swapChainAdequate;
+	return indices.AreComplete() && extensionsSupported && featuresSupported && swapChainAdequate;
 }
 
 bool VulkanAppBase::CreateVulkanLogicalDevice(bool enableValidationLayers)
@@ -384,8 +453,14 @@ bool VulkanAppBase::CreateVulkanLogicalDevice(bool enableValidationLayers)
 
 	VkPhysicalDeviceFeatures deviceFeatures{};
 
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.bufferDeviceAddress = VK_TRUE;
+	vulkan12Features.scalarBlockLayout = VK_TRUE;
+
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &vulkan12Features;
 
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -1019,10 +1094,9 @@ void VulkanAppBase::CreateDescriptorPool()
 {	
 	std::vector<VkDescriptorPoolSize> poolSizes =
 	{
-		// vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),			// Compute UBO
-		// vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1),	// Graphics image samplers
-		// vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1),			// Storage image for ray traced image output
-		// vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1),			// Storage buffer for the scene primitives
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },	// Compute UBO, lives in the upload ring
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 },	// Graphics image samplers
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 },			// Storage images for ray traced image output and accumulation
 	};
 
 	VkDescriptorPoolCreateInfo descriptorPoolInfo{};
@@ -1063,23 +1137,25 @@ void VulkanAppBase::CreateComputeShaderRenderTarget()
 	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
 	imageCreateInfo.flags = 0;
 
-	VkImage image;
-	VK_CHECK_RESULT(vkCreateImage(m_vkDevice, &imageCreateInfo, nullptr, &image));
+	VkImage image = m_memoryAllocator.CreateImage(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_computeTargetTexture.allocation);
 
 	m_computeTargetTexture.image = image;
 
-	VkMemoryRequirements memReqs;
-	vkGetImageMemoryRequirements(m_vkDevice, image, &memReqs);
-	VkMemoryAllocateInfo memAllocInfo{};
-	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = VulkanUtils::GetDeviceMemoryTypeIndex(m_vkPhysicalDevice, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	// Accumulation keeps full precision, it's only accessed by the compute shader. The shaders only touch it when
+	// passes are accumulated, binding 2 gets a single pixel otherwise.
+	const VkFormat accumulationFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+	vkGetPhysicalDeviceFormatProperties(m_vkPhysicalDevice, accumulationFormat, &formatProperties);
+	assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
 
-	VkDeviceMemory deviceMemory;
-	VK_CHECK_RESULT(vkAllocateMemory(m_vkDevice, &memAllocInfo, nullptr, &deviceMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(m_vkDevice, image, deviceMemory, 0));
+	const bool accumulate = m_progressive.enabled || m_integrator == Integrator::Bidirectional;
+	const uint32_t accumulationDim = accumulate ? imageDim : 1;
+	imageCreateInfo.format = accumulationFormat;
+	imageCreateInfo.extent = { accumulationDim, accumulationDim, 1 };
+	imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT;
 
-	m_computeTargetTexture.memory = deviceMemory;
+	m_accumulationTexture.image = m_memoryAllocator.CreateImage(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_accumulationTexture.allocation);
 
 	VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
 	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1101,19 +1177,23 @@ void VulkanAppBase::CreateComputeShaderRenderTarget()
 	subresourceRange.levelCount = 1;
 	subresourceRange.layerCount = 1;
 
-	// Create an image barrier object
-	VkImageMemoryBarrier imageMemoryBarrier{};
-	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
-	imageMemoryBarrier.image = image;
-	imageMemoryBarrier.subresourceRange = subresourceRange;
+	// Create image barrier objects, both images stay in the general layout
+	std::array<VkImageMemoryBarrier, 2> imageMemoryBarriers{};
+	for (VkImageMemoryBarrier& imageMemoryBarrier : imageMemoryBarriers)
+	{
+		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		imageMemoryBarrier.subresourceRange = subresourceRange;
+	}
+	imageMemoryBarriers[0].image = image;
+	imageMemoryBarriers[1].image = m_accumulationTexture.image;
 
 	// Put barrier inside setup command buffer
 	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-		0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+		0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageMemoryBarriers.size()), imageMemoryBarriers.data());
 
 	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
 
@@ -1168,87 +1248,117 @@ void VulkanAppBase::CreateComputeShaderRenderTarget()
 	m_computeTargetTexture.descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 	m_computeTargetTexture.descriptor.imageView = imageView;
 	m_computeTargetTexture.descriptor.sampler = sampler;
+
+	imageViewCreateInfo.format = accumulationFormat;
+	imageViewCreateInfo.image = m_accumulationTexture.image;
+	VK_CHECK_RESULT(vkCreateImageView(m_vkDevice, &imageViewCreateInfo, nullptr, &imageView));
+
+	m_accumulationTexture.descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	m_accumulationTexture.descriptor.imageView = imageView;
+	m_accumulationTexture.descriptor.sampler = VK_NULL_HANDLE;
 }
 
-void VulkanAppBase::CreateComputeShaderUBO()
+void VulkanAppBase::CreateUploadRingBuffer()
 {
-	m_computeUBO.vkBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	m_computeUBO.vkBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+	const VkPhysicalDeviceLimits& limits = m_deviceProperties.limits;
+	m_uploadRing.Init(m_memoryAllocator, uploadRingFrameCapacity, MAX_FRAMES_IN_FLIGHT,
+		std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment));
+}
 
-	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+void VulkanAppBase::CreateGpuScene()
+{
+	// A cached scene is uploaded straight from the file mapping
+	SceneCache::MappedScene cachedScene;
+	SceneEncoder::EncodedScene encodedScene;
+	SceneEncoder::EncodedSceneView sceneView;
+
+	const uint64_t sceneHash = m_sceneCacheEnabled ? SceneCache::HashScene(m_world, m_sceneEncoding, m_sceneAcceleration, m_dynamicScene.enabled) : 0;
+	const std::string cacheFileName = SceneCache::GetFileName(sceneHash);
+	if (m_sceneCacheEnabled && cachedScene.Open(cacheFileName, sceneHash))
 	{
-		VkBufferCreateInfo bufferCreateInfo{};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		bufferCreateInfo.size = sizeof(m_computeUBO.ubo);
+		std::cout << "Scene loaded from " << cacheFileName << "\n";
+		sceneView = cachedScene.GetView();
+	}
+	else
+	{
+		encodedScene = SceneEncoder::Encode(m_world, m_sceneEncoding, m_sceneAcceleration, m_dynamicScene.enabled);
+		sceneView = encodedScene.GetView();
 
-		VK_CHECK_RESULT(vkCreateBuffer(m_vkDevice, &bufferCreateInfo, nullptr, &m_computeUBO.vkBuffers[i]));
+		if (encodedScene.acceleration == SceneAcceleration::WideBvh)
+		{
+			WideBvh::PrintStats(std::cout, encodedScene.wideBvh, m_world);
+		}
 
-		// Create the memory backing up the buffer handle
-		VkMemoryRequirements memReqs;
-		vkGetBufferMemoryRequirements(m_vkDevice, m_computeUBO.vkBuffers[i], &memReqs);
+		LightBvh::PrintStats(std::cout, encodedScene.lightBvh, m_world);
 
-		VkMemoryAllocateInfo memAllocInfo{};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memAllocInfo.allocationSize = memReqs.size;
-		// Find a memory type index that fits the properties of the buffer
-		memAllocInfo.memoryTypeIndex = VulkanUtils::GetDeviceMemoryTypeIndex(
-			m_vkPhysicalDevice, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (m_sceneCacheEnabled && !SceneCache::Store(cacheFileName, sceneHash, sceneView))
+		{
+			std::cout << "Failed to write the scene cache " << cacheFileName << "\n";
+		}
+	}
 
-		VK_CHECK_RESULT(vkAllocateMemory(m_vkDevice, &memAllocInfo, nullptr, &m_computeUBO.vkBuffersMemory[i]));
+	SceneEncoder::PrintStats(std::cout, sceneView);
 
-		// Attach the memory to the buffer object
-		VK_CHECK_RESULT(vkBindBufferMemory(m_vkDevice, m_computeUBO.vkBuffers[i], m_computeUBO.vkBuffersMemory[i], 0));
-	}
+	m_gpuScene.Upload(m_memoryAllocator, m_stagingArena, m_graphicsQueue, m_commandPool, sceneView, m_environment);
+	m_lbvhBuilder.Reserve(m_memoryAllocator, sceneView.spheresCount);
+	m_gridBuilder.Reserve(m_memoryAllocator, sceneView.spheresCount);
+	BuildSceneAcceleration();
 }
 
-void VulkanAppBase::CreateComputeShaderSSBO()
+void VulkanAppBase::BuildSceneAcceleration()
 {
-	VkDeviceSize bufferSize = std::max<VkDeviceSize>(1u,
-		m_world.spheres.size() * sizeof(Sphere) + 
-		m_world.materialManager.lambertianMaterials.size() * sizeof(LambertianMaterialProperties) +
-		m_world.materialManager.metalMaterials.size() * sizeof(MetalMaterialProperties) + 
-		m_world.materialManager.dielectricMaterials.size() * sizeof(DielectricMaterialProperties));
+	if (m_gpuScene.GetAcceleration() == SceneAcceleration::Linear)
+	{
+		return;
+	}
 
-	// Create a staging buffer used to upload data to the gpu
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	stagingBuffer = VulkanUtils::CreateBuffer(m_vkPhysicalDevice, m_vkDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBufferMemory);
+	VkCommandBuffer commandBuffer = VulkanUtils::CreateCommandeBuffer(m_vkDevice, m_commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
-	if (!m_world.spheres.empty())
-	{
-		void* data;
-		vkMapMemory(m_vkDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
-		const size_t spheresSize = m_world.spheres.size() * sizeof(Sphere);
-		memcpy(data, m_world.spheres.data(), spheresSize);
+	RecordAccelerationBuild(commandBuffer);
 
-		const size_t lambertianMaterialsSize = m_world.materialManager.lambertianMaterials.size() * sizeof(LambertianMaterialProperties);
-		memcpy((char*)data + spheresSize,
-			m_world.materialManager.lambertianMaterials.data(),
-			lambertianMaterialsSize);
+	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
 
-		const size_t metalMaterialsSize = m_world.materialManager.metalMaterials.size() * sizeof(MetalMaterialProperties);
-		memcpy((char*)data + spheresSize + lambertianMaterialsSize,
-			m_world.materialManager.metalMaterials.data(),
-			metalMaterialsSize);
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	VK_CHECK_RESULT(vkQueueSubmit(m_computeQueue, 1, &submitInfo, VK_NULL_HANDLE));
+	VK_CHECK_RESULT(vkQueueWaitIdle(m_computeQueue));
 
-		const size_t dielectricMaterialsSize = m_world.materialManager.dielectricMaterials.size() * sizeof(DielectricMaterialProperties);
-		memcpy((char*)data + spheresSize + lambertianMaterialsSize + metalMaterialsSize,
-			m_world.materialManager.dielectricMaterials.data(),
-			dielectricMaterialsSize);
+	vkFreeCommandBuffers(m_vkDevice, m_commandPool, 1, &commandBuffer);
+}
 
-		vkUnmapMemory(m_vkDevice, stagingBufferMemory);
+void VulkanAppBase::CreateSceneAnimationPipeline()
+{
+	if (!m_dynamicScene.enabled)
+	{
+		return;
 	}
 
-	m_computeSSOBuffer = VulkanUtils::CreateBuffer(m_vkPhysicalDevice, m_vkDevice, bufferSize,
-		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_computeSSOBufferMemory);
-	VulkanUtils::CopyBuffer(m_vkDevice, m_graphicsQueue, m_commandPool, stagingBuffer, m_computeSSOBuffer, bufferSize);
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.size = sizeof(Gpu::AnimationPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+	VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCreateInfo, nullptr, &m_dynamicScene.pipelineLayout));
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo{};
+	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineCreateInfo.layout = m_dynamicScene.pipelineLayout;
+	computePipelineCreateInfo.stage =
+		VulkanUtils::CreateShaderStage(m_vkDevice, VulkanUtils::GetShadersPath() + "animate_spheres.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+
+	VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &m_dynamicScene.pipeline));
 
-	vkDestroyBuffer(m_vkDevice, stagingBuffer, nullptr);
-	vkFreeMemory(m_vkDevice, stagingBufferMemory, nullptr);
+	VulkanUtils::DestroyShaderStage(m_vkDevice, computePipelineCreateInfo.stage);
 }
 
 void VulkanAppBase::CreateGraphicsPipeline()
@@ -1405,45 +1515,26 @@ void VulkanAppBase::CreateComputePipeline()
 	storageImageBinding.binding = 0;
 	storageImageBinding.descriptorCount = 1;
 
-	// Binding 1: Uniform buffer block
+	// Binding 1: Uniform buffer block, the offset of the frame's copy in the upload ring is given at bind time
 	VkDescriptorSetLayoutBinding uboBinding{};
-	uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	uboBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 	uboBinding.binding = 1;
 	uboBinding.descriptorCount = 1;
 
-	VkDescriptorSetLayoutBinding spheresBinding{};
-	spheresBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	spheresBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-	spheresBinding.binding = 2;
-	spheresBinding.descriptorCount = 1;
-
-	VkDescriptorSetLayoutBinding lambertMaterialsBinding{};
-	lambertMaterialsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	lambertMaterialsBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-	lambertMaterialsBinding.binding = 3;
-	lambertMaterialsBinding.descriptorCount = 1;
-
-	VkDescriptorSetLayoutBinding metalMaterialsBinding{};
-	metalMaterialsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	metalMaterialsBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-	metalMaterialsBinding.binding = 4;
-	metalMaterialsBinding.descriptorCount = 1;
+	// Binding 2: Accumulation image
+	VkDescriptorSetLayoutBinding accumulationImageBinding{};
+	accumulationImageBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	accumulationImageBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	accumulationImageBinding.binding = 2;
+	accumulationImageBinding.descriptorCount = 1;
 
-	VkDescriptorSetLayoutBinding dielectricMaterialsBinding{};
-	dielectricMaterialsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	dielectricMaterialsBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-	dielectricMaterialsBinding.binding = 5;
-	dielectricMaterialsBinding.descriptorCount = 1;
-
-	std::array<VkDescriptorSetLayoutBinding, 6> setLayoutBindings
+	// The scene isn't bound, the shader follows the device addresses of the scene header
+	std::array<VkDescriptorSetLayoutBinding, 3> setLayoutBindings
 	{
 		storageImageBinding,
 		uboBinding,
-		spheresBinding,
-		lambertMaterialsBinding,
-		metalMaterialsBinding,
-		dielectricMaterialsBinding
+		accumulationImageBinding
 	};
 
 	VkDescriptorSetLayoutCreateInfo descriptorLayout{};
@@ -1459,18 +1550,16 @@ void VulkanAppBase::CreateComputePipeline()
 	pipelineLayoutCreateInfo.setLayoutCount = 1;
 	pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayout;
 
-	VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCreateInfo, nullptr, &m_computePipelineLayout));
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(Gpu::ComputePushConstants);
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
-	VkComputePipelineCreateInfo computePipelineCreateInfo{};
-	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-	computePipelineCreateInfo.layout = m_computePipelineLayout;
-	computePipelineCreateInfo.flags = 0;
-	computePipelineCreateInfo.stage =
-		VulkanUtils::CreateShaderStage(m_vkDevice, VulkanUtils::GetShadersPath() + "raytracing.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+	VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCreateInfo, nullptr, &m_computePipelineLayout));
 
-	VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &m_computePipeline));
-
-	VulkanUtils::DestroyShaderStage(m_vkDevice, computePipelineCreateInfo.stage);
+	m_computePipeline = CreateComputePipelineVariant(m_computeDispatchConfig);
 
 	VkDescriptorSetAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -1492,120 +1581,222 @@ void VulkanAppBase::CreateComputePipeline()
 
 	computeWriteDescriptorSets.push_back(outputStorageImage);
 
-	std::vector<VkDescriptorBufferInfo> uniformBufferInfos(MAX_FRAMES_IN_FLIGHT);
+	VkWriteDescriptorSet accumulationStorageImage{};
+	accumulationStorageImage.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	accumulationStorageImage.dstSet = m_computeDescriptorSet;
+	accumulationStorageImage.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	accumulationStorageImage.dstBinding = 2;
+	accumulationStorageImage.pImageInfo = &m_accumulationTexture.descriptor;
+	accumulationStorageImage.descriptorCount = 1;
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-	{
-    	uniformBufferInfos[i].buffer = m_computeUBO.vkBuffers[i];
-    	uniformBufferInfos[i].offset = 0;
-    	uniformBufferInfos[i].range = sizeof(ComputeUBO::UniformBuffer);
+	computeWriteDescriptorSets.push_back(accumulationStorageImage);
 
+	VkDescriptorBufferInfo uniformBufferInfo{};
+	uniformBufferInfo.buffer = m_uploadRing.GetBuffer();
+	uniformBufferInfo.offset = 0;
+	uniformBufferInfo.range = sizeof(Gpu::ComputeUniforms);
+
+	{
 		VkWriteDescriptorSet ubo{};
 		ubo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		ubo.dstSet = m_computeDescriptorSet;
-		ubo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		ubo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		ubo.dstBinding = 1;
-		ubo.pBufferInfo = &uniformBufferInfos[i];
+		ubo.pBufferInfo = &uniformBufferInfo;
 		ubo.descriptorCount = 1;
 
 		computeWriteDescriptorSets.push_back(ubo);
 	}
 
-	VkDeviceSize spheresSize = std::max<VkDeviceSize>(1, sizeof(Sphere) * m_world.spheres.size());
+	vkUpdateDescriptorSets(m_vkDevice,
+		static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, nullptr);
+
+	vkDestroyDescriptorSetLayout(m_vkDevice, descriptorSetLayout, nullptr);
+}
 
+VkPipeline VulkanAppBase::CreateComputePipelineVariant(const ComputeDispatchConfig& config)
+{
+	// Constant 0, 1: workgroup size, constant 2: tile order parameter, constant 3: integrator, constant 4: persistent
+	// threads (a VkBool32), constant 5: tile order
+	const std::array<uint32_t, 6> specializationData = { config.workgroupWidth, config.workgroupHeight, config.tileSwizzle,
+		static_cast<uint32_t>(m_integrator), m_persistentThreads.workgroups != 0 ? VK_TRUE : VK_FALSE,
+		static_cast<uint32_t>(config.tileOrder) };
+
+	std::array<VkSpecializationMapEntry, 6> specializationMapEntries{};
+	for (uint32_t i = 0; i < specializationMapEntries.size(); ++i)
 	{
-		VkDescriptorBufferInfo ssboSpheresBufferInfo{};
-		ssboSpheresBufferInfo.buffer = m_computeSSOBuffer;
-		ssboSpheresBufferInfo.offset = 0;
-		ssboSpheresBufferInfo.range = spheresSize;
+		specializationMapEntries[i].constantID = i;
+		specializationMapEntries[i].offset = i * sizeof(uint32_t);
+		specializationMapEntries[i].size = sizeof(uint32_t);
+	}
 
-		VkWriteDescriptorSet ssboSpheres{};
-		ssboSpheres.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		ssboSpheres.dstSet = m_computeDescriptorSet;
-		ssboSpheres.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		ssboSpheres.dstBinding = 2;
-		ssboSpheres.descriptorCount = 1;
-		ssboSpheres.pBufferInfo = &ssboSpheresBufferInfo;
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationMapEntries.size());
+	specializationInfo.pMapEntries = specializationMapEntries.data();
+	specializationInfo.dataSize = specializationData.size() * sizeof(uint32_t);
+	specializationInfo.pData = specializationData.data();
 
-		computeWriteDescriptorSets.push_back(ssboSpheres);
-	}
+	VkComputePipelineCreateInfo computePipelineCreateInfo{};
+	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineCreateInfo.layout = m_computePipelineLayout;
+	computePipelineCreateInfo.flags = 0;
+	computePipelineCreateInfo.stage =
+		VulkanUtils::CreateShaderStage(m_vkDevice, VulkanUtils::GetShadersPath() + "raytracing.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+	computePipelineCreateInfo.stage.pSpecializationInfo = &specializationInfo;
 
-	VkDeviceSize lambertianMaterialsSize =
-		std::max<VkDeviceSize>(1, sizeof(LambertianMaterialProperties) * m_world.materialManager.lambertianMaterials.size());
+	VkPipeline pipeline;
+	VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &pipeline));
 
-	{
-		VkDescriptorBufferInfo ssboLambertianMaterialsBufferInfo{};
-		ssboLambertianMaterialsBufferInfo.buffer = m_computeSSOBuffer;
-		ssboLambertianMaterialsBufferInfo.offset = spheresSize;
-		ssboLambertianMaterialsBufferInfo.range = std::max<VkDeviceSize>(1, lambertianMaterialsSize);
+	VulkanUtils::DestroyShaderStage(m_vkDevice, computePipelineCreateInfo.stage);
 
-		VkWriteDescriptorSet ssboLambertianMaterials{};
-		ssboLambertianMaterials.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		ssboLambertianMaterials.dstSet = m_computeDescriptorSet;
-		ssboLambertianMaterials.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		ssboLambertianMaterials.dstBinding = 3;
-		ssboLambertianMaterials.descriptorCount = 1;
-		ssboLambertianMaterials.pBufferInfo = &ssboLambertianMaterialsBufferInfo;
+	return pipeline;
+}
 
-		computeWriteDescriptorSets.push_back(ssboLambertianMaterials);
+void VulkanAppBase::AutotuneComputeDispatch(bool forceRetune)
+{
+	const std::string cacheFileName = "compute_dispatch.cache";
+	// The integrators and the persistent threads trace are different programs, each one gets its own configuration
+	const std::string cacheKey = DispatchAutotuner::MakeCacheKey(m_deviceProperties,
+		VulkanUtils::GetShadersPath() + "raytracing.comp.spv") + "-i" + std::to_string(static_cast<uint32_t>(m_integrator)) +
+		(m_persistentThreads.workgroups != 0 ? "-p" : "") +
+		(m_forcedTileOrder ? "-t" + std::to_string(static_cast<uint32_t>(*m_forcedTileOrder)) : "");
+
+	std::optional<ComputeDispatchConfig> bestConfig;
+	if (!forceRetune)
+	{
+		bestConfig = DispatchAutotuner::LoadFromCache(cacheFileName, cacheKey);
 	}
 
-	VkDeviceSize metalMaterialsSize =
-		std::max<VkDeviceSize>(1, sizeof(MetalMaterialProperties) * m_world.materialManager.metalMaterials.size());
+	if (!bestConfig)
 	{
-		VkDescriptorBufferInfo ssboMetalMaterialsBufferInfo{};
-		ssboMetalMaterialsBufferInfo.buffer = m_computeSSOBuffer;
-		ssboMetalMaterialsBufferInfo.offset = spheresSize + lambertianMaterialsSize;
-		ssboMetalMaterialsBufferInfo.range = metalMaterialsSize;
+		if (!m_gpuProfiler.IsSupported())
+		{
+			return;
+		}
 
-		VkWriteDescriptorSet ssboMetalMaterials{};
-		ssboMetalMaterials.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		ssboMetalMaterials.dstSet = m_computeDescriptorSet;
-		ssboMetalMaterials.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		ssboMetalMaterials.dstBinding = 4;
-		ssboMetalMaterials.descriptorCount = 1;
-		ssboMetalMaterials.pBufferInfo = &ssboMetalMaterialsBufferInfo;
+		std::cout << "Benchmarking compute dispatch configurations for " << m_deviceProperties.deviceName << "...\n";
 
-		computeWriteDescriptorSets.push_back(ssboMetalMaterials);
-	}
+		VkCommandBuffer commandBuffer = VulkanUtils::CreateCommandeBuffer(m_vkDevice, m_commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
-	VkDeviceSize dielectricMaterialsSize =
-		std::max<VkDeviceSize>(1, sizeof(DielectricMaterialProperties) * m_world.materialManager.dielectricMaterials.size());
-	{
-		VkDescriptorBufferInfo ssboDielectricMaterialsBufferInfo{};
-		ssboDielectricMaterialsBufferInfo.buffer = m_computeSSOBuffer;
-		ssboDielectricMaterialsBufferInfo.offset = spheresSize + lambertianMaterialsSize + metalMaterialsSize;
-		ssboDielectricMaterialsBufferInfo.range = dielectricMaterialsSize;
+		VkFenceCreateInfo fenceCreateInfo{};
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkFence fence;
+		VK_CHECK_RESULT(vkCreateFence(m_vkDevice, &fenceCreateInfo, nullptr, &fence));
+
+		// Serializes the dispatches so every timestamp pair measures exactly one of them
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
 
-		VkWriteDescriptorSet ssboDielectricMaterials{};
-		ssboDielectricMaterials.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		ssboDielectricMaterials.dstSet = m_computeDescriptorSet;
-		ssboDielectricMaterials.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		ssboDielectricMaterials.dstBinding = 5;
-		ssboDielectricMaterials.descriptorCount = 1;
-		ssboDielectricMaterials.pBufferInfo = &ssboDielectricMaterialsBufferInfo;
+		const uint32_t measuredDispatches = 3;
+		float bestMilliseconds = std::numeric_limits<float>::max();
 
-		computeWriteDescriptorSets.push_back(ssboDielectricMaterials);
+		std::vector<ComputeDispatchConfig> candidates = DispatchAutotuner::GetCandidates(m_deviceProperties);
+		if (m_forcedTileOrder)
+		{
+			std::erase_if(candidates, [&](const ComputeDispatchConfig& candidate) { return candidate.tileOrder != *m_forcedTileOrder; });
+		}
+
+		for (const ComputeDispatchConfig& candidate : candidates)
+		{
+			VkPipeline pipeline = CreateComputePipelineVariant(candidate);
+
+			// The benchmark traces a full pass over the actual scene, the previous candidate is done with the ring
+			m_computeUBO.ubo.tileOffset = 0;
+			m_computeUBO.ubo.tilesCount = GetComputeTilesCount(candidate);
+			m_computeUBO.ubo.accumulatedPasses = 0;
+			m_uploadRing.BeginFrame(m_currentFrame);
+			UpdateComputeUBO();
+
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+			m_gpuProfiler.BeginFrame(commandBuffer, 0);
+
+			// Warm up dispatch, not measured
+			RecordComputeDispatch(commandBuffer, pipeline, candidate);
+
+			std::vector<std::string> scopeNames;
+			for (uint32_t i = 0; i < measuredDispatches; ++i)
+			{
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+				scopeNames.push_back("dispatch" + std::to_string(i));
+				uint32_t scope = m_gpuProfiler.BeginScope(commandBuffer, scopeNames.back());
+				RecordComputeDispatch(commandBuffer, pipeline, candidate);
+				m_gpuProfiler.EndScope(commandBuffer, scope);
+			}
+
+			VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &commandBuffer;
+			VK_CHECK_RESULT(vkQueueSubmit(m_computeQueue, 1, &submitInfo, fence));
+			VK_CHECK_RESULT(vkWaitForFences(m_vkDevice, 1, &fence, VK_TRUE, UINT64_MAX));
+			VK_CHECK_RESULT(vkResetFences(m_vkDevice, 1, &fence));
+			VK_CHECK_RESULT(vkResetCommandBuffer(commandBuffer, 0));
+
+			vkDestroyPipeline(m_vkDevice, pipeline, nullptr);
+
+			if (!m_gpuProfiler.Resolve(m_vkDevice, 0))
+			{
+				continue;
+			}
+
+			// The fastest run is the least disturbed by clocks ramping up and other GPU work
+			float milliseconds = std::numeric_limits<float>::max();
+			for (const std::string& scopeName : scopeNames)
+			{
+				milliseconds = std::min(milliseconds, m_gpuProfiler.GetScopeMilliseconds(scopeName));
+			}
+
+			std::cout << " " << candidate.workgroupWidth << "x" << candidate.workgroupHeight
+				<< ", " << DispatchAutotuner::GetTileOrderName(candidate.tileOrder) << " " << candidate.tileSwizzle << ": " << milliseconds << " ms\n";
+
+			if (milliseconds < bestMilliseconds)
+			{
+				bestMilliseconds = milliseconds;
+				bestConfig = candidate;
+			}
+		}
+
+		vkDestroyFence(m_vkDevice, fence, nullptr);
+		vkFreeCommandBuffers(m_vkDevice, m_commandPool, 1, &commandBuffer);
+
+		if (!bestConfig)
+		{
+			return;
+		}
+
+		DispatchAutotuner::StoreToCache(cacheFileName, cacheKey, *bestConfig);
 	}
 
-	vkUpdateDescriptorSets(m_vkDevice,
-		static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, nullptr);
+	std::cout << "Compute dispatch: " << bestConfig->workgroupWidth << "x" << bestConfig->workgroupHeight
+		<< " workgroups, " << DispatchAutotuner::GetTileOrderName(bestConfig->tileOrder) << " " << bestConfig->tileSwizzle << " tile order\n";
 
-	vkDestroyDescriptorSetLayout(m_vkDevice, descriptorSetLayout, nullptr);
+	if (*bestConfig != m_computeDispatchConfig)
+	{
+		vkDestroyPipeline(m_vkDevice, m_computePipeline, nullptr);
+		m_computeDispatchConfig = *bestConfig;
+		m_computePipeline = CreateComputePipelineVariant(m_computeDispatchConfig);
+	}
 }
 
 void VulkanAppBase::CreateUIOverlay()
 {
-	m_uiOverlay.Init(m_vkPhysicalDevice, m_vkDevice, m_commandPool, m_graphicsQueue, m_renderPass);
+	m_uiOverlay.Init(m_memoryAllocator, m_stagingArena, m_vkDevice, m_commandPool, m_graphicsQueue, m_renderPass);
 }
 
 void VulkanAppBase::Run()
 {
-	std::chrono::time_point<std::chrono::high_resolution_clock> frameTime =
-		std::chrono::high_resolution_clock::now();
-
-	const std::chrono::duration<float> deltaTime = frameTime - m_lastFrameTime;
-	m_lastFrameTime = frameTime;
+	// Longer frames (a stalled window, a breakpoint) are stepped as this, the camera and the spheres don't jump
+	const std::chrono::duration<float> maxDeltaTime(0.1f);
 
 	bool quitMessageReceived = false;
 	while (!quitMessageReceived) 
@@ -1623,7 +1814,12 @@ void VulkanAppBase::Run()
 		}
 		if (!IsIconic(m_hwnd))
 		{
-			Update(deltaTime.count());
+			const std::chrono::time_point<std::chrono::high_resolution_clock> frameTime =
+				std::chrono::high_resolution_clock::now();
+			const std::chrono::duration<float> deltaTime = frameTime - m_lastFrameTime;
+			m_lastFrameTime = frameTime;
+
+			Update(std::min(deltaTime, maxDeltaTime).count());
 		}
 	}
 
@@ -1635,23 +1831,176 @@ void VulkanAppBase::RecordComputeCommandBuffer()
 	VkCommandBufferBeginInfo cmdBufInfo{};
 	cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	
-	VK_CHECK_RESULT(vkBeginCommandBuffer(m_computeCommandBuffers[m_currentFrame], &cmdBufInfo));
-		
-	VkImageMemoryBarrier imageMemoryBarrier{};
-	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
-	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
-	imageMemoryBarrier.image = m_computeTargetTexture.image;
-	imageMemoryBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	VkCommandBuffer commandBuffer = m_computeCommandBuffers[m_currentFrame];
+	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &cmdBufInfo));
 
-	vkCmdBindPipeline(m_computeCommandBuffers[m_currentFrame], VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipeline);
-	vkCmdBindDescriptorSets(m_computeCommandBuffers[m_currentFrame], VK_PIPELINE_BIND_POINT_COMPUTE,
-		m_computePipelineLayout, 0, 1, &m_computeDescriptorSet, 0, 0);
+	m_gpuProfiler.BeginFrame(commandBuffer, m_currentFrame);
 
-	vkCmdDispatch(m_computeCommandBuffers[m_currentFrame],
-		m_computeTargetTexture.width / 16, m_computeTargetTexture.height / 16, 1);
+	// Batches of consecutive submissions accumulate into the same pixels
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
 
-	vkEndCommandBuffer(m_computeCommandBuffers[m_currentFrame]);	
+	if (m_dynamicScene.enabled)
+	{
+		const uint32_t animationScope = m_gpuProfiler.BeginScope(commandBuffer, "animation");
+		RecordSceneAnimation(commandBuffer);
+		m_gpuProfiler.EndScope(commandBuffer, animationScope);
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		const uint32_t buildScope = m_gpuProfiler.BeginScope(commandBuffer, "build");
+		RecordAccelerationBuild(commandBuffer);
+		m_gpuProfiler.EndScope(commandBuffer, buildScope);
+	}
+
+	if (m_restir.enabled)
+	{
+		const uint32_t restirScope = m_gpuProfiler.BeginScope(commandBuffer, "restir");
+		m_restir.resampler.Record(commandBuffer, m_gpuScene, m_computeUBO.ubo);
+		m_gpuProfiler.EndScope(commandBuffer, restirScope);
+	}
+
+	if (m_radianceCache.enabled)
+	{
+		const uint32_t cacheScope = m_gpuProfiler.BeginScope(commandBuffer, "radiance cache");
+		m_radianceCache.cache.Record(commandBuffer);
+		m_gpuProfiler.EndScope(commandBuffer, cacheScope);
+	}
+
+	if (m_pathGuiding.enabled)
+	{
+		const uint32_t guidingScope = m_gpuProfiler.BeginScope(commandBuffer, "guiding");
+		m_pathGuiding.guiding.Record(commandBuffer);
+		m_gpuProfiler.EndScope(commandBuffer, guidingScope);
+	}
+
+	const bool bidirectional = m_integrator == Integrator::Bidirectional;
+	if (bidirectional && m_computeUBO.ubo.tileOffset == 0)
+	{
+		m_lightSplats.RecordPassBegin(commandBuffer);
+	}
+
+	const uint32_t traceScope = m_gpuProfiler.BeginScope(commandBuffer, "trace");
+	if (m_wavefront.enabled)
+	{
+		RecordWavefrontTrace(commandBuffer, nullptr);
+	}
+	else
+	{
+		RecordComputeDispatch(commandBuffer, m_computePipeline, m_computeDispatchConfig);
+	}
+	m_gpuProfiler.EndScope(commandBuffer, traceScope);
+
+	// The light tracing splats of the pass are complete once its last batch has been traced
+	if (bidirectional && m_computeUBO.ubo.tileOffset + m_computeUBO.ubo.tilesCount >= GetComputeTilesCount(m_computeDispatchConfig))
+	{
+		const uint32_t resolveScope = m_gpuProfiler.BeginScope(commandBuffer, "splats resolve");
+		m_lightSplats.RecordPassEnd(commandBuffer);
+		m_gpuProfiler.EndScope(commandBuffer, resolveScope);
+	}
+
+	vkEndCommandBuffer(commandBuffer);	
+}
+
+void VulkanAppBase::RecordAccelerationBuild(VkCommandBuffer commandBuffer)
+{
+	// Only the builder of the scene's acceleration structure records anything
+	m_lbvhBuilder.Record(commandBuffer, m_gpuScene);
+	m_gridBuilder.Record(commandBuffer, m_gpuScene);
+}
+
+void VulkanAppBase::RecordSceneAnimation(VkCommandBuffer commandBuffer)
+{
+	Gpu::AnimationPushConstants pushConstants;
+	pushConstants.scene = m_gpuScene.GetHeaderAddress();
+	pushConstants.deltaTime = m_dynamicScene.deltaTime;
+	pushConstants.angularSpeed = m_dynamicScene.angularSpeed;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_dynamicScene.pipeline);
+	vkCmdPushConstants(commandBuffer, m_dynamicScene.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(Gpu::AnimationPushConstants), &pushConstants);
+
+	const uint32_t workgroupSize = 256;
+	vkCmdDispatch(commandBuffer, (m_gpuScene.GetHeader().spheresCount + workgroupSize - 1) / workgroupSize, 1, 1);
+}
+
+void VulkanAppBase::RecordComputeDispatch(VkCommandBuffer commandBuffer, VkPipeline pipeline, const ComputeDispatchConfig& config)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+		m_computePipelineLayout, 0, 1, &m_computeDescriptorSet, 1, &m_computeUBO.dynamicOffset);
+
+	const Gpu::ComputePushConstants pushConstants = GetComputePushConstants();
+	vkCmdPushConstants(commandBuffer, m_computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(Gpu::ComputePushConstants), &pushConstants);
+
+	if (m_persistentThreads.workgroups != 0 || m_persistentThreads.laneStatistics)
+	{
+		// The previous trace is done with the counters before they are cleared for this one
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		vkCmdFillBuffer(commandBuffer, m_persistentThreads.counters.GetBuffer(), 0, sizeof(Gpu::TraceCounters), 0);
+
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	// The persistent workgroups take the pixels of the batch from the counters until there are none left
+	if (m_persistentThreads.workgroups != 0)
+	{
+		vkCmdDispatch(commandBuffer, m_persistentThreads.workgroups, 1, 1);
+		return;
+	}
+
+	// The tiles of the batch are dispatched as rows as wide as the image, the shader
+	// discards invocations past the batch and outside of the image
+	const uint32_t tilesPerRow = (m_computeTargetTexture.width + config.workgroupWidth - 1) / config.workgroupWidth;
+	const uint32_t tilesCount = std::max(m_computeUBO.ubo.tilesCount, 1u);
+	const uint32_t groupCountX = std::min(tilesCount, tilesPerRow);
+	const uint32_t groupCountY = (tilesCount + groupCountX - 1) / groupCountX;
+
+	vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+}
+
+void VulkanAppBase::RecordWavefrontTrace(VkCommandBuffer commandBuffer, GpuProfiler* profiler)
+{
+	WavefrontTracer::Batch batch;
+	batch.descriptorSet = m_computeDescriptorSet;
+	batch.uniformsOffset = m_computeUBO.dynamicOffset;
+	batch.uniforms = m_computeUBO.ubo;
+	batch.pushConstants = GetComputePushConstants();
+	// Same batches of tiles as the trace
+	batch.tileWidth = m_computeDispatchConfig.workgroupWidth;
+	batch.tileHeight = m_computeDispatchConfig.workgroupHeight;
+
+	m_wavefront.tracer.Record(commandBuffer, batch, profiler);
+}
+
+Gpu::ComputePushConstants VulkanAppBase::GetComputePushConstants() const
+{
+	Gpu::ComputePushConstants pushConstants;
+	pushConstants.scene = m_gpuScene.GetHeaderAddress();
+	// 0 until a frame recorded their passes, the autotuner and the benchmark trace without them
+	pushConstants.restirReservoirs = m_restir.resampler.GetReservoirsAddress();
+	pushConstants.radianceCache = m_radianceCache.cache.GetEntriesAddress();
+	pushConstants.guiding = m_pathGuiding.guiding.GetInfoAddress();
+	pushConstants.bdptSplats = m_lightSplats.GetSplatsAddress();
+	pushConstants.bdptLight = m_lightSplats.GetLightAddress();
+	pushConstants.traceCounters = m_persistentThreads.counters.GetAddress();
+	pushConstants.laneStatistics = m_persistentThreads.laneStatistics ? 1 : 0;
+	return pushConstants;
 }
 
 void VulkanAppBase::RecordGraphicsCommandBuffer(uint32_t imageIndex)
@@ -1705,7 +2054,8 @@ void VulkanAppBase::RecordGraphicsCommandBuffer(uint32_t imageIndex)
 
 void VulkanAppBase::UpdateCamera(float deltaTime)
 {
-	const float cameraSpeed = 100000.0f * deltaTime;
+	// World units per second
+	const float cameraSpeed = 2.0f * deltaTime;
 	const glm::vec3 upVector(0.0f, 1.0f, 0.0f);
 
 	m_world.camera.direction = glm::normalize(m_world.camera.direction);
@@ -1740,23 +2090,113 @@ void VulkanAppBase::UpdateCamera(float deltaTime)
 	m_input.mouseDelta = glm::vec2(0.0f, 0.0f);
 }
 
+void VulkanAppBase::UpdateComputeUBO()
+{
+	m_computeUBO.ubo.cameraPosition = m_world.camera.position;
+	m_computeUBO.ubo.cameraDirection = m_world.camera.direction;
+
+	UploadRingBuffer::Allocation allocation = m_uploadRing.Allocate(sizeof(Gpu::ComputeUniforms));
+	memcpy(allocation.mapped, &m_computeUBO.ubo, sizeof(Gpu::ComputeUniforms));
+	m_computeUBO.dynamicOffset = static_cast<uint32_t>(allocation.offset);
+}
+
+uint32_t VulkanAppBase::GetComputeTilesCount(const ComputeDispatchConfig& config) const
+{
+	const uint32_t tilesX = (m_computeTargetTexture.width + config.workgroupWidth - 1) / config.workgroupWidth;
+	const uint32_t tilesY = (m_computeTargetTexture.height + config.workgroupHeight - 1) / config.workgroupHeight;
+	return tilesX * tilesY;
+}
+
+void VulkanAppBase::UpdateTraceBatch()
+{
+	Gpu::ComputeUniforms& ubo = m_computeUBO.ubo;
+	const uint32_t tilesCount = GetComputeTilesCount(m_computeDispatchConfig);
+
+	// bdpt_resolve.comp adds the light tracing splats to the camera paths of the accumulation image
+	ubo.accumulate = m_progressive.enabled || m_integrator == Integrator::Bidirectional;
+
+	if (!m_progressive.enabled)
+	{
+		ubo.tileOffset = 0;
+		ubo.tilesCount = tilesCount;
+		ubo.accumulatedPasses = 0;
+		return;
+	}
+
+	// The fence of the frame slot has been waited on, so the timing of its last batch is available
+	if (m_gpuProfiler.Resolve(m_vkDevice, m_currentFrame) && m_progressive.batchTiles[m_currentFrame] > 0)
+	{
+		const float milliseconds = m_gpuProfiler.GetScopeMilliseconds("trace");
+		if (milliseconds > 0.0f)
+		{
+			const float budgetTiles = m_progressive.frameBudgetMilliseconds * m_progressive.batchTiles[m_currentFrame] / milliseconds;
+			// Damped, a single slow or fast batch shouldn't make the batch size oscillate
+			m_progressive.tilesPerFrame = static_cast<uint32_t>(glm::mix(static_cast<float>(m_progressive.tilesPerFrame), budgetTiles, 0.5f));
+		}
+	}
+
+	if (m_progressive.tilesPerFrame == 0)
+	{
+		// Start with a row of tiles until there's a measurement
+		m_progressive.tilesPerFrame = (m_computeTargetTexture.width + m_computeDispatchConfig.workgroupWidth - 1) / m_computeDispatchConfig.workgroupWidth;
+	}
+	m_progressive.tilesPerFrame = std::clamp(m_progressive.tilesPerFrame, 1u, tilesCount);
+
+	// Any change of the view invalidates the accumulated passes. The frame of the change traces a preview of the
+	// whole image at one sample per pixel, batches of a single pass would leave the other tiles on the old view.
+	// The preview isn't a pass, the first pass overwrites it tile by tile.
+	if (m_progressive.cameraPosition != m_world.camera.position ||
+		m_progressive.cameraDirection != m_world.camera.direction ||
+		m_progressive.aspectRatio != ubo.aspectRatio)
+	{
+		m_progressive.cameraPosition = m_world.camera.position;
+		m_progressive.cameraDirection = m_world.camera.direction;
+		m_progressive.aspectRatio = ubo.aspectRatio;
+		m_progressive.tileCursor = 0;
+		m_progressive.accumulatedPasses = 0;
+
+		ubo.samplesPerPixel = 1;
+		ubo.tileOffset = 0;
+		ubo.tilesCount = tilesCount;
+		ubo.accumulatedPasses = 0;
+		// Its time per tile says nothing about the batches
+		m_progressive.batchTiles[m_currentFrame] = 0;
+		return;
+	}
+
+	ubo.samplesPerPixel = m_progressive.samplesPerPixel;
+
+	// Batches don't wrap around, the last one of a pass may be smaller
+	ubo.tileOffset = m_progressive.tileCursor;
+	ubo.tilesCount = std::min(m_progressive.tilesPerFrame, tilesCount - m_progressive.tileCursor);
+	ubo.accumulatedPasses = m_progressive.accumulatedPasses;
+
+	m_progressive.batchTiles[m_currentFrame] = ubo.tilesCount;
+
+	m_progressive.tileCursor += ubo.tilesCount;
+	if (m_progressive.tileCursor == tilesCount)
+	{
+		m_progressive.tileCursor = 0;
+		++m_progressive.accumulatedPasses;
+	}
+}
+
 void VulkanAppBase::Update(float deltaTime)
 {
-	m_uiOverlay.Update(m_vkPhysicalDevice, m_vkDevice);
+	// Both submissions of the frame slot read from its upload ring region, they have to be done before it's rewritten
+	const VkFence frameFences[] = { m_computeInFlightFences[m_currentFrame], m_graphicsInFlightFences[m_currentFrame] };
+	vkWaitForFences(m_vkDevice, 2, frameFences, VK_TRUE, UINT64_MAX);
 
-	UpdateCamera(deltaTime);
+	m_uploadRing.BeginFrame(m_currentFrame);
 
-	m_computeUBO.ubo.cameraPosition = glm::vec4(m_world.camera.position, 0.0f);
-	m_computeUBO.ubo.cameraDirection = glm::vec4(m_world.camera.direction, 0.0f);
+	m_uiOverlay.Update(m_uploadRing);
 
-	void* uboMapped = nullptr;
-	VK_CHECK_RESULT(vkMapMemory(m_vkDevice, m_computeUBO.vkBuffersMemory[m_currentFrame], 0, VK_WHOLE_SIZE, 0, &uboMapped));
-	memcpy(uboMapped, &m_computeUBO.ubo, sizeof(ComputeUBO::UniformBuffer));
-	vkUnmapMemory(m_vkDevice, m_computeUBO.vkBuffersMemory[m_currentFrame]);
+	UpdateCamera(deltaTime);
+	m_dynamicScene.deltaTime = deltaTime;
+	UpdateTraceBatch();
+	UpdateComputeUBO();
 
 	// Compute submission        
-	vkWaitForFences(m_vkDevice, 1, &m_computeInFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
-
 	vkResetFences(m_vkDevice, 1, &m_computeInFlightFences[m_currentFrame]);
 
 	vkResetCommandBuffer(m_computeCommandBuffers[m_currentFrame], 0);
@@ -1774,7 +2214,6 @@ void VulkanAppBase::Update(float deltaTime)
 		"Failed to submit compute command buffer!");
 
 	// Graphics submission
-    vkWaitForFences(m_vkDevice, 1, &m_graphicsInFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
     vkResetFences(m_vkDevice, 1, &m_graphicsInFlightFences[m_currentFrame]);
 	vkResetCommandBuffer(m_graphicsCommandBuffers[m_currentFrame], 0);
 	
@@ -1851,6 +2290,159 @@ void VulkanAppBase::Init(HINSTANCE hInstance, const CommandLineOptions& options)
 	uint32_t height = options.GetValueAsInt("height", 600);
 
 	m_computeUBO.ubo.aspectRatio = (float)width / (float)height;
+	m_computeUBO.ubo.samplesPerPixel = options.GetValueAsInt("spp", m_computeUBO.ubo.samplesPerPixel);
+	m_computeUBO.ubo.maxDepth = options.GetValueAsInt("depth", m_computeUBO.ubo.maxDepth);
+
+	m_progressive.enabled = options.IsSet("progressive");
+	m_progressive.frameBudgetMilliseconds = static_cast<float>(options.GetValueAsInt("framebudget",
+		static_cast<int32_t>(m_progressive.frameBudgetMilliseconds)));
+	m_progressive.batchTiles.resize(MAX_FRAMES_IN_FLIGHT, 0);
+	m_progressive.samplesPerPixel = m_computeUBO.ubo.samplesPerPixel;
+
+	m_sceneEncoding = options.IsSet("quantize") ? SceneEncoding::Quantized : SceneEncoding::Packed;
+	m_sceneCacheEnabled = options.IsSet("scenecache");
+
+	m_sceneAcceleration = m_world.acceleration;
+	if (options.IsSet("accel"))
+	{
+		const std::string acceleration = options.GetValueAsString("accel", "linear");
+		if (acceleration == "linear")
+		{
+			m_sceneAcceleration = SceneAcceleration::Linear;
+		}
+		else if (acceleration == "lbvh")
+		{
+			m_sceneAcceleration = SceneAcceleration::Lbvh;
+		}
+		else if (acceleration == "grid")
+		{
+			m_sceneAcceleration = SceneAcceleration::Grid;
+		}
+		else if (acceleration == "wbvh")
+		{
+			m_sceneAcceleration = SceneAcceleration::WideBvh;
+		}
+		else
+		{
+			VulkanUtils::FatalExit("Unknown acceleration structure " + acceleration + "!", -1);
+		}
+	}
+
+	if (options.IsSet("tileorder"))
+	{
+		const std::string tileOrder = options.GetValueAsString("tileorder", "rowmajor");
+		if (tileOrder == "rowmajor")
+		{
+			m_forcedTileOrder = TileOrder::RowMajor;
+		}
+		else if (tileOrder == "strips")
+		{
+			m_forcedTileOrder = TileOrder::Strips;
+		}
+		else if (tileOrder == "morton")
+		{
+			m_forcedTileOrder = TileOrder::Morton;
+		}
+		else if (tileOrder == "hilbert")
+		{
+			m_forcedTileOrder = TileOrder::Hilbert;
+		}
+		else
+		{
+			VulkanUtils::FatalExit("Unknown tile order " + tileOrder + "!", -1);
+		}
+
+		// Until the autotuner picks the parameter of the order, or if it can't
+		m_computeDispatchConfig.tileOrder = *m_forcedTileOrder;
+		m_computeDispatchConfig.tileSwizzle = *m_forcedTileOrder == TileOrder::RowMajor ? 0 : 8;
+	}
+
+	const std::string environmentFileName = options.IsSet("environment") ? options.GetValueAsString("environment", "") : m_world.environment.fileName;
+	if (!environmentFileName.empty())
+	{
+		EnvironmentMap::Image environmentImage;
+		if (!EnvironmentMap::LoadHdr(environmentFileName, environmentImage))
+		{
+			VulkanUtils::FatalExit("Failed to load the environment map " + environmentFileName + "!", -1);
+		}
+
+		m_environment = EnvironmentMap::Encode(environmentImage, m_world.environment.intensity);
+		EnvironmentMap::PrintStats(std::cout, m_environment);
+	}
+
+	// The chunks of the quantized encoding would have to be rebuilt along with the spheres
+	m_dynamicScene.enabled = options.IsSet("dynamic");
+	if (m_dynamicScene.enabled && m_sceneEncoding != SceneEncoding::Packed)
+	{
+		VulkanUtils::FatalExit("Dynamic scenes need the packed scene encoding!", -1);
+	}
+
+	if (m_dynamicScene.enabled && m_sceneAcceleration == SceneAcceleration::WideBvh)
+	{
+		VulkanUtils::FatalExit("Dynamic scenes need an acceleration structure built on the GPU!", -1);
+	}
+
+	// Every frame of a dynamic scene is a new scene, there's nothing to accumulate over the batches of a pass
+	if (m_dynamicScene.enabled && m_progressive.enabled)
+	{
+		VulkanUtils::FatalExit("Dynamic scenes can't be combined with the progressive mode!", -1);
+	}
+
+	// Progressive passes would all reuse the same few reservoirs, their average wouldn't converge
+	m_restir.enabled = options.IsSet("restir");
+	if (m_restir.enabled && m_progressive.enabled)
+	{
+		VulkanUtils::FatalExit("ReSTIR can't be combined with the progressive mode!", -1);
+	}
+
+	m_radianceCache.enabled = options.IsSet("radiancecache");
+	m_pathGuiding.enabled = options.IsSet("guiding");
+
+	m_integrator = m_world.integrator;
+	if (options.IsSet("integrator"))
+	{
+		const std::string integrator = options.GetValueAsString("integrator", "path");
+		if (integrator == "path")
+		{
+			m_integrator = Integrator::Path;
+		}
+		else if (integrator == "bdpt")
+		{
+			m_integrator = Integrator::Bidirectional;
+		}
+		else
+		{
+			VulkanUtils::FatalExit("Unknown integrator " + integrator + "!", -1);
+		}
+	}
+
+	// ReSTIR, the radiance cache and path guiding are built into the paths of the path integrator
+	if (m_integrator == Integrator::Bidirectional && (m_restir.enabled || m_radianceCache.enabled || m_pathGuiding.enabled))
+	{
+		VulkanUtils::FatalExit("ReSTIR, the radiance cache and path guiding need the path integrator!", -1);
+	}
+
+	// The wavefront passes trace the paths of the plain path integrator
+	m_wavefront.enabled = options.IsSet("wavefront") || options.IsSet("wavefrontsort");
+	const bool wavefrontBenchmark = options.IsSet("wavefrontbenchmark");
+	if ((m_wavefront.enabled || wavefrontBenchmark) &&
+		(m_integrator != Integrator::Path || m_restir.enabled || m_radianceCache.enabled || m_pathGuiding.enabled))
+	{
+		VulkanUtils::FatalExit("The wavefront mode needs the path integrator, without ReSTIR, the radiance cache and path guiding!", -1);
+	}
+	if (options.IsSet("wavefrontsort"))
+	{
+		m_wavefront.tracer.SetFirstSortedBounce(static_cast<uint32_t>(options.GetValueAsInt("wavefrontsort", 1)));
+	}
+
+	// The persistent lanes regenerate the paths of the path integrator, the bidirectional one traces its light
+	// subpaths and splats along with the camera paths
+	const bool persistentThreads = options.IsSet("persistent");
+	const bool persistentBenchmark = options.IsSet("persistentbenchmark");
+	if ((persistentThreads || persistentBenchmark) && (m_integrator != Integrator::Path || m_wavefront.enabled))
+	{
+		VulkanUtils::FatalExit("Persistent threads need the path integrator, without the wavefront mode!", -1);
+	}
 
 	m_hwnd = SetupWindow(width, height, fullscreen);
 
@@ -1860,6 +2452,9 @@ void VulkanAppBase::Init(HINSTANCE hInstance, const CommandLineOptions& options)
 		VulkanUtils::FatalExit("Failed to init vulkan\n", -1);
 	}
 
+	m_memoryAllocator.Init(m_vkPhysicalDevice, m_vkDevice, true);
+	m_stagingArena.Init(m_memoryAllocator, minStagingArenaSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
 	m_vsyncEnabled = options.IsSet("vsync");
 	CreateSwapChain(width, height);
 	CreateSwapChainImageViews();
@@ -1870,15 +2465,64 @@ void VulkanAppBase::Init(HINSTANCE hInstance, const CommandLineOptions& options)
 	CreateSyncObjects();
 
 	CreateDescriptorPool();
-	CreateComputeShaderUBO();
-	CreateComputeShaderSSBO();
+	CreateUploadRingBuffer();
+	m_lbvhBuilder.Init(m_vkDevice);
+	m_gridBuilder.Init(m_vkDevice);
+	CreateGpuScene();
 	CreateComputeShaderRenderTarget();
+	if (m_restir.enabled)
+	{
+		m_restir.resampler.Init(m_vkDevice);
+		m_restir.resampler.Reserve(m_memoryAllocator, m_computeTargetTexture.width, m_computeTargetTexture.height);
+	}
+	if (m_radianceCache.enabled)
+	{
+		m_radianceCache.cache.Init(m_vkDevice);
+		m_radianceCache.cache.Reserve(m_memoryAllocator);
+	}
+	if (m_pathGuiding.enabled)
+	{
+		m_pathGuiding.guiding.Init(m_vkDevice);
+		m_pathGuiding.guiding.Reserve(m_memoryAllocator);
+	}
+	if (persistentThreads || persistentBenchmark)
+	{
+		m_persistentThreads.counters.Reserve(m_memoryAllocator, sizeof(Gpu::TraceCounters));
+	}
+	if (persistentThreads)
+	{
+		m_persistentThreads.workgroups = static_cast<uint32_t>(std::max(options.GetValueAsInt("persistent", 0), 1));
+	}
 	CreateGraphicsPipeline();
 	CreateComputePipeline();
+	if (m_integrator == Integrator::Bidirectional)
+	{
+		m_lightSplats.Init(m_vkDevice, m_computePipelineLayout);
+		m_lightSplats.Reserve(m_memoryAllocator, m_computeTargetTexture.width, m_computeTargetTexture.height);
+	}
+	if (m_wavefront.enabled || wavefrontBenchmark)
+	{
+		m_wavefront.tracer.Init(m_vkDevice, m_computePipelineLayout);
+	}
+	CreateSceneAnimationPipeline();
 	CreateFrameBuffers();
 
+	m_gpuProfiler.Init(m_vkDevice, m_deviceProperties, MAX_FRAMES_IN_FLIGHT);
+	AutotuneComputeDispatch(options.IsSet("autotune"));
+
+	if (m_wavefront.enabled || wavefrontBenchmark)
+	{
+		// A path per pixel of the tiles of a whole pass, the largest batch
+		m_wavefront.tracer.Reserve(m_memoryAllocator, GetComputeTilesCount(m_computeDispatchConfig) *
+			m_computeDispatchConfig.workgroupWidth * m_computeDispatchConfig.workgroupHeight);
+	}
+
+	RunBenchmarks(options);
+
 	CreateUIOverlay();
 
+	m_memoryAllocator.PrintStats(std::cout);
+
 	m_lastFrameTime = std::chrono::high_resolution_clock::now();
 
 	m_initialized = true;
@@ -4,6 +4,18 @@
 #include "CommandLineOptions.h"
 
 #include "UIOverlay.h"
+#include "DeviceMemoryAllocator.h"
+#include "UploadRingBuffer.h"
+#include "GpuScene.h"
+#include "LbvhBuilder.h"
+#include "GridBuilder.h"
+#include "ReservoirResampler.h"
+#include "RadianceCache.h"
+#include "PathGuiding.h"
+#include "LightSplats.h"
+#include "WavefrontTracer.h"
+#include "GpuProfiler.h"
+#include "DispatchAutotuner.h"
 
 
 #define _CRTDBG_MAP_ALLOC
@@ -49,10 +61,20 @@ private:
 	void CreateDescriptorPool();
 	void CreateGraphicsPipeline();
 	void CreateComputePipeline();
+	VkPipeline CreateComputePipelineVariant(const ComputeDispatchConfig& config);
+	void AutotuneComputeDispatch(bool forceRetune);
 	void CreateFrameBuffers();
 	void CreateComputeShaderRenderTarget();
-	void CreateComputeShaderUBO();
-	void CreateComputeShaderSSBO();
+	void CreateUploadRingBuffer();
+	void CreateGpuScene();
+	void BuildSceneAcceleration();
+	void CreateSceneAnimationPipeline();
+	void RegisterBenchmarkOptions(CommandLineOptions& options) const;
+	void RunBenchmarks(const CommandLineOptions& options);
+	void BenchmarkAccelerations();
+	void BenchmarkRaySorting();
+	void BenchmarkPersistentThreads();
+	void BenchmarkTileOrders();
 	void CreateUIOverlay();
 	
 	void CleanupSwapChain(VkSwapchainKHR swapChain);
@@ -60,9 +82,17 @@ private:
 	void ResizeWindow(uint32_t width, uint32_t height);
 
 	void RecordComputeCommandBuffer();
+	void RecordComputeDispatch(VkCommandBuffer commandBuffer, VkPipeline pipeline, const ComputeDispatchConfig& config);
+	void RecordWavefrontTrace(VkCommandBuffer commandBuffer, GpuProfiler* profiler);
+	Gpu::ComputePushConstants GetComputePushConstants() const;
+	void RecordAccelerationBuild(VkCommandBuffer commandBuffer);
+	void RecordSceneAnimation(VkCommandBuffer commandBuffer);
 	void RecordGraphicsCommandBuffer(uint32_t imageIndex);
 
 	void Update(float deltaTime);
+	void UpdateComputeUBO();
+	void UpdateTraceBatch();
+	uint32_t GetComputeTilesCount(const ComputeDispatchConfig& config) const;
 	void UpdateCamera(float deltaTime);
 
 private:
@@ -121,33 +151,122 @@ private:
 	{
 		VkImage image;
 		VkDescriptorImageInfo descriptor;
-		VkDeviceMemory memory;
+		DeviceAllocation allocation;
 		uint32_t width;
 		uint32_t height;			
 	} m_computeTargetTexture;
 
+	// Sum of the passes traced so far, same size as the compute target
+	struct
+	{
+		VkImage image;
+		VkDescriptorImageInfo descriptor;
+		DeviceAllocation allocation;
+	} m_accumulationTexture;
+
 	VkPipeline m_graphicsPipeline;
 	VkPipelineLayout m_graphicsPipelineLayout;
 	VkPipeline m_computePipeline;
 	VkPipelineLayout m_computePipelineLayout;
+	ComputeDispatchConfig m_computeDispatchConfig;
+	// Tile order asked for on the command line, the autotuner only picks its parameter
+	std::optional<TileOrder> m_forcedTileOrder;
 
 	struct ComputeUBO
 	{
-		std::vector<VkBuffer> vkBuffers;
-		std::vector<VkDeviceMemory> vkBuffersMemory;
-		std::vector<void*> mappedBuffers;
-		struct UniformBuffer
-		{
-			glm::vec4 cameraPosition;
-			glm::vec4 cameraDirection;
-			float aspectRatio = 1.0f;	
-		    float defocus_angle = 1.0f;  // Variation angle of rays through each pixel
-    		float focus_dist = 3.0;    // Distance from camera lookfrom point to plane of perfect focus
-		} ubo;
+		// Offset of the current frame's copy in the upload ring
+		uint32_t dynamicOffset = 0;
+		Gpu::ComputeUniforms ubo;
 	} m_computeUBO;
 
-	VkBuffer m_computeSSOBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_computeSSOBufferMemory = VK_NULL_HANDLE;
+	GpuScene m_gpuScene;
+	SceneEncoding m_sceneEncoding = SceneEncoding::Packed;
+	SceneAcceleration m_sceneAcceleration = SceneAcceleration::Linear;
+	bool m_sceneCacheEnabled = false;
+	EnvironmentMap::Encoded m_environment;
+	LbvhBuilder m_lbvhBuilder;
+	GridBuilder m_gridBuilder;
+
+	// Dynamic scenes move every sphere on the GPU each frame, the acceleration structure is then rebuilt from scratch
+	struct
+	{
+		bool enabled = false;
+		float angularSpeed = 0.5f;
+		float deltaTime = 0.0f;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+	} m_dynamicScene;
+
+	// ReSTIR resamples the direct light of the emissive spheres at the camera ray hits over the pixels and frames
+	struct
+	{
+		bool enabled = false;
+		ReservoirResampler resampler;
+	} m_restir;
+
+	// Hash grid of the light leaving rough surfaces, most paths end on it after their first bounces
+	struct
+	{
+		bool enabled = false;
+		RadianceCache cache;
+	} m_radianceCache;
+
+	// Learned distributions of the light arriving at rough surfaces, sampled with the BSDF at their bounces
+	struct
+	{
+		bool enabled = false;
+		PathGuiding guiding;
+	} m_pathGuiding;
+
+	Integrator m_integrator = Integrator::Path;
+	// Light tracing splats of the bidirectional integrator, folded into the image at the end of every pass
+	LightSplats m_lightSplats;
+
+	// The path integrator traced a bounce at a time, optionally with the rays sorted between the bounces
+	struct
+	{
+		bool enabled = false;
+		WavefrontTracer tracer;
+	} m_wavefront;
+
+	// The path integrator traced by a fixed number of workgroups taking the pixels of the batch from a counter,
+	// their lanes starting a new path as soon as theirs ends instead of idling until the whole subgroup is done
+	struct
+	{
+		// 0 dispatches a workgroup per tile
+		uint32_t workgroups = 0;
+		// The trace counts its busy lanes at every bounce, for the benchmark
+		bool laneStatistics = false;
+		DeviceArray counters;
+	} m_persistentThreads;
+
+	DeviceMemoryAllocator m_memoryAllocator;
+	// Transient host visible memory for uploads, reset once the copies have completed
+	LinearArena m_stagingArena;
+	static constexpr VkDeviceSize minStagingArenaSize = 4 * 1024 * 1024;
+
+	// Per frame data: compute UBO, UI geometry
+	UploadRingBuffer m_uploadRing;
+	static constexpr VkDeviceSize uploadRingFrameCapacity = 2 * 1024 * 1024;
+
+	// Progressive mode traces the image in batches of tiles sized to a GPU time budget per frame
+	// and accumulates passes over the image until the view changes
+	struct
+	{
+		bool enabled = false;
+		float frameBudgetMilliseconds = 10.0f;
+		// Of the passes, the preview of a new view traces a single one
+		uint32_t samplesPerPixel = 1;
+		uint32_t tilesPerFrame = 0;
+		uint32_t tileCursor = 0;
+		uint32_t accumulatedPasses = 0;
+		// Tiles submitted by each frame in flight, turns its measured time into a cost per tile
+		std::vector<uint32_t> batchTiles;
+
+		glm::vec3 cameraPosition = glm::vec3(0.0f);
+		glm::vec3 cameraDirection = glm::vec3(0.0f);
+		float aspectRatio = 0.0f;
+	} m_progressive;
 
 	uint32_t m_currentFrame = 0;
 
@@ -171,6 +290,8 @@ private:
 
 	UIOverlay m_uiOverlay;
 
+	GpuProfiler m_gpuProfiler;
+
 	friend LRESULT WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 };
 
@@ -0,0 +1,672 @@
+#include "VulkanApp.h"
+#include "VulkanUtils.h"
+#include "World.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmarks of the command line, measured with the GPU profiler once the app is initialized. They change the
+// trace state of the app while they run and restore it at the end.
+
+void VulkanAppBase::RegisterBenchmarkOptions(CommandLineOptions& options) const
+{
+	options.Add("accelbenchmark", { "-ab", "--accel-benchmark" }, false, "Measure build and trace times of the acceleration structures over random scenes of increasing sphere counts");
+	options.Add("wavefrontbenchmark", { "-wfb", "--wavefront-benchmark" }, false, "Measure every bounce of the wavefront mode with and without ray sorting over the scene");
+	options.Add("persistentbenchmark", { "-ptb", "--persistent-benchmark" }, false, "Measure the time and the SIMD lane utilization of the persistent threads trace against a workgroup per tile");
+	options.Add("tileorderbenchmark", { "-tob", "--tile-order-benchmark" }, false, "Measure the trace with every tile order, over the scene and large random scenes");
+}
+
+void VulkanAppBase::RunBenchmarks(const CommandLineOptions& options)
+{
+	if (options.IsSet("accelbenchmark"))
+	{
+		BenchmarkAccelerations();
+	}
+
+	if (options.IsSet("wavefrontbenchmark"))
+	{
+		BenchmarkRaySorting();
+	}
+
+	if (options.IsSet("persistentbenchmark"))
+	{
+		BenchmarkPersistentThreads();
+	}
+
+	if (options.IsSet("tileorderbenchmark"))
+	{
+		BenchmarkTileOrders();
+	}
+}
+
+// Random spheres filling a box in front of the default camera, equally dense whatever their count
+static void CreateBenchmarkWorld(World& world, uint32_t spheresCount)
+{
+	std::mt19937 generator(spheresCount);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	const glm::vec3 boxMin(-20.0f, -20.0f, 5.0f);
+	const glm::vec3 boxExtent(40.0f, 40.0f, 60.0f);
+	const float spacing = std::cbrt(boxExtent.x * boxExtent.y * boxExtent.z / spheresCount);
+
+	const MaterialInfo materials[] =
+	{
+		world.materialManager.CreateMaterial(LambertianMaterialProperties(glm::vec3(0.8f, 0.4f, 0.3f))),
+		world.materialManager.CreateMaterial(MetalMaterialProperties(glm::vec3(0.8f, 0.8f, 0.8f), 0.05f)),
+		world.materialManager.CreateMaterial(DielectricMaterialProperties(1.5f))
+	};
+
+	world.spheres.reserve(spheresCount);
+	for (uint32_t i = 0; i < spheresCount; ++i)
+	{
+		const glm::vec3 center = boxMin + glm::vec3(unit(generator), unit(generator), unit(generator)) * boxExtent;
+		world.spheres.push_back({ SpherePrimitive(center, spacing * (0.15f + 0.2f * unit(generator))), materials[i % 3] });
+	}
+}
+
+void VulkanAppBase::BenchmarkAccelerations()
+{
+	if (!m_gpuProfiler.IsSupported())
+	{
+		return;
+	}
+
+	std::cout << "Acceleration structures benchmark, " << m_computeTargetTexture.width << "x" << m_computeTargetTexture.height << ", "
+		<< m_computeUBO.ubo.samplesPerPixel << " spp, max depth " << m_computeUBO.ubo.maxDepth << ", times in ms (wbvh build on the CPU)\n";
+	std::cout << std::setw(10) << "spheres" << std::setw(13) << "lbvh build" << std::setw(13) << "lbvh trace"
+		<< std::setw(13) << "grid build" << std::setw(13) << "grid trace" << std::setw(13) << "wbvh build" << std::setw(13) << "wbvh trace"
+		<< std::setw(15) << "linear trace" << "\n";
+
+	VkCommandBuffer commandBuffer = VulkanUtils::CreateCommandeBuffer(m_vkDevice, m_commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	VkFenceCreateInfo fenceCreateInfo{};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	VK_CHECK_RESULT(vkCreateFence(m_vkDevice, &fenceCreateInfo, nullptr, &fence));
+
+	// Build followed by a full pass over the image, measured alone. The wide BVH is built by the encoding.
+	auto measure = [&](const World& world, SceneAcceleration acceleration, float& buildMilliseconds, float& traceMilliseconds)
+	{
+		const auto encodeStart = std::chrono::high_resolution_clock::now();
+		const SceneEncoder::EncodedScene encodedScene = SceneEncoder::Encode(world, m_sceneEncoding, acceleration, false);
+		const std::chrono::duration<float, std::milli> encodeTime = std::chrono::high_resolution_clock::now() - encodeStart;
+
+		m_gpuScene.Upload(m_memoryAllocator, m_stagingArena, m_graphicsQueue, m_commandPool, encodedScene.GetView(), m_environment);
+		m_lbvhBuilder.Reserve(m_memoryAllocator, encodedScene.spheresCount);
+		m_gridBuilder.Reserve(m_memoryAllocator, encodedScene.spheresCount);
+
+		m_computeUBO.ubo.tileOffset = 0;
+		m_computeUBO.ubo.tilesCount = GetComputeTilesCount(m_computeDispatchConfig);
+		m_computeUBO.ubo.accumulatedPasses = 0;
+		m_uploadRing.BeginFrame(m_currentFrame);
+		UpdateComputeUBO();
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		m_gpuProfiler.BeginFrame(commandBuffer, 0);
+
+		const uint32_t buildScope = m_gpuProfiler.BeginScope(commandBuffer, "build");
+		RecordAccelerationBuild(commandBuffer);
+		m_gpuProfiler.EndScope(commandBuffer, buildScope);
+
+		const uint32_t traceScope = m_gpuProfiler.BeginScope(commandBuffer, "trace");
+		RecordComputeDispatch(commandBuffer, m_computePipeline, m_computeDispatchConfig);
+		m_gpuProfiler.EndScope(commandBuffer, traceScope);
+
+		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		VK_CHECK_RESULT(vkQueueSubmit(m_computeQueue, 1, &submitInfo, fence));
+		VK_CHECK_RESULT(vkWaitForFences(m_vkDevice, 1, &fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(m_vkDevice, 1, &fence));
+		VK_CHECK_RESULT(vkResetCommandBuffer(commandBuffer, 0));
+
+		const bool resolved = m_gpuProfiler.Resolve(m_vkDevice, 0);
+		buildMilliseconds = resolved ? m_gpuProfiler.GetScopeMilliseconds("build") : -1.0f;
+		if (acceleration == SceneAcceleration::WideBvh)
+		{
+			buildMilliseconds = encodeTime.count();
+		}
+		traceMilliseconds = resolved ? m_gpuProfiler.GetScopeMilliseconds("trace") : -1.0f;
+	};
+
+	// Testing every sphere for every ray gets too slow to be worth measuring, or to stay below the driver timeout
+	const uint32_t maxLinearSpheresCount = 16 * 1024;
+
+	for (uint32_t spheresCount = 1024; spheresCount <= 1024 * 1024; spheresCount *= 4)
+	{
+		World world;
+		world.camera = m_world.camera;
+		CreateBenchmarkWorld(world, spheresCount);
+
+		std::cout << std::setw(10) << spheresCount << std::fixed << std::setprecision(3);
+
+		for (SceneAcceleration acceleration : { SceneAcceleration::Lbvh, SceneAcceleration::Grid, SceneAcceleration::WideBvh })
+		{
+			float buildMilliseconds = 0.0f;
+			float traceMilliseconds = 0.0f;
+			measure(world, acceleration, buildMilliseconds, traceMilliseconds);
+			std::cout << std::setw(13) << buildMilliseconds << std::setw(13) << traceMilliseconds;
+		}
+
+		if (spheresCount <= maxLinearSpheresCount)
+		{
+			float unusedMilliseconds = 0.0f;
+			float linearTraceMilliseconds = 0.0f;
+			measure(world, SceneAcceleration::Linear, unusedMilliseconds, linearTraceMilliseconds);
+			std::cout << std::setw(15) << linearTraceMilliseconds;
+		}
+		else
+		{
+			std::cout << std::setw(15) << "-";
+		}
+
+		std::cout << std::defaultfloat << "\n";
+	}
+
+	vkDestroyFence(m_vkDevice, fence, nullptr);
+	vkFreeCommandBuffers(m_vkDevice, m_commandPool, 1, &commandBuffer);
+
+	// Back to the scene of the app
+	CreateGpuScene();
+}
+
+void VulkanAppBase::BenchmarkRaySorting()
+{
+	if (!m_gpuProfiler.IsSupported())
+	{
+		return;
+	}
+
+	// A single sample over the whole image. The trace and two scopes per bounce have to fit in the profiler.
+	Gpu::ComputeUniforms& ubo = m_computeUBO.ubo;
+	const Gpu::ComputeUniforms savedUniforms = ubo;
+	const uint32_t firstSortedBounce = m_wavefront.tracer.GetFirstSortedBounce();
+	ubo.samplesPerPixel = 1;
+	ubo.maxDepth = std::min(ubo.maxDepth, 15u);
+	ubo.tileOffset = 0;
+	ubo.tilesCount = GetComputeTilesCount(m_computeDispatchConfig);
+	ubo.accumulatedPasses = 0;
+
+	std::cout << "Ray sorting benchmark, " << m_computeTargetTexture.width << "x" << m_computeTargetTexture.height
+		<< ", 1 spp, max depth " << ubo.maxDepth << ", times in ms\n";
+
+	VkCommandBuffer commandBuffer = VulkanUtils::CreateCommandeBuffer(m_vkDevice, m_commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	VkFenceCreateInfo fenceCreateInfo{};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	VK_CHECK_RESULT(vkCreateFence(m_vkDevice, &fenceCreateInfo, nullptr, &fence));
+
+	// A wavefront pass over the image with the rays of the bounces from firstSortedBounce on sorted, after a warm up
+	// one. The trace of the same sample in one dispatch is measured along.
+	auto measure = [&](uint32_t sortedBounce)
+	{
+		m_wavefront.tracer.SetFirstSortedBounce(sortedBounce);
+		m_uploadRing.BeginFrame(m_currentFrame);
+		UpdateComputeUBO();
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		m_gpuProfiler.BeginFrame(commandBuffer, 0);
+
+		RecordWavefrontTrace(commandBuffer, nullptr);
+		RecordWavefrontTrace(commandBuffer, &m_gpuProfiler);
+
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		const uint32_t traceScope = m_gpuProfiler.BeginScope(commandBuffer, "trace");
+		RecordComputeDispatch(commandBuffer, m_computePipeline, m_computeDispatchConfig);
+		m_gpuProfiler.EndScope(commandBuffer, traceScope);
+
+		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		VK_CHECK_RESULT(vkQueueSubmit(m_computeQueue, 1, &submitInfo, fence));
+		VK_CHECK_RESULT(vkWaitForFences(m_vkDevice, 1, &fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(m_vkDevice, 1, &fence));
+		VK_CHECK_RESULT(vkResetCommandBuffer(commandBuffer, 0));
+
+		return m_gpuProfiler.Resolve(m_vkDevice, 0);
+	};
+
+	std::vector<float> unsortedExtend(ubo.maxDepth, 0.0f);
+	std::vector<float> sort(ubo.maxDepth, 0.0f);
+	std::vector<float> sortedExtend(ubo.maxDepth, 0.0f);
+	float traceMilliseconds = 0.0f;
+
+	if (measure(0))
+	{
+		traceMilliseconds = m_gpuProfiler.GetScopeMilliseconds("trace");
+		for (uint32_t bounce = 0; bounce < ubo.maxDepth; ++bounce)
+		{
+			unsortedExtend[bounce] = m_gpuProfiler.GetScopeMilliseconds("extend " + std::to_string(bounce));
+		}
+	}
+
+	if (measure(1))
+	{
+		for (uint32_t bounce = 0; bounce < ubo.maxDepth; ++bounce)
+		{
+			sort[bounce] = std::max(m_gpuProfiler.GetScopeMilliseconds("sort " + std::to_string(bounce)), 0.0f);
+			sortedExtend[bounce] = m_gpuProfiler.GetScopeMilliseconds("extend " + std::to_string(bounce));
+		}
+	}
+
+	std::cout << std::setw(8) << "bounce" << std::setw(10) << "extend" << std::setw(10) << "sort"
+		<< std::setw(17) << "sorted extend" << std::setw(10) << "saved" << "\n" << std::fixed << std::setprecision(3);
+
+	// Sorting pays for itself from the bounce after which it saves the most time over the remaining bounces
+	float unsortedTotal = 0.0f;
+	float savedFromBounce = 0.0f;
+	float bestSaved = 0.0f;
+	uint32_t bestFirstBounce = 0;
+	for (uint32_t bounce = ubo.maxDepth; bounce-- > 0;)
+	{
+		unsortedTotal += unsortedExtend[bounce];
+		const float saved = unsortedExtend[bounce] - sort[bounce] - sortedExtend[bounce];
+		savedFromBounce += saved;
+		if (bounce > 0 && savedFromBounce > bestSaved)
+		{
+			bestSaved = savedFromBounce;
+			bestFirstBounce = bounce;
+		}
+	}
+
+	for (uint32_t bounce = 0; bounce < ubo.maxDepth; ++bounce)
+	{
+		std::cout << std::setw(8) << bounce << std::setw(10) << unsortedExtend[bounce] << std::setw(10) << sort[bounce]
+			<< std::setw(17) << sortedExtend[bounce] << std::setw(10) << unsortedExtend[bounce] - sort[bounce] - sortedExtend[bounce] << "\n";
+	}
+
+	std::cout << "Single dispatch trace: " << traceMilliseconds << " ms, wavefront bounces: " << unsortedTotal << " ms\n";
+	if (bestFirstBounce > 0)
+	{
+		std::cout << "Sorting the rays pays for itself from bounce " << bestFirstBounce << " on, saving " << bestSaved
+			<< " ms (--wavefront-sort " << bestFirstBounce << ")\n";
+	}
+	else
+	{
+		std::cout << "Sorting the rays doesn't pay for itself on this scene\n";
+	}
+	std::cout << std::defaultfloat;
+
+	vkDestroyFence(m_vkDevice, fence, nullptr);
+	vkFreeCommandBuffers(m_vkDevice, m_commandPool, 1, &commandBuffer);
+
+	ubo = savedUniforms;
+	m_wavefront.tracer.SetFirstSortedBounce(firstSortedBounce);
+}
+
+void VulkanAppBase::BenchmarkPersistentThreads()
+{
+	if (!m_gpuProfiler.IsSupported())
+	{
+		return;
+	}
+
+	// A pass over the whole image with the samples and the depth of the app
+	Gpu::ComputeUniforms& ubo = m_computeUBO.ubo;
+	const Gpu::ComputeUniforms savedUniforms = ubo;
+	const uint32_t persistentWorkgroups = m_persistentThreads.workgroups;
+	const uint32_t tilesCount = GetComputeTilesCount(m_computeDispatchConfig);
+	ubo.tileOffset = 0;
+	ubo.tilesCount = tilesCount;
+	ubo.accumulatedPasses = 0;
+
+	std::cout << "Persistent threads benchmark, " << m_computeTargetTexture.width << "x" << m_computeTargetTexture.height
+		<< ", " << ubo.samplesPerPixel << " spp, max depth " << ubo.maxDepth << ", "
+		<< m_computeDispatchConfig.workgroupWidth << "x" << m_computeDispatchConfig.workgroupHeight << " workgroups\n";
+
+	VkCommandBuffer commandBuffer = VulkanUtils::CreateCommandeBuffer(m_vkDevice, m_commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	VkFenceCreateInfo fenceCreateInfo{};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	VK_CHECK_RESULT(vkCreateFence(m_vkDevice, &fenceCreateInfo, nullptr, &fence));
+
+	LinearArena readbackArena;
+	readbackArena.Init(m_memoryAllocator, sizeof(Gpu::TraceCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	const LinearArena::Allocation readback = readbackArena.Allocate(sizeof(Gpu::TraceCounters), alignof(Gpu::TraceCounters));
+
+	struct Result
+	{
+		float milliseconds = 0.0f;
+		// Lanes tracing a bounce, out of the lanes of their subgroups
+		float laneUtilization = 0.0f;
+	};
+
+	// The trace with the given persistent workgroups, 0 for a workgroup per tile: the fastest of a few dispatches
+	// after a warm up one, then a dispatch counting its busy lanes
+	auto measure = [&](uint32_t workgroups, Result& result)
+	{
+		m_persistentThreads.workgroups = workgroups;
+		VkPipeline pipeline = CreateComputePipelineVariant(m_computeDispatchConfig);
+
+		m_uploadRing.BeginFrame(m_currentFrame);
+		UpdateComputeUBO();
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		m_gpuProfiler.BeginFrame(commandBuffer, 0);
+
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		const uint32_t measuredDispatches = 3;
+		std::vector<std::string> scopeNames;
+		RecordComputeDispatch(commandBuffer, pipeline, m_computeDispatchConfig);
+		for (uint32_t i = 0; i < measuredDispatches; ++i)
+		{
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+			scopeNames.push_back("dispatch" + std::to_string(i));
+			const uint32_t scope = m_gpuProfiler.BeginScope(commandBuffer, scopeNames.back());
+			RecordComputeDispatch(commandBuffer, pipeline, m_computeDispatchConfig);
+			m_gpuProfiler.EndScope(commandBuffer, scope);
+		}
+
+		// Counting the lanes adds atomics to every bounce, it's kept out of the measured dispatches
+		m_persistentThreads.laneStatistics = true;
+		RecordComputeDispatch(commandBuffer, pipeline, m_computeDispatchConfig);
+		m_persistentThreads.laneStatistics = false;
+
+		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.dstOffset = readback.offset;
+		copyRegion.size = sizeof(Gpu::TraceCounters);
+		vkCmdCopyBuffer(commandBuffer, m_persistentThreads.counters.GetBuffer(), readback.buffer, 1, &copyRegion);
+
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		VK_CHECK_RESULT(vkQueueSubmit(m_computeQueue, 1, &submitInfo, fence));
+		VK_CHECK_RESULT(vkWaitForFences(m_vkDevice, 1, &fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(m_vkDevice, 1, &fence));
+		VK_CHECK_RESULT(vkResetCommandBuffer(commandBuffer, 0));
+
+		vkDestroyPipeline(m_vkDevice, pipeline, nullptr);
+
+		if (!m_gpuProfiler.Resolve(m_vkDevice, 0))
+		{
+			return false;
+		}
+
+		result.milliseconds = std::numeric_limits<float>::max();
+		for (const std::string& scopeName : scopeNames)
+		{
+			result.milliseconds = std::min(result.milliseconds, m_gpuProfiler.GetScopeMilliseconds(scopeName));
+		}
+
+		Gpu::TraceCounters counters;
+		memcpy(&counters, readback.mapped, sizeof(Gpu::TraceCounters));
+		result.laneUtilization = counters.lanes != 0 ? float(counters.busyLanes) / float(counters.lanes) : 0.0f;
+		return true;
+	};
+
+	std::cout << std::setw(12) << "workgroups" << std::setw(10) << "ms" << std::setw(16) << "busy lanes"
+		<< std::setw(10) << "speedup" << "\n" << std::fixed << std::setprecision(3);
+
+	Result perTile;
+	if (measure(0, perTile))
+	{
+		std::cout << std::setw(12) << "per tile" << std::setw(10) << perTile.milliseconds
+			<< std::setw(15) << perTile.laneUtilization * 100.0f << "%" << std::setw(10) << 1.0f << "\n";
+	}
+
+	// From a few workgroups per SM or CU up to as many as the tiles, past which every workgroup traces a single tile
+	uint32_t bestWorkgroups = 0;
+	float bestMilliseconds = perTile.milliseconds;
+	for (uint32_t workgroups = 64; workgroups < tilesCount * 2; workgroups *= 2)
+	{
+		Result persistent;
+		if (!measure(std::min(workgroups, tilesCount), persistent))
+		{
+			continue;
+		}
+
+		std::cout << std::setw(12) << std::min(workgroups, tilesCount) << std::setw(10) << persistent.milliseconds
+			<< std::setw(15) << persistent.laneUtilization * 100.0f << "%"
+			<< std::setw(10) << perTile.milliseconds / persistent.milliseconds << "\n";
+
+		if (persistent.milliseconds < bestMilliseconds)
+		{
+			bestMilliseconds = persistent.milliseconds;
+			bestWorkgroups = std::min(workgroups, tilesCount);
+		}
+	}
+
+	if (bestWorkgroups != 0)
+	{
+		std::cout << "Persistent threads are the fastest with " << bestWorkgroups << " workgroups, "
+			<< perTile.milliseconds / bestMilliseconds << "x (--persistent-threads " << bestWorkgroups << ")\n";
+	}
+	else
+	{
+		std::cout << "Persistent threads don't pay for themselves on this scene\n";
+	}
+	std::cout << std::defaultfloat;
+
+	readbackArena.Deinit(m_memoryAllocator);
+	vkDestroyFence(m_vkDevice, fence, nullptr);
+	vkFreeCommandBuffers(m_vkDevice, m_commandPool, 1, &commandBuffer);
+
+	ubo = savedUniforms;
+	m_persistentThreads.workgroups = persistentWorkgroups;
+}
+
+void VulkanAppBase::BenchmarkTileOrders()
+{
+	if (!m_gpuProfiler.IsSupported())
+	{
+		return;
+	}
+
+	Gpu::ComputeUniforms& ubo = m_computeUBO.ubo;
+	const Gpu::ComputeUniforms savedUniforms = ubo;
+
+	// Workgroups resident at once, for the footprint. The actual count depends on the GPU and the register use of
+	// the trace.
+	const uint32_t windowsTiles[] = { 64, 256 };
+
+	std::cout << "Tile orders benchmark, " << m_computeTargetTexture.width << "x" << m_computeTargetTexture.height << ", "
+		<< ubo.samplesPerPixel << " spp, max depth " << ubo.maxDepth << ", " << m_computeDispatchConfig.workgroupWidth << "x"
+		<< m_computeDispatchConfig.workgroupHeight << " workgroups, times in ms\n";
+	std::cout << "Footprint, a proxy of the cache hits: outline of " << windowsTiles[0] << " and " << windowsTiles[1]
+		<< " consecutive tiles of the order over the outline of a square of as many, 1 at best\n";
+
+	const glm::uvec2 groupCount(
+		(m_computeTargetTexture.width + m_computeDispatchConfig.workgroupWidth - 1) / m_computeDispatchConfig.workgroupWidth,
+		(m_computeTargetTexture.height + m_computeDispatchConfig.workgroupHeight - 1) / m_computeDispatchConfig.workgroupHeight);
+
+	// The orders with the workgroup shape of the app, row-major first
+	std::vector<ComputeDispatchConfig> configs;
+	ComputeDispatchConfig rowMajor = m_computeDispatchConfig;
+	rowMajor.tileOrder = TileOrder::RowMajor;
+	rowMajor.tileSwizzle = 0;
+	configs.push_back(rowMajor);
+	for (TileOrder order : { TileOrder::Strips, TileOrder::Morton, TileOrder::Hilbert })
+	{
+		for (uint32_t swizzle : { 4, 8, 16 })
+		{
+			ComputeDispatchConfig config = rowMajor;
+			config.tileOrder = order;
+			config.tileSwizzle = swizzle;
+			configs.push_back(config);
+		}
+	}
+
+	std::vector<std::array<float, 2>> footprints;
+	for (const ComputeDispatchConfig& config : configs)
+	{
+		footprints.push_back({ DispatchAutotuner::GetTileOrderFootprint(config, groupCount, windowsTiles[0]),
+			DispatchAutotuner::GetTileOrderFootprint(config, groupCount, windowsTiles[1]) });
+	}
+
+	VkCommandBuffer commandBuffer = VulkanUtils::CreateCommandeBuffer(m_vkDevice, m_commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	VkFenceCreateInfo fenceCreateInfo{};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	VK_CHECK_RESULT(vkCreateFence(m_vkDevice, &fenceCreateInfo, nullptr, &fence));
+
+	// A pass over the whole image with the order of config, the fastest of a few after a warm up one
+	auto measure = [&](const ComputeDispatchConfig& config)
+	{
+		VkPipeline pipeline = CreateComputePipelineVariant(config);
+
+		ubo.tileOffset = 0;
+		ubo.tilesCount = GetComputeTilesCount(config);
+		ubo.accumulatedPasses = 0;
+		m_uploadRing.BeginFrame(m_currentFrame);
+		UpdateComputeUBO();
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		m_gpuProfiler.BeginFrame(commandBuffer, 0);
+
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		const uint32_t measuredDispatches = 3;
+		std::vector<std::string> scopeNames;
+		RecordComputeDispatch(commandBuffer, pipeline, config);
+		for (uint32_t i = 0; i < measuredDispatches; ++i)
+		{
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+			scopeNames.push_back("dispatch" + std::to_string(i));
+			const uint32_t scope = m_gpuProfiler.BeginScope(commandBuffer, scopeNames.back());
+			RecordComputeDispatch(commandBuffer, pipeline, config);
+			m_gpuProfiler.EndScope(commandBuffer, scope);
+		}
+
+		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		VK_CHECK_RESULT(vkQueueSubmit(m_computeQueue, 1, &submitInfo, fence));
+		VK_CHECK_RESULT(vkWaitForFences(m_vkDevice, 1, &fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(m_vkDevice, 1, &fence));
+		VK_CHECK_RESULT(vkResetCommandBuffer(commandBuffer, 0));
+
+		vkDestroyPipeline(m_vkDevice, pipeline, nullptr);
+
+		if (!m_gpuProfiler.Resolve(m_vkDevice, 0))
+		{
+			return -1.0f;
+		}
+
+		float milliseconds = std::numeric_limits<float>::max();
+		for (const std::string& scopeName : scopeNames)
+		{
+			milliseconds = std::min(milliseconds, m_gpuProfiler.GetScopeMilliseconds(scopeName));
+		}
+
+		return milliseconds;
+	};
+
+	auto measureScene = [&](const std::string& sceneName)
+	{
+		std::cout << sceneName << "\n" << std::setw(12) << "order" << std::setw(10) << "trace" << std::setw(10) << "speedup"
+			<< std::setw(16) << "footprint " + std::to_string(windowsTiles[0]) << std::setw(16) << "footprint " + std::to_string(windowsTiles[1]) << "\n"
+			<< std::fixed << std::setprecision(3);
+
+		float rowMajorMilliseconds = 0.0f;
+		for (size_t i = 0; i < configs.size(); ++i)
+		{
+			const float milliseconds = measure(configs[i]);
+			if (i == 0)
+			{
+				rowMajorMilliseconds = milliseconds;
+			}
+
+			const std::string orderName = std::string(DispatchAutotuner::GetTileOrderName(configs[i].tileOrder)) +
+				(configs[i].tileSwizzle != 0 ? " " + std::to_string(configs[i].tileSwizzle) : "");
+			std::cout << std::setw(12) << orderName << std::setw(10) << milliseconds << std::setw(10) << rowMajorMilliseconds / milliseconds
+				<< std::setw(16) << footprints[i][0] << std::setw(16) << footprints[i][1] << "\n";
+		}
+
+		std::cout << std::defaultfloat;
+	};
+
+	measureScene("Scene of the app");
+
+	// The rays of workgroups far apart on screen go through different parts of large scenes. Testing every sphere
+	// for every ray is too slow for them.
+	if (m_sceneAcceleration != SceneAcceleration::Linear)
+	{
+		for (uint32_t spheresCount : { 256 * 1024, 1024 * 1024 })
+		{
+			World world;
+			world.camera = m_world.camera;
+			CreateBenchmarkWorld(world, spheresCount);
+
+			const SceneEncoder::EncodedScene encodedScene = SceneEncoder::Encode(world, m_sceneEncoding, m_sceneAcceleration, false);
+			m_gpuScene.Upload(m_memoryAllocator, m_stagingArena, m_graphicsQueue, m_commandPool, encodedScene.GetView(), m_environment);
+			m_lbvhBuilder.Reserve(m_memoryAllocator, encodedScene.spheresCount);
+			m_gridBuilder.Reserve(m_memoryAllocator, encodedScene.spheresCount);
+			BuildSceneAcceleration();
+
+			measureScene(std::to_string(spheresCount) + " random spheres");
+		}
+
+		// Back to the scene of the app
+		CreateGpuScene();
+	}
+
+	vkDestroyFence(m_vkDevice, fence, nullptr);
+	vkFreeCommandBuffers(m_vkDevice, m_commandPool, 1, &commandBuffer);
+
+	ubo = savedUniforms;
+}
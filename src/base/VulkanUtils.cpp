@@ -160,35 +160,8 @@ uint32_t GetDeviceMemoryTypeIndex(VkPhysicalDevice device, uint32_t typeBits, Vk
 	return -1;
 }
 
-VkBuffer CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice logicalDevice,
-    VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory& bufferMemory)
-{
-    VkBufferCreateInfo bufferInfo{};
-	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size = size;
-	bufferInfo.usage = usage;
-	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    VkBuffer result;
-	VK_CHECK_RESULT_MSG(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &result), "Failed to create buffer!");
-
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(logicalDevice, result, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = GetDeviceMemoryTypeIndex(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-	VK_CHECK_RESULT_MSG(vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &bufferMemory),
-		"Failed to allocate buffer memory!");
-
-	vkBindBufferMemory(logicalDevice, result, bufferMemory, 0);
-
-    return result;
-}
-
-void CopyBuffer(VkDevice vkDevice, VkQueue queue, VkCommandPool commandPool, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+void CopyBuffer(VkDevice vkDevice, VkQueue queue, VkCommandPool commandPool, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size,
+    VkDeviceSize srcOffset)
 {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -206,6 +179,7 @@ void CopyBuffer(VkDevice vkDevice, VkQueue queue, VkCommandPool commandPool, VkB
     vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
     VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -218,6 +192,8 @@ void CopyBuffer(VkDevice vkDevice, VkQueue queue, VkCommandPool commandPool, VkB
 
     vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
     vkQueueWaitIdle(queue);
+
+    vkFreeCommandBuffers(vkDevice, commandPool, 1, &commandBuffer);
 }
 
 VkCommandBuffer CreateCommandeBuffer(VkDevice logicalDevice, VkCommandPool pool, VkCommandBufferLevel level)
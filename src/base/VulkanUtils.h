@@ -19,11 +19,8 @@ namespace VulkanUtils
 
 	uint32_t GetDeviceMemoryTypeIndex(VkPhysicalDevice device, uint32_t typeBits, VkMemoryPropertyFlags properties);
 
-	VkBuffer CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice logicalDevice,
-		VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory& bufferMemory);
-
 	void CopyBuffer(VkDevice vkDevice, VkQueue queue, VkCommandPool commandPool,
-		VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+		VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0);
 
 	VkCommandBuffer CreateCommandeBuffer(VkDevice logicalDevice, VkCommandPool pool, VkCommandBufferLevel level);
 
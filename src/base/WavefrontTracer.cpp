@@ -0,0 +1,207 @@
+#include "WavefrontTracer.h"
+
+#include "GpuProfiler.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <string>
+
+// An even number of passes leaves the sorted queue where the extend pass reads it
+static constexpr uint32_t sortPassesCount = (Gpu::raySortKeyBits + Gpu::lbvhRadixBits - 1) / Gpu::lbvhRadixBits;
+static_assert(sortPassesCount % 2 == 0, "The sorted queue must end up in the queue array");
+
+static constexpr std::array<const char*, 6> passShaders =
+{
+    "wavefront_generate.comp.spv",
+    "wavefront_extend.comp.spv",
+    "wavefront_accumulate.comp.spv",
+    "lbvh_sort_histogram.comp.spv",
+    "lbvh_sort_scan.comp.spv",
+    "lbvh_sort_scatter.comp.spv"
+};
+
+static uint32_t GetBlocksCount(uint32_t count, uint32_t blockSize)
+{
+    return (count + blockSize - 1) / blockSize;
+}
+
+// Makes the writes of the previous compute pass visible to the next one
+static void ComputeBarrier(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void WavefrontTracer::Init(VkDevice logicalDevice, VkPipelineLayout tracePipelineLayout)
+{
+    static_assert(passShaders.size() == PassesCount);
+
+    m_tracePipelineLayout = tracePipelineLayout;
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.size = sizeof(Gpu::LbvhPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_sortPipelineLayout));
+
+    for (uint32_t i = 0; i < PassesCount; ++i)
+    {
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.layout = i < SortHistogramPass ? m_tracePipelineLayout : m_sortPipelineLayout;
+        computePipelineCreateInfo.stage =
+            VulkanUtils::CreateShaderStage(logicalDevice, VulkanUtils::GetShadersPath() + passShaders[i], VK_SHADER_STAGE_COMPUTE_BIT);
+
+        VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &m_pipelines[i]));
+
+        VulkanUtils::DestroyShaderStage(logicalDevice, computePipelineCreateInfo.stage);
+    }
+}
+
+void WavefrontTracer::Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice)
+{
+    for (VkPipeline& pipeline : m_pipelines)
+    {
+        vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    vkDestroyPipelineLayout(logicalDevice, m_sortPipelineLayout, nullptr);
+    m_sortPipelineLayout = VK_NULL_HANDLE;
+    m_tracePipelineLayout = VK_NULL_HANDLE;
+
+    m_paths.Release(allocator);
+    m_queue.Release(allocator);
+    m_queueAlt.Release(allocator);
+    m_sortKeys.Release(allocator);
+    m_sortKeysAlt.Release(allocator);
+    m_histogram.Release(allocator);
+}
+
+void WavefrontTracer::Reserve(DeviceMemoryAllocator& allocator, uint32_t pathsCount)
+{
+    const VkDeviceSize count = std::max(pathsCount, 1u);
+    const VkDeviceSize digitsCount = VkDeviceSize(1) << Gpu::lbvhRadixBits;
+
+    m_paths.Reserve(allocator, count * sizeof(Gpu::WavefrontPath));
+    m_queue.Reserve(allocator, count * sizeof(uint32_t));
+    m_queueAlt.Reserve(allocator, count * sizeof(uint32_t));
+    m_sortKeys.Reserve(allocator, count * sizeof(uint32_t));
+    m_sortKeysAlt.Reserve(allocator, count * sizeof(uint32_t));
+    m_histogram.Reserve(allocator, digitsCount * GetBlocksCount(pathsCount, Gpu::lbvhBlockSize) * sizeof(uint32_t));
+}
+
+void WavefrontTracer::RecordSort(VkCommandBuffer commandBuffer, uint32_t pathsCount) const
+{
+    const uint32_t blocksCount = GetBlocksCount(pathsCount, Gpu::lbvhBlockSize);
+    const std::array<VkDeviceAddress, 2> keys = { m_sortKeys.GetAddress(), m_sortKeysAlt.GetAddress() };
+    const std::array<VkDeviceAddress, 2> values = { m_queue.GetAddress(), m_queueAlt.GetAddress() };
+
+    Gpu::LbvhPushConstants pushConstants;
+    pushConstants.histogram = m_histogram.GetAddress();
+    pushConstants.count = pathsCount;
+
+    auto dispatch = [&](PassIdx pass, uint32_t groupCount)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[pass]);
+        vkCmdPushConstants(commandBuffer, m_sortPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+            0, sizeof(Gpu::LbvhPushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+    };
+
+    // Least significant digit first, every pass is a stable counting sort of one digit
+    for (uint32_t pass = 0; pass < sortPassesCount; ++pass)
+    {
+        pushConstants.keysIn = keys[pass % 2];
+        pushConstants.valuesIn = values[pass % 2];
+        pushConstants.keysOut = keys[(pass + 1) % 2];
+        pushConstants.valuesOut = values[(pass + 1) % 2];
+        pushConstants.shift = pass * Gpu::lbvhRadixBits;
+
+        ComputeBarrier(commandBuffer);
+        dispatch(SortHistogramPass, blocksCount);
+        ComputeBarrier(commandBuffer);
+        dispatch(SortScanPass, 1);
+        ComputeBarrier(commandBuffer);
+        dispatch(SortScatterPass, blocksCount);
+    }
+}
+
+void WavefrontTracer::Record(VkCommandBuffer commandBuffer, const Batch& batch, GpuProfiler* profiler) const
+{
+    const Gpu::ComputeUniforms& uniforms = batch.uniforms;
+    const uint32_t pathsCount = std::max(uniforms.tilesCount, 1u) * batch.tileWidth * batch.tileHeight;
+    const uint32_t groupCount = GetBlocksCount(pathsCount, Gpu::wavefrontWorkgroupSize);
+
+    Gpu::ComputePushConstants pushConstants = batch.pushConstants;
+    pushConstants.wavefrontPaths = m_paths.GetAddress();
+    pushConstants.wavefrontQueue = m_queue.GetAddress();
+    pushConstants.wavefrontPathsCount = pathsCount;
+    pushConstants.wavefrontTileWidth = batch.tileWidth;
+    pushConstants.wavefrontTileHeight = batch.tileHeight;
+
+    auto bind = [&]()
+    {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            m_tracePipelineLayout, 0, 1, &batch.descriptorSet, 1, &batch.uniformsOffset);
+    };
+
+    auto dispatch = [&](PassIdx pass)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[pass]);
+        vkCmdPushConstants(commandBuffer, m_tracePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+            0, sizeof(Gpu::ComputePushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+    };
+
+    auto sorted = [&](uint32_t bounce)
+    {
+        return m_firstSortedBounce != 0 && bounce >= m_firstSortedBounce && bounce < uniforms.maxDepth;
+    };
+
+    bind();
+    for (uint32_t sample = 0; sample < uniforms.samplesPerPixel; ++sample)
+    {
+        pushConstants.wavefrontSample = sample;
+        ComputeBarrier(commandBuffer);
+        dispatch(GeneratePass);
+
+        for (uint32_t bounce = 0; bounce < uniforms.maxDepth; ++bounce)
+        {
+            const bool profiled = profiler != nullptr && sample == 0;
+            if (sorted(bounce))
+            {
+                const uint32_t sortScope = profiled ? profiler->BeginScope(commandBuffer, "sort " + std::to_string(bounce)) : 0;
+                RecordSort(commandBuffer, pathsCount);
+                if (profiled)
+                {
+                    profiler->EndScope(commandBuffer, sortScope);
+                }
+
+                bind();
+            }
+
+            // The extend pass writes the keys of the rays of the next bounce
+            pushConstants.wavefrontSortKeys = sorted(bounce + 1) ? m_sortKeys.GetAddress() : 0;
+
+            ComputeBarrier(commandBuffer);
+            const uint32_t extendScope = profiled ? profiler->BeginScope(commandBuffer, "extend " + std::to_string(bounce)) : 0;
+            dispatch(ExtendPass);
+            if (profiled)
+            {
+                profiler->EndScope(commandBuffer, extendScope);
+            }
+        }
+    }
+
+    ComputeBarrier(commandBuffer);
+    dispatch(AccumulatePass);
+}
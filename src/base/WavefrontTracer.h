@@ -0,0 +1,81 @@
+#pragma once
+
+#include "DeviceMemoryAllocator.h"
+#include "GpuLayout.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+
+class GpuProfiler;
+
+// Wavefront mode of the path integrator (see wavefront.glsl): the paths of a batch are traced one bounce at a time
+// by a pass per bounce, their state kept in a buffer in between, instead of each invocation of the trace following
+// its path to the end. After the first bounce the rays of neighbouring invocations go anywhere, and so do their
+// traversals. The extend pass of a bounce can take the paths in the order of the sort keys of their rays instead,
+// sorted by the radix sort passes of the LBVH build: close origins and directions, the paths that ended behind the
+// others. The passes share the bindings and the push constants of the trace.
+class WavefrontTracer
+{
+public:
+    // tracePipelineLayout is the layout of raytracing.comp, it outlives the tracer
+    void Init(VkDevice logicalDevice, VkPipelineLayout tracePipelineLayout);
+    void Deinit(DeviceMemoryAllocator& allocator, VkDevice logicalDevice);
+
+    // Grows the paths and the sort arrays for batches of up to pathsCount paths, they must not be in use
+    void Reserve(DeviceMemoryAllocator& allocator, uint32_t pathsCount);
+
+    // The rays of the bounces from firstSortedBounce on are sorted before they are traced, 0 never sorts them.
+    // Camera rays are coherent already, bounce 0 is never sorted.
+    void SetFirstSortedBounce(uint32_t bounce) { m_firstSortedBounce = bounce; }
+    uint32_t GetFirstSortedBounce() const { return m_firstSortedBounce; }
+
+    struct Batch
+    {
+        // Bound with the trace layout, uniformsOffset is the dynamic offset of the uniforms
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        uint32_t uniformsOffset = 0;
+        // Tiles, samples and depth of the batch
+        Gpu::ComputeUniforms uniforms;
+        // Push constants of the trace, the wavefront fields are filled in by the tracer
+        Gpu::ComputePushConstants pushConstants;
+        uint32_t tileWidth = 0;
+        uint32_t tileHeight = 0;
+    };
+
+    // Records the passes tracing the batch in place of the trace, up to its writes to the images. With a profiler,
+    // the sort and the extend passes of every bounce of the first sample get their own scopes, "sort <bounce>"
+    // and "extend <bounce>".
+    void Record(VkCommandBuffer commandBuffer, const Batch& batch, GpuProfiler* profiler = nullptr) const;
+
+private:
+    enum PassIdx : uint32_t
+    {
+        GeneratePass,
+        ExtendPass,
+        AccumulatePass,
+        SortHistogramPass,
+        SortScanPass,
+        SortScatterPass,
+        PassesCount
+    };
+
+    // Sorts the queue by the keys the last extend pass wrote, the descriptor set of the batch has to be bound again
+    void RecordSort(VkCommandBuffer commandBuffer, uint32_t pathsCount) const;
+
+    VkPipelineLayout m_tracePipelineLayout = VK_NULL_HANDLE;
+    // Layout of the sort passes, the LBVH build one
+    VkPipelineLayout m_sortPipelineLayout = VK_NULL_HANDLE;
+    std::array<VkPipeline, PassesCount> m_pipelines{};
+
+    DeviceArray m_paths;
+    // Ping-pong of the sort, the sorted queue and keys end up in the first ones
+    DeviceArray m_queue;
+    DeviceArray m_queueAlt;
+    DeviceArray m_sortKeys;
+    DeviceArray m_sortKeysAlt;
+    DeviceArray m_histogram;
+
+    uint32_t m_firstSortedBounce = 0;
+};
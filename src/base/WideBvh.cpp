@@ -0,0 +1,576 @@
+#include "WideBvh.h"
+
+#include "VulkanUtils.h"
+#include "World.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+namespace WideBvh
+{
+
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    void Grow(const glm::vec3& p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void Grow(const Bounds& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    // Half the surface area, the SAH only compares ratios
+    float HalfArea() const
+    {
+        if (min.x > max.x)
+        {
+            return 0.0f;
+        }
+
+        const glm::vec3 extent = max - min;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    glm::vec3 Center() const { return 0.5f * (min + max); }
+};
+
+// Sphere being sorted into the binary tree, the references are partitioned in place so every pass over the spheres
+// of a node reads them sequentially
+struct SphereReference
+{
+    Bounds bounds;
+    glm::vec3 center;
+    uint32_t sphere;
+};
+
+// Node of the binary tree the wide one is collapsed from. Leaves hold up to wideBvhMaxLeafSpheres spheres.
+struct BinaryNode
+{
+    Bounds bounds;
+    // Internal nodes only
+    uint32_t left = 0;
+    uint32_t right = 0;
+    // Leaves only, range of the sphere references
+    uint32_t begin = 0;
+    uint32_t count = 0;
+
+    bool IsLeaf() const { return count > 0; }
+};
+
+static constexpr uint32_t binsCount = 16;
+// Cost of a box test relative to a sphere test
+static constexpr float traversalCost = 1.0f;
+
+static uint32_t GetBin(float center, float boundsMin, float binScale)
+{
+    return std::min(static_cast<uint32_t>((center - boundsMin) * binScale), binsCount - 1);
+}
+
+// Top down build, every node is split at the best of binsCount - 1 candidate planes on each axis
+static std::vector<BinaryNode> BuildBinaryTree(std::vector<SphereReference>& references)
+{
+    std::vector<BinaryNode> nodes;
+    nodes.reserve(2 * references.size());
+
+    BinaryNode root;
+    root.count = static_cast<uint32_t>(references.size());
+    nodes.push_back(root);
+
+    std::vector<uint32_t> pending = { 0 };
+    while (!pending.empty())
+    {
+        const uint32_t nodeIdx = pending.back();
+        pending.pop_back();
+
+        const uint32_t begin = nodes[nodeIdx].begin;
+        const uint32_t count = nodes[nodeIdx].count;
+
+        Bounds bounds;
+        Bounds centerBounds;
+        for (uint32_t i = begin; i < begin + count; ++i)
+        {
+            bounds.Grow(references[i].bounds);
+            centerBounds.Grow(references[i].center);
+        }
+
+        nodes[nodeIdx].bounds = bounds;
+        if (count == 1)
+        {
+            continue;
+        }
+
+        // Sum of the children areas weighted by their sphere counts
+        float bestCost = std::numeric_limits<float>::max();
+        uint32_t bestAxis = 0;
+        uint32_t bestBin = 0;
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float extent = centerBounds.max[axis] - centerBounds.min[axis];
+            if (extent <= 0.0f)
+            {
+                continue;
+            }
+
+            const float binScale = binsCount / extent;
+            std::array<Bounds, binsCount> bins;
+            std::array<uint32_t, binsCount> binCounts{};
+            for (uint32_t i = begin; i < begin + count; ++i)
+            {
+                const uint32_t bin = GetBin(references[i].center[axis], centerBounds.min[axis], binScale);
+                bins[bin].Grow(references[i].bounds);
+                ++binCounts[bin];
+            }
+
+            // Cost of the right side of the plane before each bin, then sweep the left side
+            std::array<float, binsCount> rightCosts{};
+            Bounds right;
+            uint32_t rightCount = 0;
+            for (uint32_t bin = binsCount - 1; bin > 0; --bin)
+            {
+                right.Grow(bins[bin]);
+                rightCount += binCounts[bin];
+                rightCosts[bin] = right.HalfArea() * rightCount;
+            }
+
+            Bounds left;
+            uint32_t leftCount = 0;
+            for (uint32_t bin = 1; bin < binsCount; ++bin)
+            {
+                left.Grow(bins[bin - 1]);
+                leftCount += binCounts[bin - 1];
+
+                const float cost = left.HalfArea() * leftCount + rightCosts[bin];
+                if (leftCount > 0 && leftCount < count && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = bin;
+                }
+            }
+        }
+
+        const bool foundSplit = bestCost != std::numeric_limits<float>::max();
+        const float splitCost = traversalCost + bestCost / std::max(bounds.HalfArea(), std::numeric_limits<float>::min());
+        if (count <= Gpu::wideBvhMaxLeafSpheres && (!foundSplit || splitCost >= static_cast<float>(count)))
+        {
+            continue;
+        }
+
+        uint32_t middle = begin + count / 2;
+        if (foundSplit)
+        {
+            const float binScale = binsCount / (centerBounds.max[bestAxis] - centerBounds.min[bestAxis]);
+            const auto secondHalf = std::partition(references.begin() + begin, references.begin() + begin + count,
+                [&](const SphereReference& reference)
+            {
+                return GetBin(reference.center[bestAxis], centerBounds.min[bestAxis], binScale) < bestBin;
+            });
+            middle = static_cast<uint32_t>(secondHalf - references.begin());
+        }
+
+        // Spheres with the same center are split in two halves
+        BinaryNode leftChild;
+        leftChild.begin = begin;
+        leftChild.count = middle - begin;
+        BinaryNode rightChild;
+        rightChild.begin = middle;
+        rightChild.count = begin + count - middle;
+
+        nodes[nodeIdx].left = static_cast<uint32_t>(nodes.size());
+        nodes[nodeIdx].right = static_cast<uint32_t>(nodes.size() + 1);
+        nodes[nodeIdx].count = 0;
+        pending.push_back(nodes[nodeIdx].right);
+        pending.push_back(nodes[nodeIdx].left);
+        nodes.push_back(leftChild);
+        nodes.push_back(rightChild);
+    }
+
+    return nodes;
+}
+
+static constexpr uint32_t emptySlot = std::numeric_limits<uint32_t>::max();
+
+// Slot s gets the child that comes first along the direction of octant s (bit i set for a negative component i),
+// so visiting the slots s ^ octant by increasing s goes about front to back for rays of that octant
+static std::array<uint32_t, Gpu::wideBvhWidth> AssignSlots(const std::vector<BinaryNode>& binaryNodes, const Bounds& bounds,
+    const std::vector<uint32_t>& children)
+{
+    std::array<std::array<float, Gpu::wideBvhWidth>, Gpu::wideBvhWidth> costs;
+    for (size_t child = 0; child < children.size(); ++child)
+    {
+        const glm::vec3 offset = binaryNodes[children[child]].bounds.Center() - bounds.Center();
+        for (uint32_t slot = 0; slot < Gpu::wideBvhWidth; ++slot)
+        {
+            const glm::vec3 direction((slot & 1) ? -1.0f : 1.0f, (slot & 2) ? -1.0f : 1.0f, (slot & 4) ? -1.0f : 1.0f);
+            costs[child][slot] = glm::dot(offset, direction);
+        }
+    }
+
+    // Greedy, the lowest cost pair of the remaining children and slots first
+    std::array<uint32_t, Gpu::wideBvhWidth> slots;
+    slots.fill(emptySlot);
+    std::array<bool, Gpu::wideBvhWidth> assigned{};
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        float bestCost = std::numeric_limits<float>::max();
+        uint32_t bestChild = 0;
+        uint32_t bestSlot = 0;
+        for (uint32_t child = 0; child < children.size(); ++child)
+        {
+            for (uint32_t slot = 0; slot < Gpu::wideBvhWidth; ++slot)
+            {
+                if (!assigned[child] && slots[slot] == emptySlot && costs[child][slot] <= bestCost)
+                {
+                    bestCost = costs[child][slot];
+                    bestChild = child;
+                    bestSlot = slot;
+                }
+            }
+        }
+
+        assigned[bestChild] = true;
+        slots[bestSlot] = bestChild;
+    }
+
+    return slots;
+}
+
+// Smallest power of two cell size covering the extent with 255 cells, as a biased float exponent
+static uint32_t GetQuantizationExponent(float extent)
+{
+    int exponent = static_cast<int>(std::ceil(std::log2(std::max(extent, std::numeric_limits<float>::min()) / 255.0f)));
+    exponent = std::clamp(exponent, -126, 127);
+    while (exponent < 127 && std::ldexp(255.0f, exponent) < extent)
+    {
+        ++exponent;
+    }
+
+    return static_cast<uint32_t>(exponent + 127);
+}
+
+static glm::vec3 GetCellSize(uint32_t exponents)
+{
+    return glm::vec3(std::ldexp(1.0f, static_cast<int>(exponents & 0xFF) - 127),
+        std::ldexp(1.0f, static_cast<int>((exponents >> 8) & 0xFF) - 127), std::ldexp(1.0f, static_cast<int>((exponents >> 16) & 0xFF) - 127));
+}
+
+static uint32_t GetByte(const glm::uvec2& bytes, uint32_t slot)
+{
+    return (bytes[slot >> 2] >> ((slot & 3) * 8)) & 0xFF;
+}
+
+static void SetByte(glm::uvec2& bytes, uint32_t slot, uint32_t value)
+{
+    bytes[slot >> 2] |= (value & 0xFF) << ((slot & 3) * 8);
+}
+
+Hierarchy Build(const std::vector<Sphere>& spheres)
+{
+    Hierarchy bvh;
+    if (spheres.empty())
+    {
+        return bvh;
+    }
+
+    std::vector<SphereReference> references(spheres.size());
+    for (size_t i = 0; i < spheres.size(); ++i)
+    {
+        const SpherePrimitive& shape = spheres[i].shape;
+        // Moving spheres are bounded over the whole shutter interval
+        references[i].bounds.Grow(glm::min(shape.center, shape.centerEnd) - glm::vec3(shape.radius));
+        references[i].bounds.Grow(glm::max(shape.center, shape.centerEnd) + glm::vec3(shape.radius));
+        references[i].center = 0.5f * (shape.center + shape.centerEnd);
+        references[i].sphere = static_cast<uint32_t>(i);
+    }
+
+    const std::vector<BinaryNode> binaryNodes = BuildBinaryTree(references);
+
+    bvh.sphereOrder.reserve(spheres.size());
+    bvh.nodes.emplace_back();
+
+    // Breadth first, the internal children of a node are allocated together
+    struct PendingNode
+    {
+        uint32_t wideIdx;
+        uint32_t binaryIdx;
+        uint32_t depth;
+    };
+
+    std::vector<PendingNode> pending = { { 0, 0, 1 } };
+    uint32_t depth = 1;
+    std::vector<uint32_t> children;
+    for (size_t pendingIdx = 0; pendingIdx < pending.size(); ++pendingIdx)
+    {
+        const PendingNode current = pending[pendingIdx];
+        const BinaryNode& binaryNode = binaryNodes[current.binaryIdx];
+        depth = std::max(depth, current.depth);
+
+        // A single leaf root is the only child of the root. Otherwise the internal child with the largest
+        // area is replaced by its children until the node is full.
+        children.clear();
+        if (binaryNode.IsLeaf())
+        {
+            children.push_back(current.binaryIdx);
+        }
+        else
+        {
+            children.push_back(binaryNode.left);
+            children.push_back(binaryNode.right);
+        }
+
+        while (children.size() < Gpu::wideBvhWidth)
+        {
+            float largestArea = -1.0f;
+            size_t largestChild = children.size();
+            for (size_t i = 0; i < children.size(); ++i)
+            {
+                const BinaryNode& child = binaryNodes[children[i]];
+                if (!child.IsLeaf() && child.bounds.HalfArea() > largestArea)
+                {
+                    largestArea = child.bounds.HalfArea();
+                    largestChild = i;
+                }
+            }
+
+            if (largestChild == children.size())
+            {
+                break;
+            }
+
+            const BinaryNode& opened = binaryNodes[children[largestChild]];
+            children[largestChild] = opened.left;
+            children.push_back(opened.right);
+        }
+
+        const std::array<uint32_t, Gpu::wideBvhWidth> slots = AssignSlots(binaryNodes, binaryNode.bounds, children);
+
+        Gpu::WideBvhNode node;
+        node.origin = binaryNode.bounds.min;
+        const glm::vec3 extent = binaryNode.bounds.max - binaryNode.bounds.min;
+        node.exponents = GetQuantizationExponent(extent.x) | (GetQuantizationExponent(extent.y) << 8) |
+            (GetQuantizationExponent(extent.z) << 16);
+        node.childBase = static_cast<uint32_t>(bvh.nodes.size());
+        node.sphereBase = static_cast<uint32_t>(bvh.sphereOrder.size());
+
+        const glm::vec3 invCellSize = 1.0f / GetCellSize(node.exponents);
+
+        uint32_t internalChildrenCount = 0;
+        for (uint32_t slot = 0; slot < Gpu::wideBvhWidth; ++slot)
+        {
+            if (slots[slot] == emptySlot)
+            {
+                continue;
+            }
+
+            const uint32_t childIdx = children[slots[slot]];
+            const BinaryNode& child = binaryNodes[childIdx];
+
+            uint32_t meta = Gpu::wideBvhChildValid;
+            if (child.IsLeaf())
+            {
+                meta |= (child.count << Gpu::wideBvhLeafCountShift) |
+                    (static_cast<uint32_t>(bvh.sphereOrder.size()) - node.sphereBase);
+                for (uint32_t i = child.begin; i < child.begin + child.count; ++i)
+                {
+                    bvh.sphereOrder.push_back(references[i].sphere);
+                }
+            }
+            else
+            {
+                meta |= internalChildrenCount;
+                pending.push_back({ node.childBase + internalChildrenCount, childIdx, current.depth + 1 });
+                bvh.nodes.emplace_back();
+                ++internalChildrenCount;
+            }
+
+            SetByte(node.meta, slot, meta);
+
+            // Rounded outwards, the decoded box contains the child
+            const glm::vec3 low = glm::clamp(glm::floor((child.bounds.min - node.origin) * invCellSize), glm::vec3(0.0f), glm::vec3(255.0f));
+            const glm::vec3 high = glm::clamp(glm::ceil((child.bounds.max - node.origin) * invCellSize), glm::vec3(0.0f), glm::vec3(255.0f));
+            SetByte(node.lowX, slot, static_cast<uint32_t>(low.x));
+            SetByte(node.lowY, slot, static_cast<uint32_t>(low.y));
+            SetByte(node.lowZ, slot, static_cast<uint32_t>(low.z));
+            SetByte(node.highX, slot, static_cast<uint32_t>(high.x));
+            SetByte(node.highY, slot, static_cast<uint32_t>(high.y));
+            SetByte(node.highZ, slot, static_cast<uint32_t>(high.z));
+        }
+
+        bvh.nodes[current.wideIdx] = node;
+    }
+
+    // The traversal pops a node of every level on the way down and leaves up to wideBvhWidth - 1 of its
+    // children on the stack, the nodes of the deepest level only have leaves. Unbalanced scenes can make
+    // the SAH tree too deep, their spheres would be missed.
+    const uint32_t stackSize = (Gpu::wideBvhWidth - 1) * (depth - 1) + 1;
+    if (stackSize > Gpu::wideBvhStackSize)
+    {
+        VulkanUtils::FatalExit("The wide BVH is " + std::to_string(depth) + " levels deep, too deep for the traversal stack!", -1);
+    }
+
+    return bvh;
+}
+
+static float RaycastSphere(const SpherePrimitive& sphere, const glm::vec3& origin, const glm::vec3& direction, float tMax)
+{
+    const glm::vec3 oc = origin - sphere.center;
+    const float a = glm::dot(direction, direction);
+    const float halfB = glm::dot(oc, direction);
+    const float c = glm::dot(oc, oc) - sphere.radius * sphere.radius;
+    const float discriminant = halfB * halfB - a * c;
+    if (discriminant < 0.0f)
+    {
+        return tMax;
+    }
+
+    const float sqrtd = std::sqrt(discriminant);
+    for (const float root : { (-halfB - sqrtd) / a, (-halfB + sqrtd) / a })
+    {
+        if (root > 0.0f && root < tMax)
+        {
+            return root;
+        }
+    }
+
+    return tMax;
+}
+
+float Raycast(const Hierarchy& bvh, const std::vector<Sphere>& spheres, const glm::vec3& origin, const glm::vec3& direction,
+    uint32_t& hitSphere, TraversalStats* stats)
+{
+    float tMax = std::numeric_limits<float>::infinity();
+    hitSphere = 0;
+
+    if (bvh.nodes.empty())
+    {
+        return tMax;
+    }
+
+    TraversalStats unusedStats;
+    TraversalStats& traversal = stats != nullptr ? *stats : unusedStats;
+
+    const glm::vec3 invDirection = 1.0f / direction;
+    const uint32_t octant = (direction.x < 0.0f ? 1 : 0) | (direction.y < 0.0f ? 2 : 0) | (direction.z < 0.0f ? 4 : 0);
+
+    struct StackEntry
+    {
+        uint32_t node;
+        float tEntry;
+    };
+
+    std::vector<StackEntry> stack = { { 0, 0.0f } };
+    while (!stack.empty())
+    {
+        const StackEntry entry = stack.back();
+        stack.pop_back();
+        if (entry.tEntry > tMax)
+        {
+            continue;
+        }
+
+        const Gpu::WideBvhNode& node = bvh.nodes[entry.node];
+        const glm::vec3 cellSize = GetCellSize(node.exponents);
+        ++traversal.nodes;
+
+        std::array<StackEntry, Gpu::wideBvhWidth> hitChildren;
+        uint32_t hitChildrenCount = 0;
+        for (uint32_t i = 0; i < Gpu::wideBvhWidth; ++i)
+        {
+            const uint32_t slot = i ^ octant;
+            const uint32_t meta = GetByte(node.meta, slot);
+            if (meta == 0)
+            {
+                continue;
+            }
+
+            const glm::vec3 low(GetByte(node.lowX, slot), GetByte(node.lowY, slot), GetByte(node.lowZ, slot));
+            const glm::vec3 high(GetByte(node.highX, slot), GetByte(node.highY, slot), GetByte(node.highZ, slot));
+            const glm::vec3 t0 = (node.origin + low * cellSize - origin) * invDirection;
+            const glm::vec3 t1 = (node.origin + high * cellSize - origin) * invDirection;
+            const glm::vec3 tNear = glm::min(t0, t1);
+            const glm::vec3 tFar = glm::max(t0, t1);
+            const float tEntry = std::max(std::max(tNear.x, tNear.y), tNear.z);
+            const float tExit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+            ++traversal.boxTests;
+            if (tEntry > tExit || tExit < 0.0f || tEntry > tMax)
+            {
+                continue;
+            }
+
+            const uint32_t offset = meta & Gpu::wideBvhOffsetMask;
+            const uint32_t leafSpheresCount = (meta & ~Gpu::wideBvhChildValid) >> Gpu::wideBvhLeafCountShift;
+            if (leafSpheresCount == 0)
+            {
+                hitChildren[hitChildrenCount++] = { node.childBase + offset, tEntry };
+                continue;
+            }
+
+            for (uint32_t sphere = node.sphereBase + offset; sphere < node.sphereBase + offset + leafSpheresCount; ++sphere)
+            {
+                const uint32_t worldSphere = bvh.sphereOrder[sphere];
+                const float t = RaycastSphere(spheres[worldSphere].shape, origin, direction, tMax);
+                ++traversal.sphereTests;
+                if (t < tMax)
+                {
+                    tMax = t;
+                    hitSphere = worldSphere;
+                }
+            }
+        }
+
+        // The nearest child ends up on top of the stack
+        while (hitChildrenCount > 0)
+        {
+            stack.push_back(hitChildren[--hitChildrenCount]);
+        }
+    }
+
+    return tMax;
+}
+
+void PrintStats(std::ostream& os, const Hierarchy& bvh, const World& world)
+{
+    const size_t spheresCount = bvh.sphereOrder.size();
+    const size_t nodesSize = bvh.nodes.size() * sizeof(Gpu::WideBvhNode);
+    // LbvhBuilder output: spheresCount - 1 binary nodes and the leaves array
+    const size_t lbvhSize = (std::max<size_t>(spheresCount, 1) - 1) * sizeof(Gpu::BvhNode) + spheresCount * sizeof(uint32_t);
+
+    // Rays through a square grid of the 90 degrees field of view of the trace
+    const uint32_t raysResolution = 64;
+    const glm::vec3 w = -glm::normalize(world.camera.direction);
+    const glm::vec3 u = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), w));
+    const glm::vec3 v = glm::cross(w, u);
+
+    TraversalStats stats;
+    for (uint32_t y = 0; y < raysResolution; ++y)
+    {
+        for (uint32_t x = 0; x < raysResolution; ++x)
+        {
+            const glm::vec2 p = (glm::vec2(x, y) + 0.5f) / static_cast<float>(raysResolution) * 2.0f - 1.0f;
+            const glm::vec3 direction = glm::normalize(-w + p.x * u - p.y * v);
+            uint32_t hitSphere;
+            Raycast(bvh, world.spheres, world.camera.position, direction, hitSphere, &stats);
+        }
+    }
+
+    const float raysCount = static_cast<float>(raysResolution * raysResolution);
+
+    os << std::fixed << std::setprecision(2);
+    os << "Wide BVH: " << bvh.nodes.size() << " nodes, " << nodesSize << " B (LBVH " << lbvhSize << " B)\n";
+    os << " per camera ray: " << stats.nodes / raysCount << " nodes (" << stats.nodes * sizeof(Gpu::WideBvhNode) / raysCount <<
+        " B), " << stats.boxTests / raysCount << " box tests, " << stats.sphereTests / raysCount << " sphere tests\n";
+    os << std::defaultfloat;
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "GpuLayout.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct Sphere;
+struct World;
+
+// 8-wide BVH built on the host: a binned SAH binary tree collapsed into Gpu::WideBvhNode nodes whose child bounds
+// are quantized to 8 bits relative to the node (Ylitie et al. 2017). A node takes 80 bytes for 8 children where
+// the LBVH takes 32 bytes per binary node, and a ray visits several times fewer of them.
+// Leaves refer to up to Gpu::wideBvhMaxLeafSpheres consecutive spheres, the scene arrays are stored in leaf order.
+namespace WideBvh
+{
+    struct Hierarchy
+    {
+        // Node 0 is the root, empty for an empty scene
+        std::vector<Gpu::WideBvhNode> nodes;
+        // Index in the World of the sphere at each position of the leaf order
+        std::vector<uint32_t> sphereOrder;
+    };
+
+    Hierarchy Build(const std::vector<Sphere>& spheres);
+
+    struct TraversalStats
+    {
+        uint64_t nodes = 0;
+        uint64_t boxTests = 0;
+        uint64_t sphereTests = 0;
+    };
+
+    // Host version of the traversal of raytracing.comp, same quantized nodes and child order.
+    // Distance to the closest hit, infinity if nothing was hit, and the World index of the hit sphere.
+    float Raycast(const Hierarchy& bvh, const std::vector<Sphere>& spheres, const glm::vec3& origin, const glm::vec3& direction,
+        uint32_t& hitSphere, TraversalStats* stats = nullptr);
+
+    // Size of the nodes vs the LBVH, and traversal steps of rays from the World camera
+    void PrintStats(std::ostream& os, const Hierarchy& bvh, const World& world);
+}
@@ -2,7 +2,9 @@
 
 #include "GeometryPrimitives.h"
 #include "Materials.h"
+#include "SceneEncoding.h"
 
+#include <string>
 #include <vector>
 
 struct Sphere
@@ -11,6 +13,30 @@ struct Sphere
     MaterialInfo material;
 };
 
+struct Plane
+{
+    PlanePrimitive shape;
+    MaterialInfo material;
+};
+
+struct Quad
+{
+    QuadPrimitive shape;
+    MaterialInfo material;
+};
+
+struct Box
+{
+    BoxPrimitive shape;
+    MaterialInfo material;
+};
+
+struct SphereField
+{
+    SphereFieldPrimitive shape;
+    MaterialInfo material;
+};
+
 struct World
 {
     struct
@@ -21,5 +47,25 @@ struct World
 
     MaterialManager materialManager;
 
+    // Equirectangular Radiance .hdr file lighting the rays leaving the scene, a sky gradient if empty.
+    // The file can be overridden from the command line.
+    struct
+    {
+        std::string fileName;
+        float intensity = 1.0f;
+    } environment;
+
+    // Can be overridden from the command line
+    SceneAcceleration acceleration = SceneAcceleration::Linear;
+    Integrator integrator = Integrator::Path;
+
     std::vector<Sphere> spheres;
+
+    // Tested by every ray, for the ground, walls and the few large objects of a scene
+    std::vector<Plane> planes;
+    std::vector<Quad> quads;
+    std::vector<Box> boxes;
+
+    // Procedural spheres, only the regions are stored
+    std::vector<SphereField> sphereFields;
 };
\ No newline at end of file
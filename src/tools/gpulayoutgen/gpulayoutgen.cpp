@@ -0,0 +1,152 @@
+// Writes the GLSL side of the layouts described in GpuLayout.h
+//
+// Usage: gpulayoutgen <output .glsl file>
+
+#include "GpuLayout.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct FieldDesc
+{
+    const char* glslType;
+    const char* name;
+    size_t size;
+    size_t alignment;
+};
+
+struct StructDesc
+{
+    const char* name;
+    std::vector<FieldDesc> fields;
+};
+
+struct ConstantDesc
+{
+    const char* name;
+    uint32_t value;
+};
+
+#define GPU_LAYOUT_DESC_CONSTANT(name, value) { #name, value },
+#define GPU_LAYOUT_DESC_STRUCT(Name) { #Name, {
+#define GPU_LAYOUT_DESC_FIELD(Type, name, init) { Gpu::TypeInfo<Type>::glsl, #name, sizeof(Type), Gpu::TypeInfo<Type>::alignment },
+#define GPU_LAYOUT_DESC_END(Name) } },
+
+static const ConstantDesc constants[] = { GPU_LAYOUT_CONSTANTS(GPU_LAYOUT_DESC_CONSTANT) };
+static const StructDesc structs[] = { GPU_LAYOUT_STRUCTS(GPU_LAYOUT_DESC_STRUCT, GPU_LAYOUT_DESC_FIELD, GPU_LAYOUT_DESC_END) };
+
+// camelCase / PascalCase to snake_case
+static std::string ToSnakeCase(const std::string& name)
+{
+    std::string result;
+    for (size_t i = 0; i < name.size(); ++i)
+    {
+        if (std::isupper(static_cast<unsigned char>(name[i])))
+        {
+            if (i > 0)
+            {
+                result += '_';
+            }
+
+            result += static_cast<char>(std::tolower(static_cast<unsigned char>(name[i])));
+        }
+        else
+        {
+            result += name[i];
+        }
+    }
+
+    return result;
+}
+
+static std::string ToUpper(std::string name)
+{
+    for (char& c : name)
+    {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+
+    return name;
+}
+
+static std::string Generate()
+{
+    std::stringstream os;
+    os << "// Generated by gpulayoutgen from src/base/GpuLayout.h, do not edit.\n";
+    os << "// Blocks using these structs need the scalar layout (GL_EXT_scalar_block_layout).\n";
+    os << "// <STRUCT>_MEMBERS lists the members of a struct to declare a uniform or push constant block with them.\n";
+    os << "\n";
+
+    for (const ConstantDesc& constant : constants)
+    {
+        os << "const uint " << ToSnakeCase(constant.name) << " = " << constant.value << "u;\n";
+    }
+
+    for (const StructDesc& desc : structs)
+    {
+        const std::string name = ToSnakeCase(desc.name);
+
+        os << "\n";
+        os << "#define " << ToUpper(name) << "_MEMBERS";
+
+        size_t offset = 0;
+        size_t alignment = 1;
+        for (const FieldDesc& field : desc.fields)
+        {
+            offset = (offset + field.alignment - 1) / field.alignment * field.alignment;
+            os << " \\\n    " << field.glslType << " " << ToSnakeCase(field.name) << "; /* offset " << offset << " */";
+            offset += field.size;
+            alignment = std::max(alignment, field.alignment);
+        }
+
+        os << "\n";
+
+        const size_t size = (offset + alignment - 1) / alignment * alignment;
+        os << "\n";
+        os << "// " << size << " bytes\n";
+        os << "struct " << name << "\n";
+        os << "{\n";
+        os << "    " << ToUpper(name) << "_MEMBERS\n";
+        os << "};\n";
+    }
+
+    return os.str();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: gpulayoutgen <output .glsl file>\n";
+        return 1;
+    }
+
+    const std::string content = Generate();
+
+    // Leave the file untouched when nothing changed, so shaders aren't seen as modified on every build
+    {
+        std::ifstream is(argv[1], std::ios::binary);
+        std::stringstream current;
+        current << is.rdbuf();
+        if (is && current.str() == content)
+        {
+            return 0;
+        }
+    }
+
+    std::ofstream os(argv[1], std::ios::binary | std::ios::trunc);
+    if (!os)
+    {
+        std::cerr << "Can't write " << argv[1] << "\n";
+        return 1;
+    }
+
+    os << content;
+    std::cout << "Generated " << argv[1] << "\n";
+    return 0;
+}